@@ -6,26 +6,70 @@
 // @version 2.0 
 
 #include "american_option.hpp"
+#include "instrumentation.hpp"
 #include "pricing_methods.hpp"
 #include <stdexcept>
 
+// The finite-maturity approximations divide by T and sig; the perpetual formula has no maturity
+static void check_method_inputs(american_method method, double T, double sig) {
+    if (method == american_method::perpetual) return;
+    if (!(T > 0)) throw std::invalid_argument("Error: finite-maturity American pricing needs a positive maturity");
+    if (!(sig > 0)) throw std::invalid_argument("Error: finite-maturity American pricing needs a positive volatility");
+}
+
 // Default constructor
 american_option::american_option()
-    : spot(0), strike(0), rate(0), volatility(0), cost_of_carry(0), option(option::CALL) {}
+    : option(option::CALL), strike(0), spot(0), rate(0), volatility(0), cost_of_carry(0), maturity(0), method(american_method::perpetual) {}
 
-// Parameterized constructor
+// Parameterized constructor (perpetual)
 american_option::american_option(double S, double K, double r, double sig, double b, int option_type)
-    : spot(S), strike(K), rate(r), volatility(sig), cost_of_carry(b), option(option_type) {}
+    : option(option_type), strike(K), spot(S), rate(r), volatility(sig), cost_of_carry(b), maturity(0), method(american_method::perpetual) {}
+
+// Parameterized constructor (finite maturity)
+american_option::american_option(double S, double K, double r, double T, double sig, double b, int option_type, american_method method)
+    : option(option_type), strike(K), spot(S), rate(r), volatility(sig), cost_of_carry(b), maturity(T), method(method) {
+    check_method_inputs(method, T, sig);
+}
+
+// Parameterized constructor (finite maturity, volatility from a surface)
+american_option::american_option(double S, double K, double r, double T, const vol_surface& surface, double b, int option_type, american_method method)
+    : american_option(S, K, r, T, surface.volatility(K, T), b, option_type, method) {}
 
 // Implementation of price method
 double american_option::price() const {
-    if (option_type == CALL) {
-        return pricer.price_american_call(spot, strike, rate, volatility, cost_of_carry);
-    } else if (option_type == PUT) {
-        return pricer.price_american_put(spot, strike, rate, volatility, cost_of_carry);
-    } else {
+    INSTRUMENT_PROBE(american_option_price);
+    if (option_type != CALL && option_type != PUT) {
         throw std::domain_error("Invalid option type. Select 1 for American call or 2 for American put.");
     }
+    switch (method) {
+    case american_method::barone_adesi_whaley:
+        return (option_type == CALL) ? pricer.price_american_baw_call(spot, strike, rate, maturity, volatility, cost_of_carry)
+                                     : pricer.price_american_baw_put(spot, strike, rate, maturity, volatility, cost_of_carry);
+    case american_method::bjerksund_stensland:
+        return (option_type == CALL) ? pricer.price_american_bjs_call(spot, strike, rate, maturity, volatility, cost_of_carry)
+                                     : pricer.price_american_bjs_put(spot, strike, rate, maturity, volatility, cost_of_carry);
+    case american_method::crank_nicolson:
+        return pricer.price_american_pde(spot, strike, rate, maturity, volatility, cost_of_carry, option_type).price;
+    default:
+        return (option_type == CALL) ? pricer.price_american_call(spot, strike, rate, volatility, cost_of_carry)
+                                     : pricer.price_american_put(spot, strike, rate, volatility, cost_of_carry);
+    }
+}
+
+// Grid price with delta, gamma and theta (needs a finite maturity)
+pde_result american_option::price_and_greeks_pde() const {
+    if (option_type != CALL && option_type != PUT) {
+        throw std::domain_error("Invalid option type. Select 1 for American call or 2 for American put.");
+    }
+    if (!(maturity > 0)) {
+        throw std::invalid_argument("Error: finite-maturity American pricing needs a positive maturity");
+    }
+    return pricer.price_american_pde(spot, strike, rate, maturity, volatility, cost_of_carry, option_type);
+}
+
+void american_option::set_method(american_method method) {
+    check_method_inputs(method, maturity, volatility);
+    this->method = method;
 }
 
 // Implementation of toggle method
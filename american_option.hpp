@@ -10,21 +10,34 @@
 
 #include "option.hpp"
 #include "pricing_methods.hpp"
+#include "vol_surface.hpp"
 
 class american_option : public option {
     friend class pricing_methods;
+    friend class portfolio; // copies contracts into and out of its blocks
 public:
     american_option();
-    american_option(double S, double K, double r, double sig, double b, int option_type = 1);
+    american_option(double S, double K, double r, double sig, double b, int option_type = 1); // perpetual
+    // Finite maturity; unless method is perpetual, T and sig must be positive (std::invalid_argument, as in set_method)
+    american_option(double S, double K, double r, double T, double sig, double b, int option_type, american_method method = american_method::bjerksund_stensland);
+    // Volatility read off the surface at (K, T)
+    american_option(double S, double K, double r, double T, const vol_surface& surface, double b, int option_type, american_method method = american_method::bjerksund_stensland);
     double price() const override;
     void toggle() override;
 
+    // Switch between the perpetual formula and the finite-maturity approximations
+    void set_method(american_method method);
+    // Crank-Nicolson price with delta, gamma and theta read off the same grid
+    pde_result price_and_greeks_pde() const;
+
 private:
     double strike;
     double spot;
     double rate;
     double volatility;
     double cost_of_carry;
+    double maturity; // unused by the perpetual formula
+    american_method method;
     pricing_methods pricer;
 };
 
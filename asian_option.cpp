@@ -6,27 +6,67 @@
 // @version 1.0 
 
 #include "asian_option.hpp"
+#include "instrumentation.hpp"
 #include <cmath>
 #include <random>
 #include <numeric>
 #include <algorithm>
 #include <vector>
 
-asian_option::asian_option() : option(1), strike(0), maturity(0), spot(0), rate(0), volatility(0), cost_of_carry(0), n_simulations(10000), n_time_steps(252) {}
+asian_option::asian_option() : option(1), strike(0), spot(0), rate(0), volatility(0), maturity(0), cost_of_carry(0), n_simulations(10000), n_time_steps(252) {}
 
-asian_option::asian_option(double K, double T, double S, double r, double sig, double b, int option_type, int nSimulations, int nTimeSteps)
-    : strike(K), maturity(T), spot(S), rate(r), volatility(sig), cost_of_carry(b), option(option_type), n_simulations(nSimulations), n_time_steps(nTimeSteps) {}
+asian_option::asian_option(double S, double K, double r, double T, double sig, double b, int option_type, int nSimulations, int nTimeSteps)
+    : option(option_type), strike(K), spot(S), rate(r), volatility(sig), maturity(T), cost_of_carry(b), n_simulations(nSimulations), n_time_steps(nTimeSteps) {}
+
+asian_option::asian_option(double S, double K, double r, double T, const vol_surface& surface, double b, int option_type, int nSimulations, int nTimeSteps)
+    : asian_option(S, K, r, T, surface.volatility(K, T), b, option_type, nSimulations, nTimeSteps) {}
 
 double asian_option::price() const {
- if (option_type == CALL) {
-        return pricer.price_asian_call(strike, maturity, spot, rate, volatility, cost_of_carry, n_simulations, n_time_steps);
-    } else if (option_type == PUT) {
-        return pricer.price_asian_put(strike, maturity, spot, rate, volatility, cost_of_carry, n_simulations, n_time_steps);
+    INSTRUMENT_PROBE(asian_option_price);
+    return price_with_error().price;
+}
+
+mc_result asian_option::price_with_error() const {
+ if (option_type == CALL || option_type == PUT) {
+        return pricer.price_asian_mc(spot, strike, maturity, rate, volatility, cost_of_carry, n_time_steps, n_simulations, option_type, mc_config);
+    } else {
+        throw std::domain_error("Invalid option type. Select 1 for Asian call or 2 for Asian put.");
+    }
+}
+
+asian_greeks asian_option::price_and_greeks() const {
+    if (option_type == CALL || option_type == PUT) {
+        return pricer.price_and_greeks_asian_mc(spot, strike, maturity, rate, volatility, cost_of_carry, n_time_steps, n_simulations, option_type,
+                                                mc_config);
     } else {
         throw std::domain_error("Invalid option type. Select 1 for Asian call or 2 for Asian put.");
     }
 }
 
+void asian_option::set_seed(std::uint64_t seed) {
+    mc_config.seed = seed;
+}
+
+void asian_option::set_threads(unsigned n_threads) {
+    mc_config.n_threads = n_threads;
+}
+
+void asian_option::set_antithetic(bool enabled) {
+    mc_config.antithetic = enabled;
+}
+
+void asian_option::set_control_variate(bool enabled) {
+    mc_config.control_variate = enabled;
+}
+
+void asian_option::set_sampler(mc_sampler sampler) {
+    mc_config.sampler = sampler;
+}
+
+void asian_option::set_normals(const mc_normals* normals) {
+    mc_config.normals = normals;
+}
+
 void asian_option::toggle() {
     option_type = (option_type == option::CALL) ? option::PUT : option::CALL;
 }
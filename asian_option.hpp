@@ -7,18 +7,39 @@
 
 #include "option.hpp"
 #include "pricing_methods.hpp"
+#include "vol_surface.hpp"
+#include <cstdint>
 
 #ifndef ASIAN_OPTION_HPP
 #define ASIAN_OPTION_HPP
 
 class asian_option : public option {
     friend class pricing_methods; // friend of pricing_methods to use european option variables in the calculations
+    friend class portfolio; // copies contracts into and out of its blocks
 public:
     asian_option();
-    asian_option(double strike, double maturity, double spot, double rate, double volatility, double cost_of_carry, int n_simulations, int n_time_steps, int option_type = 1);
+    asian_option(double spot, double strike, double rate, double maturity, double volatility, double cost_of_carry, int option_type = 1, int n_simulations = 10000, int n_time_steps = 252);
+    // Flat volatility taken from the surface at (strike, maturity)
+    asian_option(double spot, double strike, double rate, double maturity, const vol_surface& surface, double cost_of_carry, int option_type = 1, int n_simulations = 10000, int n_time_steps = 252);
     double price() const override;
     void toggle() override;
 
+    // Price together with the Monte-Carlo standard error
+    mc_result price_with_error() const;
+    // Price, delta, gamma, vega, theta and rho from one simulation, each with its standard error
+    asian_greeks price_and_greeks() const;
+
+    // Monte-Carlo controls: RNG seed (same seed gives the same price) and worker threads (0 = all cores)
+    void set_seed(std::uint64_t seed);
+    void set_threads(unsigned n_threads);
+    // Variance reduction: antithetic pairs and the geometric-average control variate
+    void set_antithetic(bool enabled);
+    void set_control_variate(bool enabled);
+    // Path generator: pseudo-random (default) or randomised Sobol QMC with Brownian bridge
+    void set_sampler(mc_sampler sampler);
+    // Pre-generated normals shared with other runs of the same seed and steps (nullptr: draw them); not owned
+    void set_normals(const mc_normals* normals);
+
 private:
     double strike;
     double spot;
@@ -28,6 +49,7 @@ private:
     double cost_of_carry;
     int n_simulations; // simulations for Monte-Carlo pricing
     int n_time_steps; // time steps for Monte-Carlo
+    asian_mc_config mc_config; // seed, threads and variance reduction for the Monte-Carlo engine
     pricing_methods pricer;
 };
 
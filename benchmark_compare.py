@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+# benchmark_compare.py
+#
+# Compares two OptionPricerBenchmark JSON files and flags regressions.
+#
+#   python3 benchmark_compare.py baseline.json current.json [--threshold 0.10]
+#
+# A case regresses when its median time per item grows by more than the threshold (10% by default) and the
+# slowdown is larger than the run-to-run spread of the baseline (min..max over repetitions). Exits with status 1
+# if anything regressed, so it can gate a CI job.
+#
+# @author Mark Bogorad
+# @version 2.0
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    return data.get("context", {}), {b["name"]: b for b in data["benchmarks"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Flag benchmark regressions against a saved baseline")
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.10, help="allowed relative slowdown (default 0.10)")
+    args = parser.parse_args()
+
+    base_context, baseline = load(args.baseline)
+    current_context, current = load(args.current)
+    for key in ("compiler", "simd_width", "hardware_threads"):
+        if base_context.get(key) != current_context.get(key):
+            print(f"note: {key} differs ({base_context.get(key)} vs {current_context.get(key)})")
+
+    regressions = 0
+    print(f"{'benchmark':44} {'baseline':>14} {'current':>14} {'change':>9}")
+    for name, now in current.items():
+        before = baseline.get(name)
+        if before is None:
+            print(f"{name:44} {'-':>14} {now['ns_per_item']:>11.2f} ns {'new':>9}")
+            continue
+        ratio = now["ns_per_item"] / before["ns_per_item"]
+        noise = before["max_ns_per_item"] / before["min_ns_per_item"]
+        flag = ""
+        if ratio > 1.0 + args.threshold and ratio > noise:
+            flag = "  REGRESSION"
+            regressions += 1
+        elif ratio < 1.0 / (1.0 + args.threshold):
+            flag = "  faster"
+        print(f"{name:44} {before['ns_per_item']:>11.2f} ns {now['ns_per_item']:>11.2f} ns {ratio - 1.0:>+8.1%}{flag}")
+    for name in sorted(baseline.keys() - current.keys()):
+        print(f"{name:44} missing from the current run")
+
+    if regressions:
+        print(f"\n{regressions} regression(s) beyond {args.threshold:.0%}")
+        return 1
+    print("\nno regressions")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
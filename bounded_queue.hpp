@@ -0,0 +1,77 @@
+// bounded_queue.hpp
+//
+// Fixed-capacity blocking queue connecting pipeline stages. push blocks while the queue is full and pop blocks
+// while it is empty, so a fast producer cannot run ahead of a slow consumer by more than the capacity. close()
+// wakes everyone up: pushes are refused and pop drains what is left, then returns false.
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+template <class T>
+class bounded_queue {
+public:
+    explicit bounded_queue(std::size_t capacity) : capacity(capacity > 0 ? capacity : 1) {}
+
+    // false if the queue was closed
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [&] { return closed || items.size() < capacity; });
+        if (closed) return false;
+        items.push_back(std::move(item));
+        not_empty.notify_one();
+        return true;
+    }
+
+    // false once the queue is closed and empty
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [&] { return closed || !items.empty(); });
+        if (items.empty()) return false;
+        item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    // Waits for at least one item, then moves up to max_items of what is queued into out (appended); false once the
+    // queue is closed and empty. Lets a consumer coalesce whatever arrived while it was busy into one batch.
+    bool pop_batch(std::vector<T>& out, std::size_t max_items) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [&] { return closed || !items.empty(); });
+        if (items.empty()) return false;
+        const std::size_t count = std::min(max_items > 0 ? max_items : 1, items.size());
+        for (std::size_t i = 0; i < count; ++i) {
+            out.push_back(std::move(items.front()));
+            items.pop_front();
+        }
+        not_full.notify_all();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        not_full.notify_all();
+        not_empty.notify_all();
+    }
+
+private:
+    std::size_t capacity;
+    std::deque<T> items;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable not_full, not_empty;
+};
+
+#endif // BOUNDED_QUEUE_HPP
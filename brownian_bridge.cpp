@@ -0,0 +1,51 @@
+// brownian_bridge.cpp
+//
+// Implementation of the Brownian-bridge ordering and weights (Jaeckel, "Monte Carlo Methods in Finance", ch. 10)
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#include "brownian_bridge.hpp"
+#include <cmath>
+#include <stdexcept>
+
+brownian_bridge::brownian_bridge(int N, double T)
+    : n_steps(N), bridge_index(N), left_index(N), right_index(N), left_weight(N), right_weight(N), std_dev(N) {
+    if (N <= 0 || T <= 0) throw std::invalid_argument("Error: Brownian bridge needs N > 0 and T > 0");
+    std::vector<double> t(N);
+    for (int i = 0; i < N; ++i) t[i] = T * (i + 1) / N;
+
+    std::vector<int> map(N, 0); // map[i] != 0 once date i has been placed
+    map[N - 1] = 1;
+    bridge_index[0] = N - 1;
+    std_dev[0] = std::sqrt(t[N - 1]);
+    left_weight[0] = right_weight[0] = 0.0;
+
+    for (int i = 1, j = 0; i < N; ++i) {
+        while (map[j]) ++j; // first free date
+        int k = j;
+        while (!map[k]) ++k; // next placed date to its right
+        const int l = j + ((k - 1 - j) >> 1); // midpoint of the free stretch [j, k)
+        map[l] = i;
+        bridge_index[i] = l;
+        left_index[i] = j;
+        right_index[i] = k;
+        const double t_left = (j != 0) ? t[j - 1] : 0.0;
+        left_weight[i] = (t[k] - t[l]) / (t[k] - t_left);
+        right_weight[i] = (t[l] - t_left) / (t[k] - t_left);
+        std_dev[i] = std::sqrt((t[l] - t_left) * (t[k] - t[l]) / (t[k] - t_left));
+        j = k + 1;
+        if (j >= N) j = 0;
+    }
+}
+
+void brownian_bridge::build(const double* z, double* W) const {
+    W[n_steps - 1] = std_dev[0] * z[0];
+    for (int i = 1; i < n_steps; ++i) {
+        const int j = left_index[i];
+        const int k = right_index[i];
+        const int l = bridge_index[i];
+        const double left = (j != 0) ? left_weight[i] * W[j - 1] : 0.0;
+        W[l] = left + right_weight[i] * W[k] + std_dev[i] * z[i];
+    }
+}
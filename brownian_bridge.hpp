@@ -0,0 +1,27 @@
+// brownian_bridge.hpp
+//
+// Brownian-bridge construction of a Wiener path on N equally spaced dates: the first normal fixes W(T), the next ones
+// the successive midpoints, so the leading (best distributed) QMC coordinates drive the large-scale path shape.
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#ifndef BROWNIAN_BRIDGE_HPP
+#define BROWNIAN_BRIDGE_HPP
+
+#include <vector>
+
+class brownian_bridge {
+public:
+    brownian_bridge(int N, double T);
+
+    // W(t_1..t_N) from N standard normals z
+    void build(const double* z, double* W) const;
+
+private:
+    int n_steps;
+    std::vector<int> bridge_index, left_index, right_index;
+    std::vector<double> left_weight, right_weight, std_dev;
+};
+
+#endif // BROWNIAN_BRIDGE_HPP
@@ -34,10 +34,8 @@ void console_interface::enter_parameters() {
     std::cout << "Enter risk-free rate: ";
     std::cin >> rate;
 
-    if (option_type == 1 || option_type == 3) { 
-        std::cout << "Enter maturity: ";
-        std::cin >> maturity;
-    }
+    std::cout << "Enter maturity: ";
+    std::cin >> maturity;
 
     std::cout << "Enter volatility: ";
     std::cin >> volatility;
@@ -62,7 +60,7 @@ void console_interface::console_pricing() {
         display_greeks(*european_opt);
         calculate_and_check_parity(*european_opt);
     } else if (option_type == 2) { // American
-        opt = std::make_unique<american_option>(spot, strike, rate, volatility, cost_of_carry, (call_put_type == 1) ? option::CALL : option::PUT);
+        opt = std::make_unique<american_option>(spot, strike, rate, maturity, volatility, cost_of_carry, (call_put_type == 1) ? option::CALL : option::PUT);
         std::cout << "Option Price: " << opt->price() << std::endl;
     } else if (option_type == 3) { // Asian
         opt = std::make_unique<asian_option>(spot, strike, rate, maturity, volatility, cost_of_carry, (call_put_type == 1) ? option::CALL : option::PUT, nSimulations, nTimeSteps);
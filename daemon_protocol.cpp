@@ -0,0 +1,145 @@
+// daemon_protocol.cpp
+//
+// Socket helpers for the pricing daemon (Unix domain and loopback TCP)
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#include "daemon_protocol.hpp"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace daemon_protocol {
+
+// Parsed address: a Unix socket path, or a loopback TCP port
+struct endpoint {
+    bool tcp = false;
+    std::string path;
+    std::uint16_t port = 0;
+};
+
+static endpoint parse_address(const std::string& address) {
+    endpoint e;
+    if (address.rfind("tcp:", 0) == 0) {
+        std::string port = address.substr(4);
+        const std::size_t colon = port.rfind(':');
+        if (colon != std::string::npos) {
+            if (port.substr(0, colon) != "127.0.0.1" && port.substr(0, colon) != "localhost") {
+                throw std::invalid_argument("Error: the daemon only uses the loopback interface");
+            }
+            port = port.substr(colon + 1);
+        }
+        const int number = std::stoi(port);
+        if (number <= 0 || number > 65535) throw std::invalid_argument("Error: bad TCP port " + port);
+        e.tcp = true;
+        e.port = static_cast<std::uint16_t>(number);
+    } else {
+        e.path = (address.rfind("unix:", 0) == 0) ? address.substr(5) : address;
+        if (e.path.empty() || e.path.size() >= sizeof(sockaddr_un::sun_path)) throw std::invalid_argument("Error: bad socket path " + e.path);
+    }
+    return e;
+}
+
+static sockaddr_un unix_address(const endpoint& e) {
+    sockaddr_un a{};
+    a.sun_family = AF_UNIX;
+    std::memcpy(a.sun_path, e.path.c_str(), e.path.size() + 1);
+    return a;
+}
+
+static sockaddr_in tcp_address(const endpoint& e) {
+    sockaddr_in a{};
+    a.sin_family = AF_INET;
+    a.sin_port = htons(e.port);
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return a;
+}
+
+static int open_socket(const endpoint& e) {
+    const int fd = ::socket(e.tcp ? AF_INET : AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) throw std::runtime_error(std::string("Error: socket: ") + std::strerror(errno));
+    if (e.tcp) { // replies are small and latency-bound
+        const int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+int listen_on(const std::string& address) {
+    const endpoint e = parse_address(address);
+    const int fd = open_socket(e);
+    int result;
+    if (e.tcp) {
+        const int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        const sockaddr_in a = tcp_address(e);
+        result = ::bind(fd, reinterpret_cast<const sockaddr*>(&a), sizeof(a));
+    } else {
+        ::unlink(e.path.c_str());
+        const sockaddr_un a = unix_address(e);
+        result = ::bind(fd, reinterpret_cast<const sockaddr*>(&a), sizeof(a));
+    }
+    if (result != 0 || ::listen(fd, 128) != 0) {
+        const std::string reason = std::strerror(errno);
+        ::close(fd);
+        throw std::runtime_error("Error: could not listen on " + address + ": " + reason);
+    }
+    return fd;
+}
+
+int connect_to(const std::string& address) {
+    const endpoint e = parse_address(address);
+    const int fd = open_socket(e);
+    int result;
+    if (e.tcp) {
+        const sockaddr_in a = tcp_address(e);
+        result = ::connect(fd, reinterpret_cast<const sockaddr*>(&a), sizeof(a));
+    } else {
+        const sockaddr_un a = unix_address(e);
+        result = ::connect(fd, reinterpret_cast<const sockaddr*>(&a), sizeof(a));
+    }
+    if (result != 0) {
+        const std::string reason = std::strerror(errno);
+        ::close(fd);
+        throw std::runtime_error("Error: could not connect to " + address + ": " + reason);
+    }
+    return fd;
+}
+
+void remove_socket(const std::string& address) {
+    const endpoint e = parse_address(address);
+    if (!e.tcp) ::unlink(e.path.c_str());
+}
+
+bool read_full(int fd, void* buffer, std::size_t bytes) {
+    char* p = static_cast<char*>(buffer);
+    while (bytes > 0) {
+        const ssize_t got = ::read(fd, p, bytes);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        p += got;
+        bytes -= static_cast<std::size_t>(got);
+    }
+    return true;
+}
+
+bool write_full(int fd, const void* buffer, std::size_t bytes) {
+    const char* p = static_cast<const char*>(buffer);
+    while (bytes > 0) {
+        const ssize_t sent = ::write(fd, p, bytes);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        p += sent;
+        bytes -= static_cast<std::size_t>(sent);
+    }
+    return true;
+}
+
+} // namespace daemon_protocol
@@ -0,0 +1,95 @@
+// daemon_protocol.hpp
+//
+// Wire format of the pricing daemon and the socket helpers shared by the daemon and its load generator.
+//
+// Every message is a fixed-size frame in host byte order (little-endian is asserted): clients send 64-byte
+// requests and get back 72-byte replies, one per request, and may keep up to max_in_flight requests in flight on a
+// connection. Replies to price requests come back in the order the requests were sent on that connection. A
+// connection at the window is not read until its client has read replies, so a client that sends without reading
+// stalls only itself.
+//
+// Addresses are "unix:/path/to.sock" (a bare path means the same) or "tcp:PORT" / "tcp:127.0.0.1:PORT"; TCP
+// listens on the loopback interface only.
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#ifndef DAEMON_PROTOCOL_HPP
+#define DAEMON_PROTOCOL_HPP
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace daemon_protocol {
+
+static_assert(std::endian::native == std::endian::little, "the wire format is little-endian");
+
+inline constexpr std::uint8_t version = 1;
+inline constexpr std::size_t max_in_flight = 1024; // unanswered requests per connection
+
+enum message_type : std::uint8_t {
+    price = 1, // price one option; reply values follow the output bits
+    stats = 2, // latency report; reply values are stats_field
+    reset_stats = 3, // clear the latency report
+    shutdown = 4 // stop the daemon after replying
+};
+
+// Outputs a price request asks for (0 means price only); reply values[k] holds output bit k
+enum output_bit : std::uint8_t {
+    out_price = 1 << 0,
+    out_delta = 1 << 1,
+    out_gamma = 1 << 2,
+    out_vega = 1 << 3,
+    out_theta = 1 << 4,
+    out_rho = 1 << 5,
+    out_pcp_price = 1 << 6,
+    out_std_error = 1 << 7
+};
+
+// Reply values of a stats request (latencies in microseconds, from frame received to reply handed to the writer)
+enum stats_field : std::size_t { stats_count, stats_p50, stats_p99, stats_p999, stats_max, stats_mean, stats_batches, stats_mean_batch };
+
+enum reply_status : std::uint8_t {
+    ok = 0,
+    invalid_input = 1, // bad option kind, call/put or parameter
+    unsupported_output = 2, // an output bit this option kind does not provide
+    bad_message = 3 // unknown message type or version
+};
+
+struct request {
+    std::uint8_t type; // message_type
+    std::uint8_t version;
+    std::uint8_t option_type; // 1: European, 2: American, 3: Asian
+    std::uint8_t call_put_type; // 1: Call, 2: Put
+    std::uint32_t id; // echoed in the reply
+    double spot, strike, rate, volatility, maturity, cost_of_carry;
+    std::int32_t n_simulations; // Asian only
+    std::uint8_t outputs; // output bits
+    std::uint8_t reserved;
+    std::uint16_t n_time_steps; // Asian only
+};
+static_assert(sizeof(request) == 64, "request frames are 64 bytes");
+
+struct reply {
+    std::uint8_t type; // message_type of the request
+    std::uint8_t status; // reply_status
+    std::uint8_t outputs; // output bits filled in values
+    std::uint8_t reserved;
+    std::uint32_t id;
+    double values[8];
+};
+static_assert(sizeof(reply) == 72, "reply frames are 72 bytes");
+
+// Socket helpers; errors opening a socket throw std::runtime_error
+int listen_on(const std::string& address); // removes a stale Unix socket file first
+int connect_to(const std::string& address);
+void remove_socket(const std::string& address); // deletes the socket file of a Unix address
+// Whole-buffer transfers; false on EOF or error
+bool read_full(int fd, void* buffer, std::size_t bytes);
+bool write_full(int fd, const void* buffer, std::size_t bytes);
+
+} // namespace daemon_protocol
+
+#endif // DAEMON_PROTOCOL_HPP
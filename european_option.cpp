@@ -1,33 +1,137 @@
 // european_option.cpp
-// 
+//
 // Implementation of European Option class
 //
 // @author Mark Bogorad
-// @version 2.0 
+// @version 2.0
 
 #include "european_option.hpp"
+#include "instrumentation.hpp"
 #include "pricing_methods.hpp"
+#include "normal_math.hpp"
+#include <cmath>
 
 european_option::european_option()
-    : spot(0), strike(0), rate(0), maturity(0), volatility(0), cost_of_carry(0), option(1) {}
+    : option(1), spot(0), strike(0), rate(0), maturity(0), volatility(0), cost_of_carry(0) {}
 
 european_option::european_option(double S, double K, double r, double T, double sig, double b, int option_type)
-    : spot(S), strike(K), rate(r), maturity(T), volatility(sig), cost_of_carry(b), option(option_type) {
+    : option(option_type), spot(S), strike(K), rate(r), maturity(T), volatility(sig), cost_of_carry(b) {
     this->option_type = option_type;
 }
 
-double european_option::price() const {
-    if (option_type == CALL) {
-        return pricer.price_european_call(spot, strike, rate, maturity, volatility, cost_of_carry);
-    } else if (option_type == PUT) {
-        return pricer.price_european_put(spot, strike, rate, maturity, volatility, cost_of_carry);
-    } else {
-        throw std::domain_error("Select 1 for call or 2 for put");
+european_option::european_option(double S, double K, double r, double T, const vol_surface& surface, double b, int option_type)
+    : european_option(S, K, r, T, surface.volatility(K, T), b, option_type) {}
+
+// Cached terms (same formulas as pricing_methods::price_and_greeks_european)
+double european_option::sqrt_T() const {
+    if (!(valid & term_sqrt_T)) {
+        cached_sqrt_T = std::sqrt(maturity);
+        valid |= term_sqrt_T;
+    }
+    return cached_sqrt_T;
+}
+
+double european_option::vol_sqrt_T() const {
+    if (!(valid & term_vol_sqrt_T)) {
+        cached_vol_sqrt_T = volatility * sqrt_T();
+        valid |= term_vol_sqrt_T;
+    }
+    return cached_vol_sqrt_T;
+}
+
+double european_option::discount() const {
+    if (!(valid & term_discount)) {
+        cached_discount = std::exp(-rate * maturity);
+        valid |= term_discount;
+    }
+    return cached_discount;
+}
+
+double european_option::carry() const {
+    if (!(valid & term_carry)) {
+        cached_carry = std::exp((cost_of_carry - rate) * maturity);
+        valid |= term_carry;
     }
+    return cached_carry;
+}
+
+void european_option::update_d() const {
+    if (valid & term_d) return;
+    if (!(valid & term_log_moneyness)) {
+        cached_log_moneyness = std::log(spot / strike);
+        valid |= term_log_moneyness;
+    }
+    cached_d1 = (cached_log_moneyness + (cost_of_carry + (volatility * volatility) * 0.5) * maturity) / vol_sqrt_T();
+    cached_d2 = cached_d1 - vol_sqrt_T();
+    valid |= term_d;
+}
+
+void european_option::update_cdf() const {
+    if (valid & term_cdf) return;
+    update_d();
+    const double w = sign();
+    cached_N_d1 = normal_math::cdf(w * cached_d1);
+    cached_N_d2 = normal_math::cdf(w * cached_d2);
+    valid |= term_cdf;
+}
+
+double european_option::n_d1() const {
+    if (!(valid & term_pdf)) {
+        update_d();
+        cached_n_d1 = normal_math::pdf(cached_d1);
+        valid |= term_pdf;
+    }
+    return cached_n_d1;
+}
+
+int european_option::sign() const {
+    if (option_type == CALL) return 1;
+    if (option_type == PUT) return -1;
+    throw std::domain_error("Select 1 for call or 2 for put");
+}
+
+// Setters
+void european_option::set_spot(double S) {
+    spot = S;
+    valid &= ~spot_terms;
+}
+
+void european_option::set_strike(double K) {
+    strike = K;
+    valid &= ~spot_terms;
+}
+
+void european_option::set_rate(double r) {
+    rate = r;
+    valid &= ~(term_discount | term_carry);
+}
+
+void european_option::set_maturity(double T) {
+    maturity = T;
+    valid = 0; // every term depends on T
+}
+
+void european_option::set_volatility(double sig) {
+    volatility = sig;
+    valid &= ~vol_terms;
+}
+
+void european_option::set_cost_of_carry(double b) {
+    cost_of_carry = b;
+    valid &= ~(term_carry | term_d | term_cdf | term_pdf);
+}
+
+// price = w (S e^((b-r)T) N(w d1) - K e^(-rT) N(w d2))
+double european_option::price() const {
+    INSTRUMENT_PROBE(european_option_price);
+    const double w = sign();
+    update_cdf();
+    return w * (spot * carry() * cached_N_d1 - strike * discount() * cached_N_d2);
 }
 
 void european_option::toggle() {
     option_type = (option_type == CALL) ? PUT : CALL;
+    valid &= ~term_cdf;
 }
 
 // Put-Call Parity methods
@@ -45,40 +149,50 @@ bool european_option::pcp_check(double call_price, double put_price) const {
 
 // Greeks
 double european_option::delta() const {
-    if (option_type == CALL) {
-        return pricer.delta_call(spot, strike, rate, maturity, volatility, cost_of_carry);
-    } else if (option_type == PUT) {
-        return pricer.delta_put(spot, strike, rate, maturity, volatility, cost_of_carry);
-    } else {
-        throw std::domain_error("Select 1 for call or 2 for put");
-    }
+    const double w = sign();
+    update_cdf();
+    return w * carry() * cached_N_d1;
 }
 
 
 double european_option::gamma() const {
-    return pricer.gamma(spot, strike, rate, maturity, volatility, cost_of_carry);
+    return n_d1() * carry() / (spot * vol_sqrt_T());
 }
 
 double european_option::vega() const {
-    return pricer.vega(spot, strike, rate, maturity, volatility, cost_of_carry);
+    return spot * carry() * sqrt_T() * n_d1();
 }
 
 double european_option::theta() const {
-    if (option_type == CALL) {
-        return pricer.theta_call(spot, strike, rate, maturity, volatility, cost_of_carry);
-    } else if (option_type == PUT) {
-        return pricer.theta_put(spot, strike, rate, maturity, volatility, cost_of_carry);
-    } else {
-        throw std::domain_error("Select 1 for call or 2 for put");
-    }
+    const double w = sign();
+    update_cdf();
+    const double theta_decay = -spot * carry() * n_d1() * volatility / (2 * sqrt_T());
+    return theta_decay - w * ((cost_of_carry - rate) * spot * carry() * cached_N_d1 + rate * strike * discount() * cached_N_d2);
 }
 
 double european_option::rho() const {
-     if (option_type == CALL) {
-        return pricer.rho_call(spot, strike, rate, maturity, volatility, cost_of_carry);
-    } else if (option_type == PUT) {
-        return pricer.rho_put(spot, strike, rate, maturity, volatility, cost_of_carry);
-    } else {
-        throw std::domain_error("Select 1 for call or 2 for put");
-    }
+    if (cost_of_carry == 0.0) return -maturity * price(); // futures: only the discount moves with r
+    const double w = sign();
+    update_cdf();
+    return w * strike * maturity * discount() * cached_N_d2;
+}
+
+european_greeks european_option::price_and_greeks() const {
+    european_greeks g;
+    g.price = price();
+    g.delta = delta();
+    g.gamma = gamma();
+    g.vega = vega();
+    g.theta = theta();
+    g.rho = rho();
+    g.pcp_price = (option_type == CALL) ? g.price + strike * discount() - spot : g.price + spot - strike * discount();
+    return g;
+}
+
+pde_result european_option::price_and_greeks_pde() const {
+    return pricer.price_european_pde(spot, strike, rate, maturity, volatility, cost_of_carry, option_type);
+}
+
+double european_option::implied_volatility(double market_price) const {
+    return pricer.implied_volatility(market_price, spot, strike, rate, maturity, cost_of_carry, option_type);
 }
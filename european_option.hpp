@@ -7,15 +7,19 @@
 
 #include "option.hpp"
 #include "pricing_methods.hpp"
+#include "vol_surface.hpp"
 
 #ifndef EUROPEAN_OPTION_HPP
 #define EUROPEAN_OPTION_HPP
 
 class european_option : public option {
     friend class pricing_methods; // friend of pricing_methods to use european option variables in the calculations
+    friend class portfolio; // copies contracts into and out of its blocks
 public:
     european_option();
     european_option(double S, double K, double r, double T, double sig, double b, int option_type);
+    // Volatility read off the surface at (K, T)
+    european_option(double S, double K, double r, double T, const vol_surface& surface, double b, int option_type);
     double price() const override;
     void toggle() override;
     
@@ -31,7 +35,48 @@ public:
     double theta() const;
     double rho() const;
 
+    // Price, all Greeks and the put-call parity counterpart in one evaluation
+    european_greeks price_and_greeks() const;
+    // Crank-Nicolson grid price and Greeks, a cross-check of the closed form
+    pde_result price_and_greeks_pde() const;
+
+    // Volatility that reproduces market_price with this option's other parameters (throws if there is none)
+    double implied_volatility(double market_price) const;
+
+    // Input setters: each drops only the cached terms that depend on that input, so e.g. a spot bump reuses
+    // sqrt(T), sig sqrt(T) and both exponentials
+    void set_spot(double S);
+    void set_strike(double K);
+    void set_rate(double r);
+    void set_maturity(double T);
+    void set_volatility(double sig);
+    void set_cost_of_carry(double b);
+
 private:
+    // Derived terms, computed on first use and kept until an input they depend on changes. The cache makes const
+    // queries write to the object: share one european_option across threads only if it is not being queried.
+    enum cached_term : unsigned {
+        term_sqrt_T = 1u << 0, // sqrt(T)
+        term_vol_sqrt_T = 1u << 1, // sig sqrt(T)
+        term_discount = 1u << 2, // e^(-rT)
+        term_carry = 1u << 3, // e^((b-r)T)
+        term_log_moneyness = 1u << 4, // ln(S/K)
+        term_d = 1u << 5, // d1, d2
+        term_cdf = 1u << 6, // N(w d1), N(w d2) with w = +1 for a call, -1 for a put
+        term_pdf = 1u << 7 // n(d1)
+    };
+    static constexpr unsigned spot_terms = term_log_moneyness | term_d | term_cdf | term_pdf;
+    static constexpr unsigned vol_terms = term_vol_sqrt_T | term_d | term_cdf | term_pdf;
+
+    double sqrt_T() const;
+    double vol_sqrt_T() const;
+    double discount() const;
+    double carry() const;
+    void update_d() const;
+    void update_cdf() const;
+    double n_d1() const;
+    int sign() const; // +1 call, -1 put, throws otherwise
+
     double spot;
     double strike;
     double rate;
@@ -39,6 +84,10 @@ private:
     double volatility;
     double cost_of_carry;
     pricing_methods pricer;
+
+    mutable unsigned valid = 0; // cached_term bits currently up to date
+    mutable double cached_sqrt_T, cached_vol_sqrt_T, cached_discount, cached_carry, cached_log_moneyness;
+    mutable double cached_d1, cached_d2, cached_N_d1, cached_N_d2, cached_n_d1;
 };
 
 #endif // EUROPEAN_OPTION_HPP
@@ -34,7 +34,7 @@ void hardcoded_interface::console_pricing() {
         display_greeks(*european_opt);
         calculate_and_check_parity(*european_opt);
     } else if (option_type == 2) { // American
-        auto american_opt = std::make_unique<american_option>(spot, strike, rate, volatility, cost_of_carry, (call_put_type == 1) ? option::CALL : option::PUT);
+        auto american_opt = std::make_unique<american_option>(spot, strike, rate, maturity, volatility, cost_of_carry, (call_put_type == 1) ? option::CALL : option::PUT);
         std::cout << std::fixed << std::setprecision(5); // Set precision for floating-point numbers
         std::cout << "Option Price: " << american_opt->price() << std::endl;
     } else if (option_type == 3) { // Asian
@@ -0,0 +1,241 @@
+// instrumentation.cpp
+//
+// Per-thread stats registry, snapshot merging and JSON/Prometheus export
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#include "instrumentation.hpp"
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace instrumentation {
+
+static constexpr const char* probe_names[probe_count] = {
+    "european_price", "european_delta", "european_gamma", "european_vega", "european_theta", "european_rho",
+    "european_greeks", "european_batch", "european_greeks_batch", "implied_vol", "implied_vol_batch", "put_call_parity",
+    "american_perpetual", "american_baw", "american_bjs", "american_pde", "european_pde", "american_batch", "random_walk",
+    "asian_mc", "asian_mc_greeks", "asian_geometric", "european_option_price", "american_option_price", "asian_option_price"};
+
+const char* probe_name(probe p) {
+    return probe_names[static_cast<std::size_t>(p)];
+}
+
+// One thread's stats. The owner takes the (uncontended) mutex for every record; collect() takes it to read.
+// Every probe's stats are held inline, so recording never allocates; `used` keeps merging and clearing to the probes
+// the thread touched.
+struct thread_stats {
+    std::mutex mutex;
+    std::array<probe_stats, probe_count> probes;
+    std::uint32_t used = 0; // bit p set once probe p has recorded
+    mc_counters mc;
+
+    void merge_into(snapshot& s) const {
+        for (std::size_t p = 0; p < probe_count; ++p) {
+            if (!(used >> p & 1u)) continue;
+            s.probes[p].calls += probes[p].calls;
+            s.probes[p].items += probes[p].items;
+            s.probes[p].latency.merge(probes[p].latency);
+        }
+        s.mc.paths += mc.paths;
+        s.mc.steps += mc.steps;
+        s.mc.rng_draws += mc.rng_draws;
+    }
+    void clear() {
+        for (std::size_t p = 0; p < probe_count; ++p) {
+            if (!(used >> p & 1u)) continue;
+            probes[p].calls = 0;
+            probes[p].items = 0;
+            probes[p].latency.reset();
+        }
+        used = 0;
+        mc = mc_counters();
+    }
+};
+static_assert(probe_count <= 32, "thread_stats::used has one bit per probe");
+
+// Live threads, stats left behind by exited threads (cleared, for the next thread to take), and everything merged
+// from threads that have exited. New stats are made only when more threads are alive at once than ever before, so
+// short-lived pricing threads do no heap work here.
+struct stats_registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<thread_stats>> owned;
+    std::vector<thread_stats*> live, spare; // capacity kept at owned.size(), so moving between them never allocates
+    snapshot retired;
+};
+
+static stats_registry& registry() {
+    static stats_registry instance;
+    return instance;
+}
+
+// Takes stats from the registry on the thread's first record and hands them back, merged and cleared, on exit
+struct thread_slot {
+    thread_stats* stats;
+
+    thread_slot() {
+        stats_registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        if (r.spare.empty()) {
+            r.owned.push_back(std::make_unique<thread_stats>());
+            r.live.reserve(r.owned.size());
+            r.spare.reserve(r.owned.size());
+            r.spare.push_back(r.owned.back().get());
+        }
+        stats = r.spare.back();
+        r.spare.pop_back();
+        r.live.push_back(stats);
+    }
+    ~thread_slot() {
+        stats_registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        {
+            std::lock_guard<std::mutex> thread_lock(stats->mutex);
+            stats->merge_into(r.retired);
+            stats->clear();
+        }
+        std::erase(r.live, stats);
+        r.spare.push_back(stats);
+    }
+};
+
+static thread_stats& local_stats() {
+    thread_local thread_slot slot;
+    return *slot.stats;
+}
+
+void record(probe p, std::uint64_t nanoseconds, std::uint64_t items) {
+    thread_stats& t = local_stats();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    probe_stats& stats = t.probes[static_cast<std::size_t>(p)];
+    t.used |= 1u << static_cast<unsigned>(p);
+    ++stats.calls;
+    stats.items += items;
+    stats.latency.record(nanoseconds);
+}
+
+void count_mc(std::uint64_t paths, std::uint64_t steps, std::uint64_t rng_draws) {
+    thread_stats& t = local_stats();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    t.mc.paths += paths;
+    t.mc.steps += steps;
+    t.mc.rng_draws += rng_draws;
+}
+
+snapshot collect() {
+    stats_registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    snapshot s = r.retired;
+    for (thread_stats* t : r.live) {
+        std::lock_guard<std::mutex> thread_lock(t->mutex);
+        t->merge_into(s);
+    }
+    return s;
+}
+
+void reset() {
+    stats_registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.retired = snapshot();
+    for (thread_stats* t : r.live) {
+        std::lock_guard<std::mutex> thread_lock(t->mutex);
+        t->clear();
+    }
+}
+
+// Export
+static std::string number(double value) {
+    char buffer[32];
+    return std::string(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value).ptr);
+}
+
+static constexpr double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+static constexpr const char* quantile_keys[] = {"p50", "p90", "p99", "p999"};
+
+std::string to_json(const snapshot& s) {
+    std::string out = "{\"enabled\":";
+    out += enabled ? "true" : "false";
+    out += ",\"pricers\":{";
+    bool first = true;
+    for (std::size_t p = 0; p < probe_count; ++p) {
+        const probe_stats& stats = s.probes[p];
+        if (stats.calls == 0) continue;
+        out += first ? "\"" : ",\"";
+        first = false;
+        out += probe_names[p];
+        out += "\":{\"calls\":" + std::to_string(stats.calls) + ",\"items\":" + std::to_string(stats.items);
+        out += ",\"latency_ns\":{\"mean\":" + number(stats.latency.mean());
+        for (std::size_t q = 0; q < std::size(quantiles); ++q) {
+            out += ",\"" + std::string(quantile_keys[q]) + "\":" + number(stats.latency.percentile(quantiles[q]));
+        }
+        out += ",\"max\":" + std::to_string(stats.latency.max()) + "}}";
+    }
+    out += "},\"monte_carlo\":{\"paths\":" + std::to_string(s.mc.paths) + ",\"steps\":" + std::to_string(s.mc.steps)
+           + ",\"rng_draws\":" + std::to_string(s.mc.rng_draws) + "}}\n";
+    return out;
+}
+
+std::string to_prometheus(const snapshot& s) {
+    std::string out;
+    auto series = [&](const char* metric, std::size_t p, const std::string& extra, const std::string& value) {
+        out += std::string(metric) + "{pricer=\"" + probe_names[p] + "\"" + extra + "} " + value + "\n";
+    };
+    out += "# HELP option_pricer_calls_total Calls per pricing entry point.\n# TYPE option_pricer_calls_total counter\n";
+    for (std::size_t p = 0; p < probe_count; ++p) {
+        if (s.probes[p].calls) series("option_pricer_calls_total", p, "", std::to_string(s.probes[p].calls));
+    }
+    out += "# HELP option_pricer_items_total Contracts priced per entry point (batch calls count every contract).\n"
+           "# TYPE option_pricer_items_total counter\n";
+    for (std::size_t p = 0; p < probe_count; ++p) {
+        if (s.probes[p].calls) series("option_pricer_items_total", p, "", std::to_string(s.probes[p].items));
+    }
+    out += "# HELP option_pricer_latency_seconds Latency per call.\n# TYPE option_pricer_latency_seconds summary\n";
+    for (std::size_t p = 0; p < probe_count; ++p) {
+        const probe_stats& stats = s.probes[p];
+        if (stats.calls == 0) continue;
+        for (const double q : quantiles) {
+            series("option_pricer_latency_seconds", p, ",quantile=\"" + number(q) + "\"", number(stats.latency.percentile(q) * 1e-9));
+        }
+        series("option_pricer_latency_seconds_sum", p, "", number(stats.latency.mean() * static_cast<double>(stats.latency.count()) * 1e-9));
+        series("option_pricer_latency_seconds_count", p, "", std::to_string(stats.latency.count()));
+    }
+    out += "# HELP option_pricer_mc_paths_total Monte-Carlo paths simulated.\n# TYPE option_pricer_mc_paths_total counter\n";
+    out += "option_pricer_mc_paths_total " + std::to_string(s.mc.paths) + "\n";
+    out += "# HELP option_pricer_mc_steps_total Monte-Carlo path steps.\n# TYPE option_pricer_mc_steps_total counter\n";
+    out += "option_pricer_mc_steps_total " + std::to_string(s.mc.steps) + "\n";
+    out += "# HELP option_pricer_mc_rng_draws_total Monte-Carlo random variates drawn.\n# TYPE option_pricer_mc_rng_draws_total counter\n";
+    out += "option_pricer_mc_rng_draws_total " + std::to_string(s.mc.rng_draws) + "\n";
+    return out;
+}
+
+void export_snapshot(const snapshot& s, const std::string& format, const std::string& path) {
+    std::string text;
+    if (format == "json") text = to_json(s);
+    else if (format == "prometheus") text = to_prometheus(s);
+    else throw std::invalid_argument("Error: metrics format must be json or prometheus");
+    if (path.empty() || path == "-") {
+        std::cout << text << std::flush;
+        return;
+    }
+    std::ofstream file(path);
+    if (!file) throw std::runtime_error("Error: could not open " + path);
+    file << text;
+}
+
+void export_from_environment() {
+    const char* setting = std::getenv("OPTION_PRICER_METRICS");
+    if (!setting || !*setting) return;
+    const std::string value = setting;
+    const std::size_t colon = value.find(':');
+    export_snapshot(collect(), value.substr(0, colon), colon == std::string::npos ? "-" : value.substr(colon + 1));
+}
+
+} // namespace instrumentation
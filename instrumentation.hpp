@@ -0,0 +1,131 @@
+// instrumentation.hpp
+//
+// Low-overhead counters and latency histograms on the pricing entry points, for finding where pricing time goes
+// in production without a profiler. Each thread records into its own stats (calls, items and a latency_histogram
+// per probe, plus Monte-Carlo path/step/RNG-draw counters); collect() merges every thread on demand, including
+// threads that have finished. Timings are inclusive: a probe that calls another instrumented routine counts the
+// inner call in both.
+//
+// A timed call costs two steady_clock reads and an uncontended lock (~70 ns on a VM) and never allocates, not even on
+// a thread's first call: per-thread stats are recycled from threads that have exited. Batch entry points are timed
+// once per call, so the cost disappears into the batch. Recording compiles out entirely unless the build sets
+// OPTION_PRICER_INSTRUMENTATION (CMake option of the same name, OFF by default): the INSTRUMENT_* macros expand to
+// nothing and collect() returns an empty snapshot. The export functions are always available, so callers need no
+// #ifdefs.
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#ifndef INSTRUMENTATION_HPP
+#define INSTRUMENTATION_HPP
+
+#include "latency_histogram.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace instrumentation {
+
+#ifdef OPTION_PRICER_INSTRUMENTATION
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+// Instrumented entry points (pricing_methods routines and option::price() overrides)
+enum class probe : std::uint8_t {
+    european_price,
+    european_delta,
+    european_gamma,
+    european_vega,
+    european_theta,
+    european_rho,
+    european_greeks,
+    european_batch,
+    european_greeks_batch,
+    implied_vol,
+    implied_vol_batch,
+    put_call_parity,
+    american_perpetual,
+    american_baw,
+    american_bjs,
+    american_pde,
+    european_pde,
+    american_batch,
+    random_walk,
+    asian_mc,
+    asian_mc_greeks,
+    asian_geometric,
+    european_option_price,
+    american_option_price,
+    asian_option_price,
+    count
+};
+inline constexpr std::size_t probe_count = static_cast<std::size_t>(probe::count);
+const char* probe_name(probe p);
+
+struct probe_stats {
+    std::uint64_t calls = 0;
+    std::uint64_t items = 0; // contracts for batch probes, otherwise equal to calls
+    latency_histogram latency; // nanoseconds
+};
+
+struct mc_counters {
+    std::uint64_t paths = 0; // simulated paths, mirrored antithetic paths included
+    std::uint64_t steps = 0; // path steps (paths x time steps)
+    std::uint64_t rng_draws = 0; // Gaussian (or Sobol) variates drawn
+};
+
+struct snapshot {
+    std::vector<probe_stats> probes = std::vector<probe_stats>(probe_count); // indexed by probe, heap-held (~15 KB each)
+    mc_counters mc;
+};
+
+// Merge of every thread's stats so far
+snapshot collect();
+void reset();
+
+std::string to_json(const snapshot& s);
+std::string to_prometheus(const snapshot& s);
+// format is "json" or "prometheus"; path "-" writes to stdout
+void export_snapshot(const snapshot& s, const std::string& format, const std::string& path = "-");
+// Exports collect() if OPTION_PRICER_METRICS is set to "json" or "prometheus", optionally followed by ":path"
+void export_from_environment();
+
+// Recording, normally through the macros below
+void record(probe p, std::uint64_t nanoseconds, std::uint64_t items);
+void count_mc(std::uint64_t paths, std::uint64_t steps, std::uint64_t rng_draws);
+
+class scoped_timer {
+public:
+    explicit scoped_timer(probe p, std::uint64_t items = 1) : p(p), items(items), start(std::chrono::steady_clock::now()) {}
+    ~scoped_timer() {
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        record(p, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()), items);
+    }
+    scoped_timer(const scoped_timer&) = delete;
+    scoped_timer& operator=(const scoped_timer&) = delete;
+
+private:
+    probe p;
+    std::uint64_t items;
+    std::chrono::steady_clock::time_point start;
+};
+
+} // namespace instrumentation
+
+#ifdef OPTION_PRICER_INSTRUMENTATION
+#define INSTRUMENT_PROBE(name) const instrumentation::scoped_timer instrumentation_timer_(instrumentation::probe::name)
+#define INSTRUMENT_PROBE_ITEMS(name, items) \
+    const instrumentation::scoped_timer instrumentation_timer_(instrumentation::probe::name, static_cast<std::uint64_t>(items))
+#define INSTRUMENT_MC(paths, steps, rng_draws) \
+    instrumentation::count_mc(static_cast<std::uint64_t>(paths), static_cast<std::uint64_t>(steps), static_cast<std::uint64_t>(rng_draws))
+#else
+#define INSTRUMENT_PROBE(name) static_cast<void>(0)
+#define INSTRUMENT_PROBE_ITEMS(name, items) static_cast<void>(0)
+#define INSTRUMENT_MC(paths, steps, rng_draws) static_cast<void>(0)
+#endif
+
+#endif // INSTRUMENTATION_HPP
@@ -0,0 +1,488 @@
+// jsonl_interface.cpp
+//
+// Implementation of the JSONL batch interface: request parser, pricing stage and pipeline
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#include "jsonl_interface.hpp"
+#include "bounded_queue.hpp"
+#include "parallel.hpp"
+#include "pricing_methods.hpp"
+#include "option.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <semaphore>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Outputs a request can ask for, in the spelling used on the wire
+enum class request_output : std::uint8_t { price, delta, gamma, vega, theta, rho, pcp_price, std_error };
+static constexpr std::string_view output_names[] = {"price", "delta", "gamma", "vega", "theta", "rho", "pcp_price", "std_error"};
+static constexpr std::size_t max_outputs = std::size(output_names);
+
+struct pricing_request {
+    std::string id; // raw JSON token, echoed back as is
+    int option_type = 0; // 1: European, 2: American, 3: Asian
+    int call_put_type = 0; // 1: Call, 2: Put
+    double spot = std::numeric_limits<double>::quiet_NaN();
+    double strike = std::numeric_limits<double>::quiet_NaN();
+    double rate = std::numeric_limits<double>::quiet_NaN();
+    double volatility = std::numeric_limits<double>::quiet_NaN();
+    double maturity = std::numeric_limits<double>::quiet_NaN();
+    double cost_of_carry = std::numeric_limits<double>::quiet_NaN();
+    int n_simulations = 10000;
+    int n_time_steps = 252;
+    std::uint64_t seed = 42;
+    request_output outputs[max_outputs];
+    double values[max_outputs];
+    std::size_t n_outputs = 0;
+    std::string error; // set by the parser or the pricer; the request is answered with it
+};
+
+struct request_batch {
+    std::size_t sequence = 0;
+    std::vector<pricing_request> requests;
+};
+
+// Request parser
+// Just enough JSON for one flat object per line: string, number, true/false/null and arrays of strings
+struct json_cursor {
+    std::string_view text;
+    std::size_t pos = 0;
+
+    void skip_space() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n')) ++pos;
+    }
+    bool consume(char c) {
+        skip_space();
+        if (pos < text.size() && text[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+    char peek() {
+        skip_space();
+        return pos < text.size() ? text[pos] : '\0';
+    }
+    void expect(char c) {
+        if (!consume(c)) throw std::invalid_argument(std::string("expected '") + c + "'");
+    }
+    std::string string_value() {
+        expect('"');
+        std::string value;
+        while (pos < text.size() && text[pos] != '"') {
+            char c = text[pos++];
+            if (c == '\\') {
+                if (pos >= text.size()) break;
+                c = text[pos++];
+                if (c == 'n') c = '\n';
+                else if (c == 't') c = '\t';
+                else if (c != '"' && c != '\\' && c != '/') throw std::invalid_argument("unsupported escape in string");
+            }
+            value += c;
+        }
+        expect('"');
+        return value;
+    }
+    double number_value() {
+        skip_space();
+        double value;
+        const auto result = std::from_chars(text.data() + pos, text.data() + text.size(), value);
+        if (result.ec != std::errc()) throw std::invalid_argument("expected a number");
+        pos = result.ptr - text.data();
+        return value;
+    }
+    // Raw text of the next string or number (used for the id)
+    std::string_view raw_scalar() {
+        skip_space();
+        const std::size_t first = pos;
+        if (peek() == '"') {
+            string_value();
+        } else {
+            number_value();
+        }
+        return text.substr(first, pos - first);
+    }
+    void skip_value() {
+        const char c = peek();
+        if (c == '"') {
+            string_value();
+        } else if (c == '[') {
+            expect('[');
+            if (consume(']')) return;
+            do skip_value(); while (consume(','));
+            expect(']');
+        } else if (c == '{') {
+            throw std::invalid_argument("nested objects are not supported");
+        } else if (c == 't' || c == 'f' || c == 'n') {
+            while (pos < text.size() && text[pos] >= 'a' && text[pos] <= 'z') ++pos;
+        } else {
+            number_value();
+        }
+    }
+};
+
+static int whole_number(json_cursor& json, const std::string& key) {
+    const double value = json.number_value();
+    if (value != std::floor(value) || std::fabs(value) > std::numeric_limits<int>::max()) {
+        throw std::invalid_argument(key + " must be an integer");
+    }
+    return static_cast<int>(value);
+}
+
+static void parse_outputs(json_cursor& json, pricing_request& request) {
+    request.n_outputs = 0;
+    json.expect('[');
+    if (json.consume(']')) return;
+    do {
+        const std::string name = json.string_value();
+        std::size_t k = 0;
+        while (k < max_outputs && output_names[k] != name) ++k;
+        if (k == max_outputs) throw std::invalid_argument("unknown output " + name);
+        for (std::size_t j = 0; j < request.n_outputs; ++j) {
+            if (request.outputs[j] == static_cast<request_output>(k)) throw std::invalid_argument("output " + name + " requested twice");
+        }
+        request.outputs[request.n_outputs++] = static_cast<request_output>(k);
+    } while (json.consume(','));
+    json.expect(']');
+}
+
+static void parse_request_fields(json_cursor& json, pricing_request& request) {
+    bool outputs_given = false;
+    json.expect('{');
+    if (!json.consume('}')) {
+        do {
+            const std::string key = json.string_value();
+            json.expect(':');
+            if (key == "id") request.id = json.raw_scalar();
+            else if (key == "kind") {
+                const std::string kind = json.string_value();
+                if (kind == "european") request.option_type = 1;
+                else if (kind == "american") request.option_type = 2;
+                else if (kind == "asian") request.option_type = 3;
+                else throw std::invalid_argument("unknown kind " + kind);
+            } else if (key == "type") {
+                const std::string type = json.string_value();
+                if (type == "call") request.call_put_type = 1;
+                else if (type == "put") request.call_put_type = 2;
+                else throw std::invalid_argument("type must be call or put");
+            }
+            else if (key == "option_type") request.option_type = whole_number(json, key);
+            else if (key == "call_put_type") request.call_put_type = whole_number(json, key);
+            else if (key == "spot") request.spot = json.number_value();
+            else if (key == "strike") request.strike = json.number_value();
+            else if (key == "rate") request.rate = json.number_value();
+            else if (key == "volatility") request.volatility = json.number_value();
+            else if (key == "maturity") request.maturity = json.number_value();
+            else if (key == "cost_of_carry") request.cost_of_carry = json.number_value();
+            else if (key == "nSimulations") request.n_simulations = whole_number(json, key);
+            else if (key == "nTimeSteps") request.n_time_steps = whole_number(json, key);
+            else if (key == "seed") request.seed = static_cast<std::uint64_t>(whole_number(json, key));
+            else if (key == "outputs") {
+                parse_outputs(json, request);
+                outputs_given = true;
+            }
+            else json.skip_value(); // unknown keys are ignored
+        } while (json.consume(','));
+        json.expect('}');
+    }
+    json.skip_space();
+    if (json.pos != json.text.size()) {
+        throw std::invalid_argument("trailing characters after the request");
+    }
+
+    if (request.option_type < 1 || request.option_type > 3) throw std::invalid_argument("kind must be european, american or asian");
+    if (request.call_put_type != 1 && request.call_put_type != 2) throw std::invalid_argument("type must be call or put");
+    const std::pair<const char*, double> required[] = {{"spot", request.spot}, {"strike", request.strike}, {"rate", request.rate},
+                                                       {"volatility", request.volatility}, {"maturity", request.maturity}};
+    for (const auto& [name, value] : required) {
+        if (std::isnan(value)) throw std::invalid_argument(std::string("missing ") + name);
+    }
+    if (std::isnan(request.cost_of_carry)) request.cost_of_carry = request.rate; // no dividends
+
+    // The daemon's input checks: the kernels assume finite inputs, and positive spot, strike, volatility and maturity
+    for (const auto& [name, value] : required) {
+        if (!std::isfinite(value)) throw std::invalid_argument(std::string(name) + " must be finite");
+    }
+    if (!std::isfinite(request.cost_of_carry)) throw std::invalid_argument("cost_of_carry must be finite");
+    const std::pair<const char*, double> positive[] = {{"spot", request.spot}, {"strike", request.strike}, {"volatility", request.volatility},
+                                                       {"maturity", request.maturity}};
+    for (const auto& [name, value] : positive) {
+        if (!(value > 0)) throw std::invalid_argument(std::string(name) + " must be positive");
+    }
+    if (request.option_type == 3 && (request.n_simulations <= 0 || request.n_time_steps <= 0)) {
+        throw std::invalid_argument("nSimulations and nTimeSteps must be positive");
+    }
+    if (!outputs_given) request.outputs[request.n_outputs++] = request_output::price;
+}
+
+// Parses one line; failures are recorded in request.error instead of thrown
+static void parse_request(std::string_view line, std::size_t line_number, pricing_request& request) {
+    json_cursor json{line};
+    try {
+        parse_request_fields(json, request);
+    } catch (const std::exception& e) {
+        request.error = e.what();
+    }
+    if (request.id.empty()) request.id = std::to_string(line_number);
+}
+
+// Pricing stage
+static bool wants_only_price(const pricing_request& request) {
+    return request.n_outputs == 1 && request.outputs[0] == request_output::price;
+}
+
+// Fills values[k] for every requested output of one request priced on its own
+static void price_request(const pricing_methods& pricer, pricing_request& request) {
+    const int type = (request.call_put_type == 1) ? option::CALL : option::PUT;
+    auto fill = [&](auto&& value_of) {
+        for (std::size_t k = 0; k < request.n_outputs; ++k) request.values[k] = value_of(request.outputs[k]);
+    };
+    auto unsupported = [&](request_output output, const char* kind) -> double {
+        throw std::invalid_argument(std::string(output_names[static_cast<std::size_t>(output)]) + " is not available for " + kind + " options");
+    };
+
+    if (request.option_type == 1) { // European
+        const european_greeks g = pricer.price_and_greeks_european(request.spot, request.strike, request.rate, request.maturity,
+                                                                   request.volatility, request.cost_of_carry, type);
+        fill([&](request_output output) {
+            switch (output) {
+            case request_output::price: return g.price;
+            case request_output::delta: return g.delta;
+            case request_output::gamma: return g.gamma;
+            case request_output::vega: return g.vega;
+            case request_output::theta: return g.theta;
+            case request_output::rho: return g.rho;
+            case request_output::pcp_price: return g.pcp_price;
+            default: return unsupported(output, "European");
+            }
+        });
+    } else if (request.option_type == 2) { // American: Bjerksund-Stensland as in the batch kernel, Greeks bumped on the same formula
+        const american_greeks g = pricer.price_and_greeks_american(request.spot, request.strike, request.rate, request.maturity, request.volatility,
+                                                                   request.cost_of_carry, type, american_method::bjerksund_stensland);
+        fill([&](request_output output) {
+            switch (output) {
+            case request_output::price: return g.price;
+            case request_output::delta: return g.delta;
+            case request_output::gamma: return g.gamma;
+            case request_output::vega: return g.vega;
+            case request_output::theta: return g.theta;
+            case request_output::rho: return g.rho;
+            default: return unsupported(output, "American");
+            }
+        });
+    } else { // Asian; the pipeline already keeps every core busy, so each simulation runs on one thread
+        asian_mc_config config;
+        config.n_threads = 1;
+        config.seed = request.seed;
+        const mc_result result = pricer.price_asian_mc(request.spot, request.strike, request.maturity, request.rate, request.volatility,
+                                                       request.cost_of_carry, request.n_time_steps, request.n_simulations, type, config);
+        fill([&](request_output output) {
+            if (output == request_output::price) return result.price;
+            if (output == request_output::std_error) return result.std_error;
+            return unsupported(output, "Asian");
+        });
+    }
+}
+
+// Structure-of-arrays staging for the batch kernels, reused between batches by each worker
+struct batch_inputs {
+    std::vector<std::size_t> index;
+    std::vector<double> S, K, r, T, sig, b, prices;
+    std::vector<int> type;
+
+    void clear() {
+        for (auto* column : {&S, &K, &r, &T, &sig, &b, &prices}) column->clear();
+        index.clear();
+        type.clear();
+    }
+    void add(std::size_t i, const pricing_request& request) {
+        index.push_back(i);
+        S.push_back(request.spot);
+        K.push_back(request.strike);
+        r.push_back(request.rate);
+        T.push_back(request.maturity);
+        sig.push_back(request.volatility);
+        b.push_back(request.cost_of_carry);
+        type.push_back((request.call_put_type == 1) ? option::CALL : option::PUT);
+    }
+};
+
+// Price-only European and American requests go through the batch kernels; everything else is priced one by one
+static void price_batch(const pricing_methods& pricer, request_batch& batch, batch_inputs& european, batch_inputs& american) {
+    european.clear();
+    american.clear();
+    for (std::size_t i = 0; i < batch.requests.size(); ++i) {
+        pricing_request& request = batch.requests[i];
+        if (!request.error.empty()) continue;
+        if (wants_only_price(request) && request.option_type == 1) {
+            european.add(i, request);
+        } else if (wants_only_price(request) && request.option_type == 2) {
+            american.add(i, request);
+        } else {
+            try {
+                price_request(pricer, request);
+            } catch (const std::exception& e) {
+                request.error = e.what();
+            }
+        }
+    }
+    if (!european.index.empty()) {
+        european.prices.resize(european.index.size());
+        pricer.price_european_batch(european.S, european.K, european.r, european.T, european.sig, european.b, european.type, european.prices);
+        for (std::size_t j = 0; j < european.index.size(); ++j) batch.requests[european.index[j]].values[0] = european.prices[j];
+    }
+    if (!american.index.empty()) {
+        american.prices.resize(american.index.size());
+        pricer.price_american_batch(american.S, american.K, american.r, american.T, american.sig, american.b, american.type,
+                                    american_method::bjerksund_stensland, american.prices);
+        for (std::size_t j = 0; j < american.index.size(); ++j) batch.requests[american.index[j]].values[0] = american.prices[j];
+    }
+}
+
+// Serialization
+static void append_json_string(std::string& out, std::string_view text) {
+    out += '"';
+    for (const char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (c == '\n') out += "\\n";
+        else if (c == '\t') out += "\\t";
+        else out += c;
+    }
+    out += '"';
+}
+
+static void append_number(std::string& out, double value) {
+    if (!std::isfinite(value)) { // JSON has no NaN or infinity
+        out += "null";
+        return;
+    }
+    char buffer[32];
+    out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value).ptr);
+}
+
+static void serialize(const pricing_request& request, std::string& out) {
+    out += "{\"id\":";
+    out += request.id;
+    if (!request.error.empty()) {
+        out += ",\"error\":";
+        append_json_string(out, request.error);
+    } else {
+        for (std::size_t k = 0; k < request.n_outputs; ++k) {
+            out += ",\"";
+            out += output_names[static_cast<std::size_t>(request.outputs[k])];
+            out += "\":";
+            append_number(out, request.values[k]);
+        }
+    }
+    out += "}\n";
+}
+
+jsonl_interface::jsonl_interface() : jsonl_interface("-") {}
+
+jsonl_interface::jsonl_interface(const std::string& input_path, const std::string& output_path)
+    : input_path(input_path), output_path(output_path), n_threads(0), batch_size(256) {}
+
+void jsonl_interface::set_threads(unsigned n_threads) {
+    this->n_threads = n_threads;
+}
+
+void jsonl_interface::set_batch_size(std::size_t batch_size) {
+    this->batch_size = std::max<std::size_t>(batch_size, 1);
+}
+
+void jsonl_interface::display_results() {
+    std::ifstream in_file;
+    std::ofstream out_file;
+    if (input_path != "-") {
+        in_file.open(input_path);
+        if (!in_file) throw std::runtime_error("Error: could not open " + input_path);
+    }
+    if (!output_path.empty() && output_path != "-") {
+        out_file.open(output_path, std::ios::binary);
+        if (!out_file) throw std::runtime_error("Error: could not open " + output_path);
+    }
+    std::istream& in = (input_path != "-") ? static_cast<std::istream&>(in_file) : std::cin;
+    std::ostream& out = out_file.is_open() ? static_cast<std::ostream&>(out_file) : std::cout;
+    run(in, out);
+}
+
+// Pipeline: parse (calling thread) -> priced by n workers -> reordered and written by one writer. Batches are numbered
+// as they are read; a semaphore taken per batch by the reader and given back by the writer caps the batches alive at
+// once (queued, being priced, or waiting to be put back in order).
+std::size_t jsonl_interface::run(std::istream& in, std::ostream& out) const {
+    const unsigned workers = parallel::resolve_threads(n_threads);
+    const std::size_t max_in_flight = 2 * static_cast<std::size_t>(workers) + 2;
+    bounded_queue<request_batch> to_price(workers + 1), to_write(workers + 1);
+    std::counting_semaphore<> in_flight(static_cast<std::ptrdiff_t>(max_in_flight));
+
+    std::vector<std::thread> pricers;
+    pricers.reserve(workers);
+    for (unsigned t = 0; t < workers; ++t) {
+        pricers.emplace_back([&] {
+            const pricing_methods pricer;
+            batch_inputs european, american;
+            request_batch batch;
+            while (to_price.pop(batch)) {
+                price_batch(pricer, batch, european, american);
+                to_write.push(std::move(batch));
+            }
+        });
+    }
+
+    std::thread writer([&] {
+        std::map<std::size_t, request_batch> pending;
+        std::size_t next = 0;
+        std::string text;
+        request_batch batch;
+        while (to_write.pop(batch)) {
+            pending.emplace(batch.sequence, std::move(batch));
+            for (auto it = pending.begin(); it != pending.end() && it->first == next; it = pending.erase(it), ++next) {
+                text.clear();
+                for (const pricing_request& request : it->second.requests) serialize(request, text);
+                out.write(text.data(), static_cast<std::streamsize>(text.size()));
+                in_flight.release();
+            }
+        }
+        out.flush();
+    });
+
+    std::size_t n_requests = 0, line_number = 0, sequence = 0;
+    std::string line;
+    request_batch batch;
+    auto send = [&] {
+        batch.sequence = sequence++;
+        to_price.push(std::move(batch));
+        batch = request_batch();
+    };
+    while (std::getline(in, line)) {
+        ++line_number;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue; // blank lines get no answer
+        if (batch.requests.empty()) {
+            in_flight.acquire();
+            batch.requests.reserve(batch_size);
+        }
+        batch.requests.emplace_back();
+        parse_request(line, line_number, batch.requests.back());
+        ++n_requests;
+        if (batch.requests.size() == batch_size) send();
+    }
+    if (!batch.requests.empty()) send();
+
+    to_price.close();
+    for (auto& thread : pricers) thread.join();
+    to_write.close();
+    writer.join();
+    if (!out) throw std::runtime_error("Error: failed writing batch results");
+    return n_requests;
+}
@@ -0,0 +1,59 @@
+// jsonl_interface.hpp
+//
+// Batch pricing of JSONL requests (one JSON object per line) from a file or stdin, results written as JSONL in
+// request order. Example request:
+//
+//   {"id": 7, "kind": "european", "type": "call", "spot": 100, "strike": 95, "rate": 0.05, "volatility": 0.2,
+//    "maturity": 1, "cost_of_carry": 0.05, "outputs": ["price", "delta", "gamma"]}
+//
+// kind is european, american or asian (or option_type 1/2/3), type is call or put (or call_put_type 1/2), and the
+// numeric keys are the ones used in options.txt. cost_of_carry defaults to rate, nSimulations/nTimeSteps to 10000/252
+// and seed to 42 (Asian only); outputs default to ["price"]. European options offer price, delta, gamma, vega, theta,
+// rho and pcp_price; American options price, delta, gamma, vega, theta and rho, all from Bjerksund-Stensland (the
+// Greeks by central differences of its price); Asian options price and std_error. The id (any JSON number or string, line number if absent) is
+// echoed back:
+//
+//   {"id":7,"price":10.45,"delta":0.63,"gamma":0.019}
+//
+// Inputs are checked as the daemon checks them: every number finite, spot, strike, volatility and maturity positive,
+// and nSimulations and nTimeSteps positive for Asian options. A request that fails the checks or cannot be parsed or
+// priced gives {"id":...,"error":"..."} and the batch carries on.
+//
+// The run is a three-stage pipeline: the calling thread reads and parses lines into micro-batches, a pool of
+// workers prices whole batches (price-only European and American requests go through the batch kernels), and a
+// writer thread puts batches back in order and serializes them. Stages are connected by bounded queues and the
+// number of batches in flight is capped, so memory stays bounded for any input size.
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#ifndef JSONL_INTERFACE_HPP
+#define JSONL_INTERFACE_HPP
+
+#include "interfaces.hpp"
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+
+class jsonl_interface : public interfaces {
+public:
+    jsonl_interface(); // stdin to stdout
+    // Input file ("-" = stdin) and output file ("" or "-" = stdout)
+    explicit jsonl_interface(const std::string& input_path, const std::string& output_path = "");
+    void display_results() override; // Runs the batch
+
+    // Pricing workers (0 = all cores) and requests per micro-batch
+    void set_threads(unsigned n_threads);
+    void set_batch_size(std::size_t batch_size);
+
+    // Prices every request read from in and writes the results to out; returns the number of requests
+    std::size_t run(std::istream& in, std::ostream& out) const;
+
+private:
+    std::string input_path;
+    std::string output_path;
+    unsigned n_threads;
+    std::size_t batch_size;
+};
+
+#endif // JSONL_INTERFACE_HPP
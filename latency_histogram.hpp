@@ -0,0 +1,79 @@
+// latency_histogram.hpp
+//
+// Log-linear latency histogram in the spirit of HdrHistogram: every power of two is split into 32 linear
+// sub-buckets, so any recorded value is reported to within ~3% over the full 64-bit range with a fixed 16 KB of
+// counters and O(1) recording. Not thread-safe; give each thread its own and merge.
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#ifndef LATENCY_HISTOGRAM_HPP
+#define LATENCY_HISTOGRAM_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+class latency_histogram {
+public:
+    void record(std::uint64_t value) {
+        ++counts[bucket(value)];
+        ++n;
+        sum += static_cast<double>(value);
+        largest = std::max(largest, value);
+    }
+
+    void merge(const latency_histogram& other) {
+        for (std::size_t i = 0; i < counts.size(); ++i) counts[i] += other.counts[i];
+        n += other.n;
+        sum += other.sum;
+        largest = std::max(largest, other.largest);
+    }
+
+    void reset() { *this = latency_histogram(); }
+
+    std::uint64_t count() const { return n; }
+    std::uint64_t max() const { return largest; }
+    double mean() const { return n ? sum / static_cast<double>(n) : 0.0; }
+
+    // Value at quantile q in [0, 1] (midpoint of the bucket holding it, never above the recorded maximum)
+    double percentile(double q) const {
+        if (n == 0) return 0.0;
+        const std::uint64_t rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(q * static_cast<double>(n) + 0.5));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            if (seen >= rank) return std::min(bucket_midpoint(i), static_cast<double>(largest));
+        }
+        return static_cast<double>(largest);
+    }
+
+    // Bucket layout, shared with the exporters
+    static constexpr unsigned sub_bucket_bits = 5;
+    static constexpr std::size_t sub_buckets = std::size_t(1) << sub_bucket_bits;
+    static constexpr std::size_t bucket_count = (64 - sub_bucket_bits + 1) * sub_buckets;
+
+    static std::size_t bucket(std::uint64_t value) {
+        if (value < sub_buckets) return static_cast<std::size_t>(value);
+        const unsigned exponent = static_cast<unsigned>(std::bit_width(value)) - 1; // >= sub_bucket_bits
+        const std::size_t sub = static_cast<std::size_t>(value >> (exponent - sub_bucket_bits)) & (sub_buckets - 1);
+        return (exponent - sub_bucket_bits + 1) * sub_buckets + sub;
+    }
+
+    static double bucket_midpoint(std::size_t index) {
+        if (index < sub_buckets) return static_cast<double>(index);
+        const unsigned shift = static_cast<unsigned>(index / sub_buckets) - 1;
+        const double lower = static_cast<double>((sub_buckets + index % sub_buckets) << shift);
+        return lower + 0.5 * static_cast<double>(std::uint64_t(1) << shift) - 0.5;
+    }
+
+private:
+    std::array<std::uint64_t, bucket_count> counts{};
+    std::uint64_t n = 0;
+    std::uint64_t largest = 0;
+    double sum = 0.0;
+};
+
+#endif // LATENCY_HISTOGRAM_HPP
@@ -0,0 +1,141 @@
+// load_generator.cpp
+//
+// Load generator for the pricing daemon. Opens several connections, keeps a window of requests in flight on each,
+// and reports throughput and client-side round-trip latency next to the daemon's own latency report.
+//
+//   PricingLoadGenerator [address] [connections] [requests per connection] [window] [--greeks] [--shutdown]
+//
+// The mix is European and American price-only requests (batched by the daemon); --greeks makes every tenth
+// request a European price-and-Greeks request. --shutdown stops the daemon at the end.
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#include "daemon_protocol.hpp"
+#include "latency_histogram.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+
+static daemon_protocol::request control_message(std::uint8_t type) {
+    daemon_protocol::request m{};
+    m.type = type;
+    m.version = daemon_protocol::version;
+    return m;
+}
+
+static daemon_protocol::reply round_trip(const std::string& address, std::uint8_t type) {
+    const int fd = daemon_protocol::connect_to(address);
+    const daemon_protocol::request m = control_message(type);
+    daemon_protocol::reply r{};
+    if (!daemon_protocol::write_full(fd, &m, sizeof(m)) || !daemon_protocol::read_full(fd, &r, sizeof(r))) {
+        std::fprintf(stderr, "control message %d failed\n", type);
+    }
+    ::close(fd);
+    return r;
+}
+
+// One connection: window requests in flight, a new one sent for every reply
+static void run_connection(const std::string& address, unsigned connection, std::size_t n_requests, std::size_t window, bool greeks,
+                           latency_histogram& latency, std::size_t& failures) {
+    std::mt19937_64 rng(1000 + connection);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<daemon_protocol::request> requests(n_requests);
+    for (std::size_t i = 0; i < n_requests; ++i) {
+        daemon_protocol::request& m = requests[i];
+        m = control_message(daemon_protocol::price);
+        m.id = static_cast<std::uint32_t>(i);
+        m.option_type = (uniform(rng) < 0.75) ? 1 : 2;
+        m.call_put_type = (i % 2) ? 1 : 2;
+        m.spot = 80.0 + 40.0 * uniform(rng);
+        m.strike = 100.0;
+        m.rate = 0.05;
+        m.volatility = 0.1 + 0.4 * uniform(rng);
+        m.maturity = 0.1 + 1.9 * uniform(rng);
+        m.cost_of_carry = 0.02;
+        if (greeks && i % 10 == 0) {
+            m.option_type = 1;
+            m.outputs = daemon_protocol::out_price | daemon_protocol::out_delta | daemon_protocol::out_gamma | daemon_protocol::out_vega;
+        }
+    }
+
+    const int fd = daemon_protocol::connect_to(address);
+    std::vector<clock_type::time_point> sent(n_requests);
+    std::size_t next = 0, received = 0;
+    auto send_up_to = [&](std::size_t last) {
+        const std::size_t first = next;
+        const auto now = clock_type::now();
+        for (; next < last; ++next) sent[next] = now;
+        return daemon_protocol::write_full(fd, &requests[first], (last - first) * sizeof(daemon_protocol::request));
+    };
+    bool ok = send_up_to(std::min(window, n_requests));
+    daemon_protocol::reply reply;
+    while (ok && received < n_requests && daemon_protocol::read_full(fd, &reply, sizeof(reply))) {
+        latency.record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - sent[reply.id]).count()));
+        if (reply.status != daemon_protocol::ok) ++failures;
+        ++received;
+        if (next < n_requests) ok = send_up_to(next + 1);
+    }
+    failures += n_requests - received;
+    ::close(fd);
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> positional;
+    bool greeks = false, stop_daemon = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--greeks") == 0) greeks = true;
+        else if (std::strcmp(argv[i], "--shutdown") == 0) stop_daemon = true;
+        else positional.push_back(argv[i]);
+    }
+    const std::string address = positional.size() > 0 ? positional[0] : "unix:/tmp/option_pricer.sock";
+    const unsigned connections = positional.size() > 1 ? static_cast<unsigned>(std::stoul(positional[1])) : 4;
+    const std::size_t n_requests = positional.size() > 2 ? std::stoul(positional[2]) : 100000;
+    // A wider window than the daemon reads would stall the initial burst
+    const std::size_t window = std::clamp<std::size_t>(positional.size() > 3 ? std::stoul(positional[3]) : 32, 1, daemon_protocol::max_in_flight);
+
+    try {
+        round_trip(address, daemon_protocol::reset_stats);
+        std::vector<latency_histogram> latency(connections);
+        std::vector<std::size_t> failures(connections, 0);
+        std::vector<std::thread> threads;
+        const auto start = clock_type::now();
+        for (unsigned c = 0; c < connections; ++c) {
+            threads.emplace_back(run_connection, address, c, n_requests, window, greeks, std::ref(latency[c]), std::ref(failures[c]));
+        }
+        for (auto& thread : threads) thread.join();
+        const double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+
+        latency_histogram total;
+        std::size_t failed = 0;
+        for (unsigned c = 0; c < connections; ++c) {
+            total.merge(latency[c]);
+            failed += failures[c];
+        }
+        std::printf("%u connections x %zu requests, window %zu: %.0f requests/s, %zu failed\n", connections, n_requests, window,
+                    static_cast<double>(total.count()) / seconds, failed);
+        std::printf("client round trip (us): p50 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n", total.percentile(0.5) * 1e-3,
+                    total.percentile(0.99) * 1e-3, total.percentile(0.999) * 1e-3, static_cast<double>(total.max()) * 1e-3);
+
+        const daemon_protocol::reply stats = round_trip(address, daemon_protocol::stats);
+        std::printf("daemon (us): p50 %.1f  p99 %.1f  p99.9 %.1f  max %.1f  over %.0f requests, mean batch %.1f\n",
+                    stats.values[daemon_protocol::stats_p50], stats.values[daemon_protocol::stats_p99],
+                    stats.values[daemon_protocol::stats_p999], stats.values[daemon_protocol::stats_max],
+                    stats.values[daemon_protocol::stats_count], stats.values[daemon_protocol::stats_mean_batch]);
+        if (stop_daemon) round_trip(address, daemon_protocol::shutdown);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
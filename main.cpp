@@ -29,10 +29,92 @@ int main() {
     return 0;
 }
 */
+/*
 #include "matrix_interface.hpp"
-
 int main() {
+    // spot x volatility x maturity grid, priced on all cores and streamed to disk in chunks
+    matrix_interface mi({{"spot", 50.0, 70.0, 0.1}, {"volatility", 0.1, 0.5, 0.01}, {"maturity", 0.1, 2.0, 0.1}});
+    mi.write_csv("sweep.csv");
+    return 0;
+}
+*/
+#include "matrix_interface.hpp"
+#include "jsonl_interface.hpp"
+#include "pricing_daemon.hpp"
+#include "instrumentation.hpp"
+#include "portfolio_file.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Portfolio mode: loads a binary (mapped) or text portfolio, prices every contract and writes one price per line.
+// Load and pricing times go to stderr so the prices can be piped.
+static void price_portfolio(const std::string& input_path, const std::string& output_path) {
+    using clock_type = std::chrono::steady_clock;
+    auto seconds_since = [](clock_type::time_point start) { return std::chrono::duration<double>(clock_type::now() - start).count(); };
+    std::vector<double> prices;
+    const auto load_start = clock_type::now();
+    auto price_columns = [&](const portfolio_columns& columns) {
+        const double load_time = seconds_since(load_start);
+        prices.resize(columns.size());
+        const auto price_start = clock_type::now();
+        portfolio_io::price(columns, prices);
+        std::fprintf(stderr, "%zu contracts: loaded in %.3f s, priced in %.3f s\n", columns.size(), load_time, seconds_since(price_start));
+    };
+    if (portfolio_io::is_binary(input_path)) {
+        const mapped_portfolio book(input_path);
+        price_columns(book.columns());
+    } else {
+        const portfolio_data book = portfolio_io::load_text(input_path);
+        price_columns(book.columns());
+    }
+
+    std::ofstream file;
+    if (!output_path.empty() && output_path != "-") {
+        file.open(output_path);
+        if (!file) throw std::runtime_error("Error: could not open " + output_path);
+    }
+    std::ostream& out = file.is_open() ? file : std::cout;
+    out.precision(17);
+    for (const double price : prices) out << price << '\n';
+}
+
+static void run(int argc, char* argv[]) {
+    // Batch mode: OptionPricer --jsonl [requests.jsonl | -] [results.jsonl], stdin/stdout by default
+    if (argc > 1 && std::string(argv[1]) == "--jsonl") {
+        jsonl_interface ji(argc > 2 ? argv[2] : "-", argc > 3 ? argv[3] : "");
+        ji.display_results();
+        return;
+    }
+    // Daemon mode: OptionPricer --serve [unix:/path.sock | tcp:PORT], benchmark with PricingLoadGenerator
+    if (argc > 1 && std::string(argv[1]) == "--serve") {
+        pricing_daemon daemon(argc > 2 ? argv[2] : "unix:/tmp/option_pricer.sock");
+        daemon.display_results();
+        return;
+    }
+
+    // Portfolio files: OptionPricer --convert portfolio.csv portfolio.bin writes the binary layout of portfolio_file.hpp;
+    // OptionPricer --portfolio (portfolio.bin | portfolio.csv) [prices.txt] prices it, stdout by default
+    if (argc > 3 && std::string(argv[1]) == "--convert") {
+        portfolio_io::convert_text_to_binary(argv[2], argv[3]);
+        return;
+    }
+    if (argc > 2 && std::string(argv[1]) == "--portfolio") {
+        price_portfolio(argv[2], argc > 3 ? argv[3] : "");
+        return;
+    }
+
     matrix_interface mi("spot", 58.0, 68.0, 1.0); // Vary "spot" from 58 to 68 with a step size of 1
     mi.display_results();
+}
+
+int main(int argc, char* argv[]) {
+    run(argc, argv);
+    // OPTION_PRICER_METRICS=json or prometheus[:path] dumps the instrumentation counters (instrumented builds)
+    instrumentation::export_from_environment();
     return 0;
 }
@@ -1,124 +1,191 @@
 // matrix_interface.cpp
-// 
+//
 // Implementation of matrix interface
 //
 // @author Mark Bogorad
-// @version 1.0 
+// @version 2.0
 
 #include "matrix_interface.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <fstream>
 #include <iostream>
 #include <iomanip> // For formatted output
-#include <memory> // For smart pointers
+#include <limits>
+#include <stdexcept>
+
+matrix_interface::matrix_interface(const std::string& variable_to_vary, double begin, double end, double h)
+    : matrix_interface(std::vector<sweep_axis>{{variable_to_vary, begin, end, h}}) {}
 
-matrix_interface::matrix_interface(const std::string& variable_to_vary, double begin, double end, double h) 
-    : variable_to_vary(variable_to_vary) {
+matrix_interface::matrix_interface(const std::vector<sweep_axis>& sweep) : n_rows(0), n_threads(0), common_random_numbers(false) {
     // Hardcoded values for other parameters
-    spot = 60.0;
-    strike = 65.0;
-    rate = 0.08;
-    volatility = 0.30;
-    maturity = 0.25; // 1 year
-    cost_of_carry = 0.08;
+    base.spot = 60.0;
+    base.strike = 65.0;
+    base.rate = 0.08;
+    base.volatility = 0.30;
+    base.maturity = 0.25; // 1 year
+    base.cost_of_carry = 0.08;
     option_type = 1; // 1: European, 2: American, 3: Asian
     call_put_type = 2; // 1: Call, 2: Put
     nSimulations = 10000;
     nTimeSteps = 252;
 
     // Generate varying values
-    generate_varying_values(begin, end, h);
+    generate_varying_values(sweep);
 }
 
-void matrix_interface::generate_varying_values(double begin, double end, double h) {
-    for (double value = begin; value <= end; value += h) {
-        varying_values.push_back(value);
+// Each axis takes the values begin + i h for i = 0 .. count - 1 (computed from i, not by accumulating h, so the
+// last value lands on `end` instead of drifting past it)
+void matrix_interface::generate_varying_values(const std::vector<sweep_axis>& sweep) {
+    if (sweep.empty() || sweep.size() > 4) throw std::invalid_argument("Error: a sweep needs between 1 and 4 axes");
+    n_rows = 1;
+    for (const sweep_axis& axis : sweep) {
+        double market_point::*parameter = nullptr;
+        if (axis.variable == "spot") {
+            parameter = &market_point::spot;
+        } else if (axis.variable == "strike") {
+            parameter = &market_point::strike;
+        } else if (axis.variable == "rate") {
+            parameter = &market_point::rate;
+        } else if (axis.variable == "volatility") {
+            parameter = &market_point::volatility;
+        } else if (axis.variable == "maturity") {
+            parameter = &market_point::maturity;
+        } else if (axis.variable == "cost_of_carry") {
+            parameter = &market_point::cost_of_carry;
+        } else {
+            throw std::invalid_argument("Error: unknown sweep variable " + axis.variable);
+        }
+        for (const resolved_axis& other : axes) {
+            if (other.parameter == parameter) throw std::invalid_argument("Error: " + axis.variable + " is swept twice");
+        }
+        if (!(axis.h > 0) || !(axis.end >= axis.begin) || !std::isfinite(axis.begin) || !std::isfinite(axis.end)) {
+            throw std::invalid_argument("Error: sweep axis needs begin <= end and a positive step");
+        }
+        const std::size_t count = static_cast<std::size_t>(std::floor((axis.end - axis.begin) / axis.h + 1e-9)) + 1;
+        axes.push_back({axis.variable, parameter, axis.begin, axis.h, count});
+        n_rows *= count;
     }
 }
 
-void matrix_interface::set_parameters(double value) {
-    if (variable_to_vary == "spot") {
-        spot = value;
-    } else if (variable_to_vary == "strike") {
-        strike = value;
-    } else if (variable_to_vary == "rate") {
-        rate = value;
-    } else if (variable_to_vary == "volatility") {
-        volatility = value;
-    } else if (variable_to_vary == "maturity") {
-        maturity = value;
-    } else if (variable_to_vary == "cost_of_carry") {
-        cost_of_carry = value;
+void matrix_interface::set_option(int option_type, int call_put_type, int n_simulations, int n_time_steps) {
+    if (option_type < 1 || option_type > 3) throw std::domain_error("Invalid option type selected.");
+    if (call_put_type != 1 && call_put_type != 2) throw std::domain_error("Select 1 for call or 2 for put");
+    if (n_simulations <= 0 || n_time_steps <= 0) throw std::invalid_argument("Error: number of time steps and simulations must be positive");
+    this->option_type = option_type;
+    this->call_put_type = call_put_type;
+    nSimulations = n_simulations;
+    nTimeSteps = n_time_steps;
+}
+
+void matrix_interface::set_threads(unsigned n_threads) {
+    this->n_threads = n_threads;
+}
+
+void matrix_interface::set_common_random_numbers(bool enabled) {
+    common_random_numbers = enabled;
+}
+
+// Every row's asian_option runs with the default seed and the sweep's N and M, so one buffer serves them all
+mc_normals matrix_interface::sweep_normals() const {
+    if (!common_random_numbers || option_type != 3) return mc_normals();
+    const asian_mc_config config;
+    return mc_normals(config.seed, nTimeSteps, pricing_methods::asian_mc_paths(nSimulations, config), n_threads);
+}
+
+// Row index -> grid point (last axis fastest), then one pricing call. Options live on the stack; the Asian
+// Monte-Carlo runs single-threaded inside a cell because the sweep already occupies every core.
+void matrix_interface::price_row(std::size_t row, double* out, const mc_normals& normals) const {
+    market_point point = base;
+    for (std::size_t a = axes.size(); a-- > 0;) {
+        const double value = axes[a].begin + static_cast<double>(row % axes[a].count) * axes[a].h;
+        row /= axes[a].count;
+        point.*axes[a].parameter = value;
+        out[a] = value;
+    }
+
+    double* result = out + axes.size();
+    std::fill(result, result + n_result_columns, std::numeric_limits<double>::quiet_NaN());
+    const int type = (call_put_type == 1) ? option::CALL : option::PUT;
+    if (option_type == 1) { // European
+        const european_option european_opt(point.spot, point.strike, point.rate, point.maturity, point.volatility, point.cost_of_carry, type);
+        const european_greeks g = european_opt.price_and_greeks(); // price, Greeks and PCP counterpart in one pass
+        const double row_values[n_result_columns] = {g.price, g.delta, g.gamma, g.vega, g.theta, g.rho, g.pcp_price};
+        std::copy(row_values, row_values + n_result_columns, result);
+    } else if (option_type == 2) { // American
+        const american_option american_opt(point.spot, point.strike, point.rate, point.maturity, point.volatility, point.cost_of_carry, type);
+        result[0] = american_opt.price();
+    } else if (option_type == 3) { // Asian
+        asian_option asian_opt(point.spot, point.strike, point.rate, point.maturity, point.volatility, point.cost_of_carry, type, nSimulations, nTimeSteps);
+        asian_opt.set_threads(1);
+        if (!normals.empty()) asian_opt.set_normals(&normals);
+        const asian_greeks g = asian_opt.price_and_greeks(); // Greeks from the same paths as the price
+        const double row_values[] = {g.price.price, g.delta.price, g.gamma.price, g.vega.price, g.theta.price, g.rho.price};
+        std::copy(std::begin(row_values), std::end(row_values), result);
+    } else {
+        throw std::domain_error("Invalid option type selected.");
     }
 }
 
+// Rows are cut into fixed blocks handed out across threads; each row writes only its own slice of out
+void matrix_interface::price_rows(std::size_t first_row, std::size_t count, double* out, const mc_normals& normals) const {
+    constexpr std::size_t block_rows = 64;
+    const std::size_t columns = column_count();
+    parallel::for_blocks((count + block_rows - 1) / block_rows, n_threads, [&](std::size_t block, unsigned) {
+        const std::size_t end = std::min(count, (block + 1) * block_rows);
+        for (std::size_t i = block * block_rows; i < end; ++i) price_row(first_row + i, out + i * columns, normals);
+    });
+}
+
 void matrix_interface::console_pricing() {
-    results_matrix.clear();
-    american_results_matrix.clear();
-
-    for (double value : varying_values) {
-        set_parameters(value);
-
-        std::unique_ptr<option> opt;
-        double price = 0.0;
-
-        if (option_type == 1) { // European
-            auto european_opt = std::make_unique<european_option>(spot, strike, rate, maturity, volatility, cost_of_carry, (call_put_type == 1) ? option::CALL : option::PUT);
-            price = european_opt->price();
-            double delta = european_opt->delta();
-            double gamma = european_opt->gamma();
-            double vega = european_opt->vega();
-            double theta = european_opt->theta();
-            double rho = european_opt->rho();
-            double pcp_price = 0.0;
-            if (call_put_type == 1) {
-                pcp_price = european_opt->pcp_put_price(price);
-            } else {
-                pcp_price = european_opt->pcp_call_price(price);
-            }
-            results_matrix.push_back({value, price, delta, gamma, vega, theta, rho, pcp_price});
-        } else if (option_type == 2) { // American
-            auto american_opt = std::make_unique<american_option>(spot, strike, rate, volatility, cost_of_carry, (call_put_type == 1) ? option::CALL : option::PUT);
-            price = american_opt->price();
-            american_results_matrix.push_back({value, price});
-        } else if (option_type == 3) { // Asian
-            auto asian_opt = std::make_unique<asian_option>(spot, strike, rate, maturity, volatility, cost_of_carry, (call_put_type == 1) ? option::CALL : option::PUT, nSimulations, nTimeSteps);
-            price = asian_opt->price();
-            results_matrix.push_back({value, price});
-        } else {
-            std::cerr << "Invalid option type selected." << std::endl;
-            return;
+    results_matrix.assign(n_rows * column_count(), 0.0);
+    price_rows(0, n_rows, results_matrix.data(), sweep_normals());
+    print_results_matrix();
+}
+
+void matrix_interface::write_csv(const std::string& path, std::size_t chunk_rows) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) throw std::runtime_error("Error: could not open " + path);
+    for (const resolved_axis& axis : axes) file << axis.variable << ',';
+    file << "price,delta,gamma,vega,theta,rho,pcp_price\n";
+
+    // One reusable chunk of results and one text buffer; numbers are formatted with to_chars (shortest round trip)
+    chunk_rows = std::max<std::size_t>(chunk_rows, 1);
+    const std::size_t columns = column_count();
+    std::vector<double> chunk(std::min(chunk_rows, n_rows) * columns);
+    std::vector<char> text(chunk.size() * 32);
+    const mc_normals normals = sweep_normals(); // shared by every chunk
+    for (std::size_t first = 0; first < n_rows; first += chunk_rows) {
+        const std::size_t count = std::min(chunk_rows, n_rows - first);
+        price_rows(first, count, chunk.data(), normals);
+        char* p = text.data();
+        for (std::size_t i = 0; i < count * columns; ++i) {
+            p = std::to_chars(p, text.data() + text.size(), chunk[i]).ptr;
+            *p++ = (i % columns == columns - 1) ? '\n' : ',';
         }
+        file.write(text.data(), p - text.data());
     }
-
-    print_results_matrix();
+    if (!file) throw std::runtime_error("Error: failed writing " + path);
 }
 
 void matrix_interface::print_results_matrix() {
-    if (option_type == 2) { // American option
-        std::cout << std::setw(15) << "Varying Value" 
-                  << std::setw(15) << "Option Price" 
-                  << std::endl;
-        for (const auto& row : american_results_matrix) {
-            for (double val : row) {
-                std::cout << std::setw(15) << val;
-            }
-            std::cout << std::endl;
-        }
-    } else { // European and Asian options
-        std::cout << std::setw(15) << "Varying Value" 
-                  << std::setw(15) << "Option Price" 
-                  << std::setw(15) << "Delta" 
-                  << std::setw(15) << "Gamma" 
-                  << std::setw(15) << "Vega" 
-                  << std::setw(15) << "Theta" 
-                  << std::setw(15) << "Rho" 
-                  << std::setw(15) << "PCP Price" 
-                  << std::endl;
-        for (const auto& row : results_matrix) {
-            for (double val : row) {
-                std::cout << std::setw(15) << val;
-            }
-            std::cout << std::endl;
+    for (const resolved_axis& axis : axes) std::cout << std::setw(15) << axis.variable;
+    std::cout << std::setw(15) << "Option Price"
+              << std::setw(15) << "Delta"
+              << std::setw(15) << "Gamma"
+              << std::setw(15) << "Vega"
+              << std::setw(15) << "Theta"
+              << std::setw(15) << "Rho"
+              << std::setw(15) << "PCP Price"
+              << std::endl;
+    const std::size_t columns = column_count();
+    for (std::size_t row = 0; row < n_rows; ++row) {
+        for (std::size_t c = 0; c < columns; ++c) {
+            std::cout << std::setw(15) << results_matrix[row * columns + c];
         }
+        std::cout << std::endl;
     }
 }
 
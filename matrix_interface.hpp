@@ -1,9 +1,13 @@
 // matrix_interface.hpp
-// 
-// Interface for an output of incrementally varying parameters and results stored in a matrix
+//
+// Interface for an output of incrementally varying parameters and results stored in a matrix.
+// Sweeps up to four parameters at once as a Cartesian grid (last axis varies fastest). Every row has the same column
+// schema: one column per axis value, then price, delta, gamma, vega, theta, rho and the put-call parity price
+// (NaN where the option type has no such output). Rows are priced in parallel into one contiguous row-major buffer;
+// write_csv streams large grids to disk chunk by chunk instead.
 //
 // @author Mark Bogorad
-// @version 1.0 
+// @version 2.0
 
 #ifndef MATRIX_INTERFACE_HPP
 #define MATRIX_INTERFACE_HPP
@@ -12,39 +16,86 @@
 #include "european_option.hpp"
 #include "american_option.hpp"
 #include "asian_option.hpp"
+#include <cstddef>
 #include <vector>
 #include <string>
 
+// One swept parameter: spot, strike, rate, volatility, maturity or cost_of_carry, from begin to end in steps of h
+struct sweep_axis {
+    std::string variable;
+    double begin;
+    double end;
+    double h;
+};
+
 class matrix_interface : public interfaces {
 public:
     matrix_interface(const std::string& variable_to_vary, double begin, double end, double h);
+    explicit matrix_interface(const std::vector<sweep_axis>& axes); // 1 to 4 axes
     void display_results() override; // Main function to run the interface
 
+    // Option priced in every row: option_type 1 European, 2 American, 3 Asian; call_put_type 1 call, 2 put. The
+    // Monte-Carlo sizes apply to Asian rows.
+    void set_option(int option_type, int call_put_type, int n_simulations = 10000, int n_time_steps = 252);
+    // Worker threads for the sweep (0 = all cores)
+    void set_threads(unsigned n_threads);
+    // Asian sweeps: draw the Monte-Carlo normals once per sweep and replay them in every row instead of per row
+    // (8 bytes per path and step held for the sweep). Prices are unchanged; rows only skip the RNG work.
+    void set_common_random_numbers(bool enabled);
+
+    // Prices the whole grid and writes it as CSV, chunk_rows rows at a time, without holding the grid in memory
+    void write_csv(const std::string& path, std::size_t chunk_rows = 65536) const;
+
+    std::size_t row_count() const { return n_rows; }
+    std::size_t column_count() const { return axes.size() + n_result_columns; }
+    // Contiguous row-major results of the last display_results() call
+    const std::vector<double>& results() const { return results_matrix; }
+
+    static constexpr std::size_t n_result_columns = 7; // price, delta, gamma, vega, theta, rho, pcp price
+
 private:
+    // Market parameters of one grid point
+    struct market_point {
+        double spot;
+        double strike;
+        double rate;
+        double volatility;
+        double maturity;
+        double cost_of_carry;
+    };
+
+    // Axis resolved at construction: which parameter it sets and how many values it takes
+    struct resolved_axis {
+        std::string variable;
+        double market_point::*parameter;
+        double begin;
+        double h;
+        std::size_t count;
+    };
+
     void console_pricing();
     void display_greeks(const european_option& opt);
     void check_put_call_parity(const european_option& opt, double other_option_price);
     void calculate_and_check_parity(const european_option& opt);
-    void set_parameters(double value);
-    void generate_varying_values(double begin, double end, double h);
+    void generate_varying_values(const std::vector<sweep_axis>& sweep);
+    mc_normals sweep_normals() const; // the shared Asian normals, empty unless common random numbers are on
+    // count rows into out, in parallel; normals is the sweep_normals() buffer (or empty)
+    void price_rows(std::size_t first_row, std::size_t count, double* out, const mc_normals& normals) const;
+    void price_row(std::size_t row, double* out, const mc_normals& normals) const;
     void print_results_matrix();
 
     // Variables
-    std::string variable_to_vary;
-    std::vector<double> varying_values;
-    std::vector<std::vector<double>> results_matrix;
-    std::vector<std::vector<double>> american_results_matrix;
-
-    double spot;
-    double strike;
-    double rate;
-    double volatility;
-    double maturity; // 1 year
-    double cost_of_carry;
+    std::vector<resolved_axis> axes;
+    std::size_t n_rows;
+    std::vector<double> results_matrix; // n_rows x column_count(), row-major
+
+    market_point base; // values of the parameters that are not swept
     int option_type; // 1: European, 2: American, 3: Asian
     int call_put_type; // 1: Call, 2: Put
     int nSimulations;
     int nTimeSteps;
+    unsigned n_threads;
+    bool common_random_numbers;
 };
 
 #endif // MATRIX_INTERFACE_HPP
@@ -0,0 +1,31 @@
+// mc_normals.cpp
+//
+// Shared Philox normal buffer for common-random-number Monte-Carlo runs
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#include "mc_normals.hpp"
+#include "parallel.hpp"
+#include "normal_pool.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+mc_normals::mc_normals(std::uint64_t seed, int n_steps, std::size_t n_paths, unsigned n_threads)
+    : key(seed), n_steps(n_steps), n_paths((n_paths + lanes - 1) / lanes * lanes) {
+    if (n_steps <= 0 || n_paths == 0) throw std::invalid_argument("Error: number of time steps and paths must be positive");
+    values.resize(this->n_paths * n_steps);
+    const normal_pool pool(seed);
+    const std::size_t groups = this->n_paths / lanes;
+
+    // Same draws as the path kernel: one pool batch per lane group and normal_pool::batch_steps steps
+    parallel::for_blocks(groups, n_threads, [&](std::size_t group, unsigned) {
+        double* z = values.data() + group * n_steps * lanes;
+        double batch[normal_pool::batch_steps][lanes];
+        for (int i = 0; i < n_steps; i += normal_pool::batch_steps) {
+            pool.lanes_steps(group * lanes, static_cast<std::uint32_t>(i), batch);
+            const int steps = std::min(normal_pool::batch_steps, n_steps - i);
+            std::copy(&batch[0][0], &batch[0][0] + steps * lanes, z + i * lanes);
+        }
+    });
+}
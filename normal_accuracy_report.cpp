@@ -0,0 +1,85 @@
+// normal_accuracy_report.cpp
+//
+// Accuracy report of the in-house normal CDF/PDF (scalar and SIMD lanes) against boost::math over the d1/d2 range.
+// Prints a markdown table; the committed copy lives in NORMAL_ACCURACY.md.
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#include "normal_math.hpp"
+#include "simd_math.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+struct error_stats {
+    double max_abs = 0.0;
+    double max_rel = 0.0;
+    double worst_x = 0.0;
+    void add(double x, double approx, double exact) {
+        double abs_err = std::abs(approx - exact);
+        if (abs_err > max_abs) {
+            max_abs = abs_err;
+            worst_x = x;
+        }
+        if (exact > 1e-300) max_rel = std::max(max_rel, abs_err / exact);
+    }
+};
+
+// Evaluates the SIMD kernels one register at a time so the vector body itself is measured (tail in the scalar lane)
+template <class L>
+static void eval_lanes(const std::vector<double>& x, std::vector<double>& cdf_out, std::vector<double>& pdf_out) {
+    std::size_t i = 0;
+    for (; i + L::width <= x.size(); i += L::width) {
+        L::store(&cdf_out[i], simd_math::ncdf_v<L>(L::load(&x[i])));
+        L::store(&pdf_out[i], simd_math::npdf_v<L>(L::load(&x[i])));
+    }
+    for (; i < x.size(); ++i) {
+        cdf_out[i] = normal_math::fast_cdf(x[i]);
+        pdf_out[i] = normal_math::fast_pdf(x[i]);
+    }
+}
+
+int main() {
+    const double lo = -40.0, hi = 40.0, step = 1e-4; // |d1|, |d2| beyond ~38 only produce 0/1 in double
+    std::vector<double> x;
+    for (long i = 0; lo + i * step <= hi; ++i) x.push_back(lo + i * step);
+
+    using lane = simd_math::native_lane;
+    std::vector<double> simd_cdf(x.size()), simd_pdf(x.size());
+    eval_lanes<lane>(x, simd_cdf, simd_pdf);
+
+    const double bands[] = {0.0, 1.0, 3.0, 7.07106781186547, 10.0, 20.0, 40.0};
+    const int n_bands = 6;
+    error_stats cdf_scalar[n_bands], cdf_simd[n_bands], pdf_scalar[n_bands], pdf_simd[n_bands];
+
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        const double ax = std::abs(x[i]);
+        int band = 0;
+        while (band < n_bands - 1 && ax >= bands[band + 1]) ++band;
+        const double exact_cdf = normal_math::boost_cdf(x[i]);
+        const double exact_pdf = normal_math::boost_pdf(x[i]);
+        cdf_scalar[band].add(x[i], normal_math::fast_cdf(x[i]), exact_cdf);
+        cdf_simd[band].add(x[i], simd_cdf[i], exact_cdf);
+        pdf_scalar[band].add(x[i], normal_math::fast_pdf(x[i]), exact_pdf);
+        pdf_simd[band].add(x[i], simd_pdf[i], exact_pdf);
+    }
+
+    std::printf("# Normal CDF/PDF accuracy report\n\n");
+    std::printf("Reference: boost::math::normal_distribution<double>. Grid: x in [%g, %g], step %g (%zu points).\n", lo, hi, step, x.size());
+    std::printf("SIMD lane width: %zu doubles. Relative error is only measured where the reference exceeds 1e-300.\n\n", lane::width);
+    std::printf("| \\|x\\| band | CDF max abs (scalar) | CDF max abs (SIMD) | CDF max rel (scalar) | PDF max abs (scalar) | PDF max abs (SIMD) | PDF max rel (scalar) |\n");
+    std::printf("|---|---|---|---|---|---|---|\n");
+    error_stats total_cdf, total_pdf;
+    for (int b = 0; b < n_bands; ++b) {
+        std::printf("| [%g, %g) | %.3e | %.3e | %.3e | %.3e | %.3e | %.3e |\n", bands[b], bands[b + 1],
+                    cdf_scalar[b].max_abs, cdf_simd[b].max_abs, cdf_scalar[b].max_rel,
+                    pdf_scalar[b].max_abs, pdf_simd[b].max_abs, pdf_scalar[b].max_rel);
+        total_cdf.max_abs = std::max({total_cdf.max_abs, cdf_scalar[b].max_abs, cdf_simd[b].max_abs});
+        total_pdf.max_abs = std::max({total_pdf.max_abs, pdf_scalar[b].max_abs, pdf_simd[b].max_abs});
+    }
+    std::printf("\nMax absolute error over the whole grid: CDF %.3e (bound 5e-16), PDF %.3e (bound 2e-16)\n", total_cdf.max_abs, total_pdf.max_abs);
+    std::printf("\nThe CDF bound is absolute: relative error in the lower tail is ~1e-8, and the CDF returns exactly 0/1 for |x| > 37.\n");
+    return (total_cdf.max_abs < 5e-16 && total_pdf.max_abs < 2e-16) ? 0 : 1; // non-zero if the documented bound is broken
+}
@@ -0,0 +1,103 @@
+// normal_math.cpp
+//
+// Backend selection and boost reference implementations for the standard normal CDF/PDF
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#include "normal_math.hpp"
+#include <boost/math/distributions/normal.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace normal_math {
+
+#ifdef OPTION_PRICER_BOOST_NORMAL
+std::atomic<bool> use_boost{true};
+#else
+std::atomic<bool> use_boost{false};
+#endif
+
+void set_backend(backend b) {
+    use_boost.store(b == backend::boost, std::memory_order_relaxed);
+}
+
+backend get_backend() {
+    return use_boost.load(std::memory_order_relaxed) ? backend::boost : backend::in_house;
+}
+
+double boost_cdf(double x) {
+    return boost::math::cdf(boost::math::normal_distribution<>(0, 1), x);
+}
+
+double boost_pdf(double x) {
+    return boost::math::pdf(boost::math::normal_distribution<>(0, 1), x);
+}
+
+// Genz, "Numerical computation of rectangular bivariate and trivariate normal and t probabilities" (2004): Gauss-Legendre
+// quadrature of Plackett's identity for |rho| < 0.925, Drezner-Wesolowsky series otherwise. Computes P(X > h, Y > k).
+static double bivariate_upper(double h, double k, double r) {
+    static const double W[3][10] = {
+        {0.1713244923791705, 0.3607615730481384, 0.4679139345726904},
+        {0.04717533638651177, 0.1069393259953183, 0.1600783285433464, 0.2031674267230659, 0.2334925365383547, 0.2491470458134029},
+        {0.01761400713915212, 0.04060142980038694, 0.06267204833410906, 0.08327674157670475, 0.1019301198172404,
+         0.1181945319615184, 0.1316886384491766, 0.1420961093183821, 0.1491729864726037, 0.1527533871307259}};
+    static const double X[3][10] = {
+        {0.9324695142031522, 0.6612093864662647, 0.2386191860831970},
+        {0.9815606342467191, 0.9041172563704750, 0.7699026741943050, 0.5873179542866171, 0.3678314989981802, 0.1252334085114692},
+        {0.9931285991850949, 0.9639719272779138, 0.9122344282513259, 0.8391169718222188, 0.7463319064601508,
+         0.6360536807265150, 0.5108670019508271, 0.3737060887154196, 0.2277858511416451, 0.07652652113349733}};
+    const double two_pi = 6.283185307179586;
+    const int ng = std::abs(r) < 0.3 ? 0 : (std::abs(r) < 0.75 ? 1 : 2);
+    const int lg = ng == 0 ? 3 : (ng == 1 ? 6 : 10);
+
+    double hk = h * k;
+    double bvn = 0.0;
+    if (std::abs(r) < 0.925) {
+        const double hs = (h * h + k * k) / 2;
+        const double asr = std::asin(r);
+        for (int i = 0; i < lg; ++i) {
+            double sn = std::sin(asr * (1 - X[ng][i]) / 2);
+            bvn += W[ng][i] * std::exp((sn * hk - hs) / (1 - sn * sn));
+            sn = std::sin(asr * (1 + X[ng][i]) / 2);
+            bvn += W[ng][i] * std::exp((sn * hk - hs) / (1 - sn * sn));
+        }
+        return bvn * asr / (2 * two_pi) + cdf(-h) * cdf(-k);
+    }
+
+    if (r < 0) {
+        k = -k;
+        hk = -hk;
+    }
+    if (std::abs(r) < 1) {
+        const double as = (1 - r) * (1 + r);
+        double a = std::sqrt(as);
+        const double bs = (h - k) * (h - k);
+        const double c = (4 - hk) / 8;
+        const double d = (12 - hk) / 16;
+        bvn = a * std::exp(-(bs / as + hk) / 2) * (1 - c * (bs - as) * (1 - d * bs / 5) / 3 + c * d * as * as / 5);
+        if (hk > -160) {
+            const double b = std::sqrt(bs);
+            bvn -= std::exp(-hk / 2) * std::sqrt(two_pi) * cdf(-b / a) * b * (1 - c * bs * (1 - d * bs / 5) / 3);
+        }
+        a /= 2;
+        for (int i = 0; i < lg; ++i) {
+            for (int is = -1; is <= 1; is += 2) {
+                const double xs = (a * (is * X[ng][i] + 1)) * (a * (is * X[ng][i] + 1));
+                const double rs = std::sqrt(1 - xs);
+                bvn += a * W[ng][i] * (std::exp(-bs / (2 * xs) - hk / (1 + rs)) / rs - std::exp(-(bs / xs + hk) / 2) * (1 + c * xs * (1 + d * xs)));
+            }
+        }
+        bvn = -bvn / two_pi;
+    }
+    if (r > 0) return bvn + cdf(-std::max(h, k));
+    bvn = -bvn;
+    if (k > h) bvn += (h < 0) ? cdf(k) - cdf(h) : cdf(-h) - cdf(-k);
+    return bvn;
+}
+
+double bivariate_cdf(double a, double b, double rho) {
+    return bivariate_upper(-a, -b, rho);
+}
+
+} // namespace normal_math
@@ -0,0 +1,44 @@
+// normal_math.hpp
+//
+// Standard normal CDF/PDF used by the European pricers and Greeks. The in-house backend (simd_math.hpp, max absolute
+// error 5e-16 for the CDF and 2e-16 for the PDF, see NORMAL_ACCURACY.md) is inlined into the pricers; boost::math is
+// kept as a reference backend. The default is chosen at build time (OPTION_PRICER_BOOST_NORMAL) and can be switched
+// at run time with normal_math::set_backend.
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#ifndef NORMAL_MATH_HPP
+#define NORMAL_MATH_HPP
+
+#include "simd_math.hpp"
+#include <atomic>
+
+namespace normal_math {
+
+enum class backend { in_house, boost };
+
+void set_backend(backend b); // safe while pricing: calls already running finish on the backend they started with
+backend get_backend();
+
+// Reference implementations (boost::math::normal_distribution)
+double boost_cdf(double x);
+double boost_pdf(double x);
+
+// In-house scalar implementations, same polynomials as the SIMD lanes
+inline double fast_cdf(double x) { return simd_math::ncdf_v<simd_math::scalar_lane>(x); }
+inline double fast_pdf(double x) { return simd_math::npdf_v<simd_math::scalar_lane>(x); }
+// Inverse CDF for p in (0, 1), used to map uniforms to normals in the Monte-Carlo samplers
+inline double inverse_cdf(double p) { return simd_math::ninv_v<simd_math::scalar_lane>(p); }
+
+// Bivariate standard normal CDF P(X < a, Y < b) with correlation rho (Genz 2004, absolute error ~1e-15)
+double bivariate_cdf(double a, double b, double rho);
+
+extern std::atomic<bool> use_boost; // current backend, read (relaxed, a plain load) on every call
+
+inline double cdf(double x) { return use_boost.load(std::memory_order_relaxed) ? boost_cdf(x) : fast_cdf(x); }
+inline double pdf(double x) { return use_boost.load(std::memory_order_relaxed) ? boost_pdf(x) : fast_pdf(x); }
+
+} // namespace normal_math
+
+#endif // NORMAL_MATH_HPP
@@ -0,0 +1,67 @@
+// normal_pool.cpp
+//
+// Vectorised Philox + inverse-CDF normal generation
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#include "normal_pool.hpp"
+#include "simd_math.hpp"
+#include <algorithm>
+
+static constexpr std::size_t batch_blocks = normal_pool::lanes * normal_pool::batch_steps / 2; // 32
+
+// Philox on the counters, then both normals of each block: z0 from words 0-1, z1 from words 2-3
+static void normals_from_counters(const philox& rng, std::uint32_t (&block)[4][batch_blocks], double* z0, double* z1) {
+    using lane = simd_math::native_lane;
+    rng(block);
+    alignas(64) double u[2][batch_blocks];
+    for (std::size_t i = 0; i < batch_blocks; ++i) {
+        u[0][i] = philox::to_unit(block[0][i], block[1][i]);
+        u[1][i] = philox::to_unit(block[2][i], block[3][i]);
+    }
+    for (std::size_t i = 0; i < batch_blocks; i += lane::width) {
+        lane::store(z0 + i, simd_math::ninv_fast_v<lane>(lane::load(u[0] + i)));
+        lane::store(z1 + i, simd_math::ninv_fast_v<lane>(lane::load(u[1] + i)));
+    }
+}
+
+// Block i covers the pair of steps first_step / 2 + i / lanes of path first_path + i % lanes
+void normal_pool::lanes_steps(std::uint64_t first_path, std::uint32_t first_step, double (&z)[batch_steps][lanes]) const {
+    std::uint32_t block[4][batch_blocks];
+    for (std::size_t i = 0; i < batch_blocks; ++i) {
+        const std::uint64_t p = first_path + i % lanes;
+        block[0][i] = first_step / 2 + static_cast<std::uint32_t>(i / lanes);
+        block[1][i] = static_cast<std::uint32_t>(p);
+        block[2][i] = static_cast<std::uint32_t>(p >> 32);
+        block[3][i] = 0;
+    }
+    alignas(64) double z0[batch_blocks], z1[batch_blocks];
+    normals_from_counters(rng, block, z0, z1);
+    for (int pair = 0; pair < batch_steps / 2; ++pair) {
+        for (std::size_t l = 0; l < lanes; ++l) {
+            z[2 * pair][l] = z0[pair * lanes + l];
+            z[2 * pair + 1][l] = z1[pair * lanes + l];
+        }
+    }
+}
+
+void normal_pool::path(std::uint64_t path, std::size_t n, double* out) const {
+    std::uint32_t block[4][batch_blocks];
+    alignas(64) double z0[batch_blocks], z1[batch_blocks];
+    for (std::size_t first_pair = 0; 2 * first_pair < n; first_pair += batch_blocks) {
+        for (std::size_t i = 0; i < batch_blocks; ++i) {
+            block[0][i] = static_cast<std::uint32_t>(first_pair + i);
+            block[1][i] = static_cast<std::uint32_t>(path);
+            block[2][i] = static_cast<std::uint32_t>(path >> 32);
+            block[3][i] = 0;
+        }
+        normals_from_counters(rng, block, z0, z1);
+        const std::size_t pairs = std::min(batch_blocks, (n + 1) / 2 - first_pair);
+        for (std::size_t i = 0; i < pairs; ++i) {
+            const std::size_t step = 2 * (first_pair + i);
+            out[step] = z0[i];
+            if (step + 1 < n) out[step + 1] = z1[i];
+        }
+    }
+}
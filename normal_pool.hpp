@@ -0,0 +1,37 @@
+// normal_pool.hpp
+//
+// Bulk standard normals for the Monte-Carlo pricers. The normal for (path, step) is the inverse normal CDF of a
+// 53-bit uniform from the Philox block at counter (step / 2, path): words 0-1 give the even step, words 2-3 the odd
+// one. Blocks are generated 32 at a time by the structure-of-arrays Philox (enough independent blocks to keep its
+// multiply chain busy) and mapped through simd_math::ninv_fast_v, so a draw is a few vector instructions per normal
+// instead of Box-Muller's scalar log, sqrt, sin and cos. Any (path, step) is addressable on its own, which keeps
+// Monte-Carlo results independent of how paths are spread over threads.
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#ifndef NORMAL_POOL_HPP
+#define NORMAL_POOL_HPP
+
+#include "philox.hpp"
+#include <cstddef>
+#include <cstdint>
+
+class normal_pool {
+public:
+    static constexpr std::size_t lanes = 8; // paths per batch of the path kernel
+    static constexpr int batch_steps = 8; // steps per batch of the path kernel
+
+    explicit normal_pool(std::uint64_t seed) : rng(seed) {}
+    explicit normal_pool(const philox& rng) : rng(rng) {}
+
+    // z[s][l] = normal of step first_step + s of path first_path + l (first_step even)
+    void lanes_steps(std::uint64_t first_path, std::uint32_t first_step, double (&z)[batch_steps][lanes]) const;
+    // Steps 0 .. n - 1 of one path, into out[0..n)
+    void path(std::uint64_t path, std::size_t n, double* out) const;
+
+private:
+    philox rng;
+};
+
+#endif // NORMAL_POOL_HPP
@@ -0,0 +1,61 @@
+// parallel.hpp
+//
+// Minimal std::thread work splitter shared by the parallel pricers. Work is cut into a fixed number of blocks that
+// does not depend on the thread count, so per-block results can be reduced in block order for reproducible output.
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+// Number of worker threads to use for a request of n_threads (0 = all hardware threads)
+inline unsigned resolve_threads(unsigned n_threads) {
+    if (n_threads == 0) n_threads = std::thread::hardware_concurrency();
+    return std::max(1u, n_threads);
+}
+
+// Calls fn(block, thread_index) for every block in [0, n_blocks) using up to n_threads threads (0 = all cores).
+// Blocks are handed out dynamically; the first exception thrown by fn is rethrown on the calling thread.
+template <class F>
+void for_blocks(std::size_t n_blocks, unsigned n_threads, F&& fn) {
+    const unsigned workers = static_cast<unsigned>(std::min<std::size_t>(resolve_threads(n_threads), std::max<std::size_t>(n_blocks, 1)));
+    if (workers <= 1) {
+        for (std::size_t block = 0; block < n_blocks; ++block) fn(block, 0u);
+        return;
+    }
+
+    std::atomic<std::size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto work = [&](unsigned thread_index) {
+        try {
+            for (std::size_t block = next++; block < n_blocks; block = next++) fn(block, thread_index);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) error = std::current_exception();
+            next = n_blocks; // stop handing out work
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (unsigned t = 1; t < workers; ++t) threads.emplace_back(work, t);
+    work(0);
+    for (auto& thread : threads) thread.join();
+    if (error) std::rethrow_exception(error);
+}
+
+} // namespace parallel
+
+#endif // PARALLEL_HPP
@@ -0,0 +1,66 @@
+// pde_engine.hpp
+//
+// Crank-Nicolson finite-difference engine for European and American options under Black-Scholes with cost of carry.
+// The PDE is solved once in log-moneyness x = ln(S/K) for a unit strike: prices are homogeneous of degree one in
+// (S, K), so V(S, K) = K u(ln(S/K)) prices every strike of a chain that shares r, T, sig, b from one solve.
+// Early exercise uses the Brennan-Schwartz projection inside the tridiagonal (Thomas) solve; the first time steps are
+// Rannacher (implicit Euler) half steps to damp the payoff kink. Delta, gamma and theta come straight off the grid.
+// The spacing is that of a single at-the-money contract whatever the chain: a wider moneyness range gets more
+// intervals, not coarser ones, so the error does not grow with the chain. Buffers are sized in the constructor and
+// reused; solve() only grows them for a domain wider than any before, and value() never allocates.
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#ifndef PDE_ENGINE_HPP
+#define PDE_ENGINE_HPP
+
+#include <span>
+#include <vector>
+
+// Price and grid Greeks at one (S, K)
+struct pde_result {
+    double price;
+    double delta;
+    double gamma;
+    double theta;
+};
+
+class crank_nicolson_engine {
+public:
+    // n_space intervals in x across an at-the-money domain (wider domains keep its spacing), n_time steps in time,
+    // domain half-width in standard deviations sig sqrt(T)
+    crank_nicolson_engine(int n_space = 400, int n_time = 200, double width_in_stdevs = 6.0);
+
+    // Solves for a unit strike; the grid also covers [x_lo, x_hi] (log-moneyness range of the chain to price)
+    void solve(double r, double T, double sig, double b, int option_type, bool american, double x_lo = 0.0, double x_hi = 0.0);
+
+    // Price and Greeks at (S, K) from the last solve, interpolated in x = ln(S/K)
+    pde_result value(double S, double K) const;
+    // Whole chain from the last solve
+    void value_chain(std::span<const double> S, std::span<const double> K, std::span<pde_result> out) const;
+
+private:
+    void step(double dt, double theta_weight, double tau_next); // one theta-scheme step from tau to tau_next
+    double lower_boundary(double tau) const;
+    double upper_boundary(double tau) const;
+
+    int n_space;
+    int n_time;
+    double width;
+
+    // Last solve
+    double rate, carry, vol;
+    int type;
+    bool early_exercise;
+    int n_intervals; // intervals of the last solve, n_space or more
+    double x_min, dx;
+    double maturity;
+
+    std::vector<double> u; // current time level, u[i] = V(x_i) / K
+    std::vector<double> u_prev; // level one time step closer to expiry than tau = T, for theta
+    std::vector<double> payoff;
+    std::vector<double> rhs, c_prime, d_prime; // Thomas scratch
+};
+
+#endif // PDE_ENGINE_HPP
@@ -0,0 +1,121 @@
+// philox.hpp
+//
+// Philox4x32-10 counter-based random number generator (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3").
+// Every output block is a pure function of (counter, key), so any path/step of a Monte-Carlo run can be generated
+// independently of the others and results do not depend on how paths are split across threads. normal_pool turns
+// the blocks into standard normals.
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#ifndef PHILOX_HPP
+#define PHILOX_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+class philox {
+public:
+    using block = std::array<std::uint32_t, 4>;
+
+    explicit philox(std::uint64_t seed)
+        : key0(static_cast<std::uint32_t>(seed)), key1(static_cast<std::uint32_t>(seed >> 32)) {}
+
+    // Ten rounds of Philox4x32 on the 128-bit counter
+    block operator()(block ctr) const {
+        std::uint32_t k0 = key0, k1 = key1;
+        for (int round = 0; round < 10; ++round) {
+            const std::uint64_t p0 = static_cast<std::uint64_t>(M0) * ctr[0];
+            const std::uint64_t p1 = static_cast<std::uint64_t>(M1) * ctr[2];
+            ctr = {static_cast<std::uint32_t>(p1 >> 32) ^ ctr[1] ^ k0, static_cast<std::uint32_t>(p1),
+                   static_cast<std::uint32_t>(p0 >> 32) ^ ctr[3] ^ k1, static_cast<std::uint32_t>(p0)};
+            k0 += W0;
+            k1 += W1;
+        }
+        return ctr;
+    }
+
+    // Ten rounds on n counters at once, held as structure of arrays (ctr[word][i]); same output as n calls of the
+    // single-block operator. With AVX-512 and n a multiple of 16 the rounds run on 16 blocks per register, all
+    // n / 16 groups interleaved so the multiply latency of one round is hidden behind the others; otherwise the
+    // plain loops are left to the vectoriser.
+    template <std::size_t n>
+    void operator()(std::uint32_t (&ctr)[4][n]) const {
+#if defined(__AVX512F__)
+        if constexpr (n % 16 == 0) {
+            constexpr std::size_t groups = n / 16;
+            __m512i c[4][groups];
+            for (int w = 0; w < 4; ++w) {
+                for (std::size_t g = 0; g < groups; ++g) c[w][g] = _mm512_loadu_si512(ctr[w] + 16 * g);
+            }
+            const __m512i m0 = _mm512_set1_epi32(static_cast<int>(M0)), m1 = _mm512_set1_epi32(static_cast<int>(M1));
+            std::uint32_t k0 = key0, k1 = key1;
+            for (int round = 0; round < 10; ++round) {
+                const __m512i key_0 = _mm512_set1_epi32(static_cast<int>(k0)), key_1 = _mm512_set1_epi32(static_cast<int>(k1));
+                for (std::size_t g = 0; g < groups; ++g) {
+                    __m512i hi0, lo0, hi1, lo1;
+                    mulhilo(c[0][g], m0, hi0, lo0);
+                    mulhilo(c[2][g], m1, hi1, lo1);
+                    c[0][g] = _mm512_xor_si512(_mm512_xor_si512(hi1, c[1][g]), key_0);
+                    c[1][g] = lo1;
+                    c[2][g] = _mm512_xor_si512(_mm512_xor_si512(hi0, c[3][g]), key_1);
+                    c[3][g] = lo0;
+                }
+                k0 += W0;
+                k1 += W1;
+            }
+            for (int w = 0; w < 4; ++w) {
+                for (std::size_t g = 0; g < groups; ++g) _mm512_storeu_si512(ctr[w] + 16 * g, c[w][g]);
+            }
+            return;
+        }
+#endif
+        std::uint32_t k0 = key0, k1 = key1;
+        for (int round = 0; round < 10; ++round) {
+            for (std::size_t i = 0; i < n; ++i) {
+                const std::uint64_t p0 = static_cast<std::uint64_t>(M0) * ctr[0][i];
+                const std::uint64_t p1 = static_cast<std::uint64_t>(M1) * ctr[2][i];
+                const std::uint32_t c1 = ctr[1][i], c3 = ctr[3][i];
+                ctr[0][i] = static_cast<std::uint32_t>(p1 >> 32) ^ c1 ^ k0;
+                ctr[1][i] = static_cast<std::uint32_t>(p1);
+                ctr[2][i] = static_cast<std::uint32_t>(p0 >> 32) ^ c3 ^ k1;
+                ctr[3][i] = static_cast<std::uint32_t>(p0);
+            }
+            k0 += W0;
+            k1 += W1;
+        }
+    }
+
+    // 53-bit uniform strictly inside (0, 1)
+    static double to_unit(std::uint32_t hi, std::uint32_t lo) {
+        const std::uint64_t bits = ((static_cast<std::uint64_t>(hi) << 32) | lo) >> 11;
+        return (static_cast<double>(bits) + 0.5) * 0x1.0p-53;
+    }
+
+private:
+#if defined(__AVX512F__)
+    // High and low halves of the 32 x 32-bit products of 16 lanes: even lanes from one 64-bit multiply, odd lanes
+    // from a second on the counters shifted down
+    static void mulhilo(__m512i a, __m512i m, __m512i& hi, __m512i& lo) {
+        const __m512i even = _mm512_mul_epu32(a, m);
+        const __m512i odd = _mm512_mul_epu32(_mm512_srli_epi64(a, 32), m);
+        lo = _mm512_mask_blend_epi32(0xAAAA, even, _mm512_slli_epi64(odd, 32));
+        hi = _mm512_mask_blend_epi32(0xAAAA, _mm512_srli_epi64(even, 32), odd);
+    }
+#endif
+
+    static constexpr std::uint32_t M0 = 0xD2511F53;
+    static constexpr std::uint32_t M1 = 0xCD9E8D57;
+    static constexpr std::uint32_t W0 = 0x9E3779B9;
+    static constexpr std::uint32_t W1 = 0xBB67AE85;
+
+    std::uint32_t key0;
+    std::uint32_t key1;
+};
+
+#endif // PHILOX_HPP
@@ -0,0 +1,235 @@
+// portfolio.cpp
+//
+// Implementation of the structure-of-arrays portfolio: block storage, conversion to and from the option classes and
+// chunked batch pricing
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#include "portfolio.hpp"
+#include "american_option.hpp"
+#include "asian_option.hpp"
+#include "european_option.hpp"
+#include "parallel.hpp"
+#include "portfolio_file.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+// Contracts per batch call; large enough to amortise the dispatch, small enough for the chunk to stay in L2
+static constexpr std::size_t chunk_rows = 4096;
+
+static void check_option_type(int option_type) {
+    if (option_type != option::CALL && option_type != option::PUT) throw std::domain_error("Select 1 for call or 2 for put");
+}
+
+// Blocks
+void portfolio::contract_block::reserve(std::size_t n) {
+    for (auto* column : {&spot, &strike, &rate, &maturity, &volatility, &cost_of_carry}) column->reserve(n);
+    option_type.reserve(n);
+    position.reserve(n);
+}
+
+void portfolio::contract_block::clear() {
+    for (auto* column : {&spot, &strike, &rate, &maturity, &volatility, &cost_of_carry}) column->clear();
+    option_type.clear();
+    position.clear();
+}
+
+std::uint32_t portfolio::contract_block::push(double S, double K, double r, double T, double sig, double b, int type, std::size_t at) {
+    check_option_type(type);
+    if (size() >= std::numeric_limits<std::uint32_t>::max()) throw std::invalid_argument("Error: too many contracts of one kind in the portfolio");
+    spot.push_back(S);
+    strike.push_back(K);
+    rate.push_back(r);
+    maturity.push_back(T);
+    volatility.push_back(sig);
+    cost_of_carry.push_back(b);
+    option_type.push_back(type);
+    position.push_back(at);
+    return static_cast<std::uint32_t>(size() - 1);
+}
+
+// Adding contracts
+contract_handle portfolio::add_european(double S, double K, double r, double T, double sig, double b, int option_type) {
+    return {contract_kind::european, european.push(S, K, r, T, sig, b, option_type, size())};
+}
+
+contract_handle portfolio::add_american(double S, double K, double r, double T, double sig, double b, int option_type, american_method method) {
+    const std::uint32_t index = american.push(S, K, r, T, sig, b, option_type, size());
+    american.method.push_back(method);
+    return {contract_kind::american, index};
+}
+
+contract_handle portfolio::add_asian(double S, double K, double r, double T, double sig, double b, int option_type, int n_simulations,
+                                     int n_time_steps, const asian_mc_config& config) {
+    const std::uint32_t index = asian.push(S, K, r, T, sig, b, option_type, size());
+    asian.n_simulations.push_back(n_simulations);
+    asian.n_time_steps.push_back(n_time_steps);
+    asian.config.push_back(config);
+    return {contract_kind::asian, index};
+}
+
+contract_handle portfolio::add(const european_option& o) {
+    return add_european(o.spot, o.strike, o.rate, o.maturity, o.volatility, o.cost_of_carry, o.option_type);
+}
+
+contract_handle portfolio::add(const american_option& o) {
+    return add_american(o.spot, o.strike, o.rate, o.maturity, o.volatility, o.cost_of_carry, o.option_type, o.method);
+}
+
+contract_handle portfolio::add(const asian_option& o) {
+    return add_asian(o.spot, o.strike, o.rate, o.maturity, o.volatility, o.cost_of_carry, o.option_type, o.n_simulations, o.n_time_steps, o.mc_config);
+}
+
+portfolio portfolio::from_columns(const portfolio_columns& columns, american_method method) {
+    const std::size_t n = columns.size();
+    const std::size_t n_european = std::count(columns.option_type.begin(), columns.option_type.end(), 1);
+    const std::size_t n_american = std::count(columns.option_type.begin(), columns.option_type.end(), 2);
+    portfolio book;
+    book.reserve(n_european, n_american, n - n_european - n_american);
+    for (std::size_t i = 0; i < n; ++i) {
+        const double S = columns.spot[i], K = columns.strike[i], r = columns.rate[i], T = columns.maturity[i];
+        const double sig = columns.volatility[i], b = columns.cost_of_carry[i];
+        const int type = columns.call_put_type[i];
+        switch (columns.option_type[i]) {
+        case 1:
+            book.add_european(S, K, r, T, sig, b, type);
+            break;
+        case 2:
+            book.add_american(S, K, r, T, sig, b, type, method);
+            break;
+        case 3:
+            book.add_asian(S, K, r, T, sig, b, type, columns.n_simulations[i], columns.n_time_steps[i]);
+            break;
+        default:
+            throw std::domain_error("Invalid option type selected.");
+        }
+    }
+    return book;
+}
+
+void portfolio::reserve(std::size_t n_european, std::size_t n_american, std::size_t n_asian) {
+    european.reserve(n_european);
+    american.reserve(n_american);
+    american.method.reserve(n_american);
+    asian.reserve(n_asian);
+    asian.n_simulations.reserve(n_asian);
+    asian.n_time_steps.reserve(n_asian);
+    asian.config.reserve(n_asian);
+}
+
+void portfolio::clear() {
+    european.clear();
+    american.clear();
+    american.method.clear();
+    asian.clear();
+    asian.n_simulations.clear();
+    asian.n_time_steps.clear();
+    asian.config.clear();
+}
+
+std::size_t portfolio::count(contract_kind kind) const {
+    switch (kind) {
+    case contract_kind::european:
+        return european.size();
+    case contract_kind::american:
+        return american.size();
+    default:
+        return asian.size();
+    }
+}
+
+// Single lookups
+void portfolio::check(contract_handle handle) const {
+    if (handle.index >= count(handle.kind)) throw std::invalid_argument("Error: contract handle out of range");
+}
+
+std::unique_ptr<option> portfolio::at(contract_handle handle) const {
+    check(handle);
+    const std::size_t i = handle.index;
+    switch (handle.kind) {
+    case contract_kind::european:
+        return std::make_unique<european_option>(european.spot[i], european.strike[i], european.rate[i], european.maturity[i],
+                                                 european.volatility[i], european.cost_of_carry[i], european.option_type[i]);
+    case contract_kind::american:
+        return std::make_unique<american_option>(american.spot[i], american.strike[i], american.rate[i], american.maturity[i],
+                                                 american.volatility[i], american.cost_of_carry[i], american.option_type[i], american.method[i]);
+    default: {
+        auto o = std::make_unique<asian_option>(asian.spot[i], asian.strike[i], asian.rate[i], asian.maturity[i], asian.volatility[i],
+                                                asian.cost_of_carry[i], asian.option_type[i], asian.n_simulations[i], asian.n_time_steps[i]);
+        o->mc_config = asian.config[i];
+        return o;
+    }
+    }
+}
+
+double portfolio::price(contract_handle handle) const {
+    check(handle);
+    double value;
+    switch (handle.kind) {
+    case contract_kind::european:
+        price_european(handle.index, 1, {&value, 1});
+        return value;
+    case contract_kind::american:
+        price_american(handle.index, 1, {&value, 1});
+        return value;
+    default:
+        return price_asian(handle.index, asian.config[handle.index].n_threads);
+    }
+}
+
+// Kernels on a range of one block
+void portfolio::price_european(std::size_t first, std::size_t count, std::span<double> scratch) const {
+    auto slice = [&](const auto& column) { return std::span(column).subspan(first, count); };
+    pricer.price_european_batch(slice(european.spot), slice(european.strike), slice(european.rate), slice(european.maturity),
+                                slice(european.volatility), slice(european.cost_of_carry), slice(european.option_type), scratch.first(count));
+}
+
+void portfolio::price_american(std::size_t first, std::size_t count, std::span<double> scratch) const {
+    // One batch call per run of contracts sharing a method (normally the whole range)
+    for (std::size_t end = first + count, run = first; run < end;) {
+        const american_method method = american.method[run];
+        std::size_t last = run + 1;
+        while (last < end && american.method[last] == method) ++last;
+        auto slice = [&](const auto& column) { return std::span(column).subspan(run, last - run); };
+        pricer.price_american_batch(slice(american.spot), slice(american.strike), slice(american.rate), slice(american.maturity),
+                                    slice(american.volatility), slice(american.cost_of_carry), slice(american.option_type), method,
+                                    scratch.subspan(run - first, last - run));
+        run = last;
+    }
+}
+
+double portfolio::price_asian(std::size_t i, unsigned n_threads) const {
+    asian_mc_config config = asian.config[i];
+    config.n_threads = n_threads;
+    return pricer.price_asian_mc(asian.spot[i], asian.strike[i], asian.maturity[i], asian.rate[i], asian.volatility[i], asian.cost_of_carry[i],
+                                 asian.n_time_steps[i], asian.n_simulations[i], asian.option_type[i], config).price;
+}
+
+// Bulk pricing: European chunks, then American chunks, then one work item per Asian contract (each is a full
+// Monte-Carlo run, so they are the unit of load balancing). Chunks are priced into per-thread scratch and
+// scattered to insertion order.
+void portfolio::price(std::span<double> prices, unsigned n_threads) const {
+    if (prices.size() != size()) throw std::invalid_argument("Error: prices must have one entry per contract");
+    const std::size_t european_chunks = (european.size() + chunk_rows - 1) / chunk_rows;
+    const std::size_t american_chunks = (american.size() + chunk_rows - 1) / chunk_rows;
+    const std::size_t n_blocks = european_chunks + american_chunks + asian.size();
+    std::vector<std::vector<double>> scratch(parallel::resolve_threads(n_threads), std::vector<double>(chunk_rows));
+
+    parallel::for_blocks(n_blocks, n_threads, [&](std::size_t block, unsigned thread) {
+        if (block >= european_chunks + american_chunks) {
+            const std::size_t i = block - european_chunks - american_chunks;
+            prices[asian.position[i]] = price_asian(i, 1); // the book is already spread across the threads
+            return;
+        }
+        const bool is_european = block < european_chunks;
+        const contract_block& contracts = is_european ? european : static_cast<const contract_block&>(american);
+        const std::size_t first = (is_european ? block : block - european_chunks) * chunk_rows;
+        const std::size_t count = std::min(chunk_rows, contracts.size() - first);
+        std::span<double> values(scratch[thread]);
+        if (is_european) price_european(first, count, values);
+        else price_american(first, count, values);
+        for (std::size_t i = 0; i < count; ++i) prices[contracts.position[first + i]] = values[i];
+    });
+}
@@ -0,0 +1,106 @@
+// portfolio.hpp
+//
+// In-memory book of mixed European, American and Asian contracts for pricing without a std::unique_ptr<option>
+// and a virtual price() call per contract. Contracts are kept in one structure-of-arrays block per kind; price()
+// walks each block in chunks and hands a whole chunk to the batch kernel of its kind (price_european_batch,
+// price_american_batch), so dispatch happens once per chunk rather than once per contract. Asian contracts have no
+// batch kernel and are priced one Monte-Carlo run per contract, spread over the threads.
+//
+// Contracts go in from the option classes or from raw parameters and come back out as option objects for single
+// lookups; a contract_handle names a contract by kind and index within its block. Prices come back in insertion
+// order.
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#ifndef PORTFOLIO_HPP
+#define PORTFOLIO_HPP
+
+#include "option.hpp"
+#include "pricing_methods.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+class european_option;
+class american_option;
+class asian_option;
+struct portfolio_columns;
+
+enum class contract_kind : std::uint8_t {
+    european,
+    american,
+    asian
+};
+
+// A contract's block and its index within the block
+struct contract_handle {
+    contract_kind kind;
+    std::uint32_t index;
+};
+
+class portfolio {
+    friend class risk_engine; // walks the blocks directly for Greek aggregation
+    friend class scenario_engine; // reprices shocked copies of the blocks' columns
+public:
+    portfolio() = default;
+
+    // Copies the option's parameters (and method or Monte-Carlo settings) into the book
+    contract_handle add(const european_option& o);
+    contract_handle add(const american_option& o);
+    contract_handle add(const asian_option& o);
+    // Raw parameters; option_type is option::CALL or option::PUT
+    contract_handle add_european(double S, double K, double r, double T, double sig, double b, int option_type);
+    contract_handle add_american(double S, double K, double r, double T, double sig, double b, int option_type,
+                                 american_method method = american_method::bjerksund_stensland);
+    contract_handle add_asian(double S, double K, double r, double T, double sig, double b, int option_type, int n_simulations = 10000,
+                              int n_time_steps = 252, const asian_mc_config& config = asian_mc_config());
+
+    // Book built from portfolio_file columns (option_type 1 European, 2 American, 3 Asian), in column order
+    static portfolio from_columns(const portfolio_columns& columns, american_method method = american_method::bjerksund_stensland);
+
+    void reserve(std::size_t n_european, std::size_t n_american, std::size_t n_asian);
+    void clear();
+    std::size_t size() const { return european.size() + american.size() + asian.size(); }
+    std::size_t count(contract_kind kind) const;
+
+    // Single lookups: the contract as an option object, and its price from the same kernel as the bulk price()
+    std::unique_ptr<option> at(contract_handle handle) const;
+    double price(contract_handle handle) const;
+
+    // Every contract, prices[i] for the i-th contract added (n_threads 0 = all cores)
+    void price(std::span<double> prices, unsigned n_threads = 0) const;
+
+private:
+    struct contract_block {
+        std::vector<double> spot, strike, rate, maturity, volatility, cost_of_carry;
+        std::vector<int> option_type;
+        std::vector<std::size_t> position; // insertion index, where the contract's price goes
+
+        std::size_t size() const { return spot.size(); }
+        void reserve(std::size_t n);
+        void clear();
+        std::uint32_t push(double S, double K, double r, double T, double sig, double b, int type, std::size_t at);
+    };
+    struct american_block : contract_block {
+        std::vector<american_method> method;
+    };
+    struct asian_block : contract_block {
+        std::vector<int> n_simulations, n_time_steps;
+        std::vector<asian_mc_config> config;
+    };
+
+    void check(contract_handle handle) const;
+    void price_european(std::size_t first, std::size_t count, std::span<double> scratch) const;
+    void price_american(std::size_t first, std::size_t count, std::span<double> scratch) const;
+    double price_asian(std::size_t index, unsigned n_threads) const;
+
+    contract_block european;
+    american_block american;
+    asian_block asian;
+    pricing_methods pricer;
+};
+
+#endif // PORTFOLIO_HPP
@@ -0,0 +1,346 @@
+// portfolio_file.cpp
+//
+// Binary portfolio writer and memory mapping, parallel text loader and column pricing
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#include "portfolio_file.hpp"
+#include "portfolio.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define PORTFOLIO_HAS_MMAP 1
+#endif
+
+// Binary header: magic, version, column count, contract count and the byte offset of each column
+static constexpr char portfolio_magic[8] = {'O', 'P', 'T', 'P', 'O', 'R', 'T', '\0'};
+static constexpr std::size_t portfolio_columns_count = 10;
+static constexpr std::size_t column_alignment = 64;
+
+struct portfolio_header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t column_count;
+    std::uint64_t contracts;
+    std::uint64_t offsets[portfolio_columns_count];
+    char reserved[24];
+};
+static_assert(sizeof(portfolio_header) == 128, "portfolio header must stay 128 bytes");
+// Header and columns are written and mapped in host byte order, which the format fixes as little-endian
+static_assert(std::endian::native == std::endian::little, "portfolio files are little-endian; this host is not");
+
+// Column names in file order (the text header uses the same keys as options.txt)
+static constexpr std::string_view column_names[portfolio_columns_count] = {
+    "spot", "strike", "rate", "volatility", "maturity", "cost_of_carry", "option_type", "call_put_type", "nSimulations", "nTimeSteps"};
+static constexpr std::size_t first_int_column = 6;
+
+static std::size_t column_width(std::size_t column) {
+    return column < first_int_column ? sizeof(double) : sizeof(std::int32_t);
+}
+
+static std::size_t align_up(std::size_t bytes) {
+    return (bytes + column_alignment - 1) / column_alignment * column_alignment;
+}
+
+void portfolio_data::resize(std::size_t n) {
+    for (auto* column : {&spot, &strike, &rate, &volatility, &maturity, &cost_of_carry}) column->resize(n);
+    for (auto* column : {&option_type, &call_put_type, &n_simulations, &n_time_steps}) column->resize(n);
+}
+
+portfolio_columns portfolio_data::columns() const {
+    return {spot, strike, rate, volatility, maturity, cost_of_carry, option_type, call_put_type, n_simulations, n_time_steps};
+}
+
+// Column c of a view as raw bytes, in file order
+static const void* column_data(const portfolio_columns& columns, std::size_t c) {
+    const void* data[portfolio_columns_count] = {
+        columns.spot.data(), columns.strike.data(), columns.rate.data(), columns.volatility.data(), columns.maturity.data(),
+        columns.cost_of_carry.data(), columns.option_type.data(), columns.call_put_type.data(), columns.n_simulations.data(),
+        columns.n_time_steps.data()};
+    return data[c];
+}
+
+static void check_column_sizes(const portfolio_columns& columns) {
+    const std::size_t n = columns.size();
+    if (columns.strike.size() != n || columns.rate.size() != n || columns.volatility.size() != n || columns.maturity.size() != n
+        || columns.cost_of_carry.size() != n || columns.option_type.size() != n || columns.call_put_type.size() != n
+        || columns.n_simulations.size() != n || columns.n_time_steps.size() != n) {
+        throw std::invalid_argument("Error: portfolio columns must all have the same length");
+    }
+}
+
+namespace portfolio_io {
+
+void write_binary(const std::string& path, const portfolio_columns& columns) {
+    check_column_sizes(columns);
+    const std::size_t n = columns.size();
+    portfolio_header header{};
+    std::memcpy(header.magic, portfolio_magic, sizeof(portfolio_magic));
+    header.version = format_version;
+    header.column_count = portfolio_columns_count;
+    header.contracts = n;
+    std::size_t offset = sizeof(portfolio_header);
+    for (std::size_t c = 0; c < portfolio_columns_count; ++c) {
+        header.offsets[c] = offset;
+        offset += align_up(n * column_width(c));
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) throw std::runtime_error("Error: could not open " + path);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    const char padding[column_alignment] = {};
+    for (std::size_t c = 0; c < portfolio_columns_count; ++c) {
+        const std::size_t bytes = n * column_width(c);
+        file.write(static_cast<const char*>(column_data(columns, c)), static_cast<std::streamsize>(bytes));
+        file.write(padding, static_cast<std::streamsize>(align_up(bytes) - bytes));
+    }
+    if (!file) throw std::runtime_error("Error: failed writing " + path);
+}
+
+} // namespace portfolio_io
+
+mapped_portfolio::mapped_portfolio(const std::string& path) {
+#ifdef PORTFOLIO_HAS_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Error: could not open " + path);
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Error: could not stat " + path);
+    }
+    length = static_cast<std::size_t>(info.st_size);
+    if (length > 0) {
+        void* address = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Error: could not map " + path);
+        }
+        base = address;
+        mapped = true;
+    }
+    ::close(fd);
+#else
+    // No mmap: read the file into one buffer of doubles (keeps the columns aligned)
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) throw std::runtime_error("Error: could not open " + path);
+    length = static_cast<std::size_t>(file.tellg());
+    base = new double[(length + sizeof(double) - 1) / sizeof(double)];
+    file.seekg(0);
+    file.read(static_cast<char*>(base), static_cast<std::streamsize>(length));
+#endif
+
+    portfolio_header header;
+    const std::string invalid = "Error: " + path + " is not a version " + std::to_string(portfolio_io::format_version) + " portfolio file";
+    if (length < sizeof(header)) {
+        release();
+        throw std::runtime_error(invalid);
+    }
+    std::memcpy(&header, base, sizeof(header));
+    bool ok = std::memcmp(header.magic, portfolio_magic, sizeof(portfolio_magic)) == 0 && header.version == portfolio_io::format_version
+              && header.column_count == portfolio_columns_count;
+    for (std::size_t c = 0; ok && c < portfolio_columns_count; ++c) {
+        ok = header.offsets[c] % column_alignment == 0 && header.offsets[c] <= length
+             && header.contracts <= (length - header.offsets[c]) / column_width(c);
+    }
+    if (!ok) {
+        release();
+        throw std::runtime_error(invalid);
+    }
+
+    const char* bytes = static_cast<const char*>(base);
+    const std::size_t n = header.contracts;
+    auto doubles = [&](std::size_t c) { return std::span<const double>(reinterpret_cast<const double*>(bytes + header.offsets[c]), n); };
+    auto ints = [&](std::size_t c) { return std::span<const int>(reinterpret_cast<const int*>(bytes + header.offsets[c]), n); };
+    view = {doubles(0), doubles(1), doubles(2), doubles(3), doubles(4), doubles(5), ints(6), ints(7), ints(8), ints(9)};
+}
+
+mapped_portfolio::~mapped_portfolio() {
+    release();
+}
+
+void mapped_portfolio::release() {
+#ifdef PORTFOLIO_HAS_MMAP
+    if (mapped) ::munmap(base, length);
+#else
+    delete[] static_cast<double*>(base);
+#endif
+    base = nullptr;
+    mapped = false;
+}
+
+// Text loading
+// Calls fn(line) for every non-empty line in [begin, end), with a trailing '\r' removed
+template <class F>
+static void for_each_line(const char* begin, const char* end, F&& fn) {
+    while (begin < end) {
+        const char* newline = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+        const char* line_end = newline ? newline : end;
+        std::string_view line(begin, line_end - begin);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (!line.empty()) fn(line);
+        begin = line_end + 1;
+    }
+}
+
+static std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) text.remove_suffix(1);
+    return text;
+}
+
+// Parses one field into column c of row `row`; false if the text is not a complete number
+static bool parse_field(std::string_view text, std::size_t c, std::size_t row, portfolio_data& data) {
+    text = trim(text);
+    const char* first = text.data();
+    const char* last = first + text.size();
+    std::from_chars_result result;
+    if (c < first_int_column) {
+        std::vector<double>* columns[] = {&data.spot, &data.strike, &data.rate, &data.volatility, &data.maturity, &data.cost_of_carry};
+        result = std::from_chars(first, last, (*columns[c])[row]);
+    } else {
+        std::vector<int>* columns[] = {&data.option_type, &data.call_put_type, &data.n_simulations, &data.n_time_steps};
+        result = std::from_chars(first, last, (*columns[c - first_int_column])[row]);
+    }
+    return result.ec == std::errc() && result.ptr == last && first != last;
+}
+
+static std::size_t column_index(std::string_view name) {
+    for (std::size_t c = 0; c < portfolio_columns_count; ++c) {
+        if (column_names[c] == trim(name)) return c;
+    }
+    throw std::invalid_argument("Error: unknown portfolio column " + std::string(name));
+}
+
+static void fill_defaults(portfolio_data& data, const bool present[portfolio_columns_count]) {
+    for (std::size_t c = 0; c < portfolio_columns_count; ++c) {
+        if (present[c]) continue;
+        if (column_names[c] == "nSimulations") std::fill(data.n_simulations.begin(), data.n_simulations.end(), 10000);
+        else if (column_names[c] == "nTimeSteps") std::fill(data.n_time_steps.begin(), data.n_time_steps.end(), 252);
+        else throw std::invalid_argument("Error: portfolio is missing the " + std::string(column_names[c]) + " column");
+    }
+}
+
+// The key: value layout of options.txt (one contract)
+static portfolio_data load_key_value(std::string_view text) {
+    portfolio_data data;
+    data.resize(1);
+    bool present[portfolio_columns_count] = {};
+    for_each_line(text.data(), text.data() + text.size(), [&](std::string_view line) {
+        const std::size_t colon = line.find(':');
+        if (colon == std::string_view::npos) return;
+        const std::size_t c = column_index(line.substr(0, colon));
+        if (!parse_field(line.substr(colon + 1), c, 0, data)) {
+            throw std::invalid_argument("Error: bad value for " + std::string(column_names[c]));
+        }
+        present[c] = true;
+    });
+    fill_defaults(data, present);
+    return data;
+}
+
+namespace portfolio_io {
+
+portfolio_data load_text(const std::string& path, unsigned n_threads) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) throw std::runtime_error("Error: could not open " + path);
+    std::string text(static_cast<std::size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    file.read(text.data(), static_cast<std::streamsize>(text.size()));
+
+    const char* const begin = text.data();
+    const char* const end = begin + text.size();
+    const char* header_end = static_cast<const char*>(std::memchr(begin, '\n', text.size()));
+    if (!header_end) header_end = end;
+    const std::string_view header = trim(std::string_view(begin, header_end - begin));
+    if (header.find(':') != std::string_view::npos) return load_key_value(text);
+
+    // CSV header -> file column of each field
+    std::vector<std::size_t> fields;
+    bool present[portfolio_columns_count] = {};
+    for (std::size_t start = 0; start <= header.size();) {
+        std::size_t comma = header.find(',', start);
+        if (comma == std::string_view::npos) comma = header.size();
+        std::string_view name = header.substr(start, comma - start);
+        if (!name.empty() && name.back() == '\r') name.remove_suffix(1);
+        const std::size_t c = column_index(name);
+        if (present[c]) throw std::invalid_argument("Error: duplicate portfolio column " + std::string(column_names[c]));
+        present[c] = true;
+        fields.push_back(c);
+        start = comma + 1;
+    }
+
+    // Split the body into chunks at line boundaries; count rows per chunk, then parse every chunk into its rows
+    const char* body = std::min(header_end + 1, end);
+    constexpr std::size_t min_chunk_bytes = 1 << 20;
+    const std::size_t workers = parallel::resolve_threads(n_threads);
+    const std::size_t n_chunks = std::max<std::size_t>(1, std::min<std::size_t>(workers * 4, (end - body) / min_chunk_bytes));
+    std::vector<const char*> bounds(n_chunks + 1, end);
+    bounds[0] = body;
+    for (std::size_t k = 1; k < n_chunks; ++k) {
+        const char* guess = std::max(body + (end - body) * k / n_chunks, bounds[k - 1]);
+        const char* newline = static_cast<const char*>(std::memchr(guess, '\n', end - guess));
+        bounds[k] = newline ? newline + 1 : end;
+    }
+
+    std::vector<std::size_t> first_row(n_chunks + 1, 0);
+    parallel::for_blocks(n_chunks, n_threads, [&](std::size_t k, unsigned) {
+        std::size_t rows = 0;
+        for_each_line(bounds[k], bounds[k + 1], [&](std::string_view) { ++rows; });
+        first_row[k + 1] = rows;
+    });
+    for (std::size_t k = 0; k < n_chunks; ++k) first_row[k + 1] += first_row[k];
+
+    portfolio_data data;
+    data.resize(first_row[n_chunks]);
+    parallel::for_blocks(n_chunks, n_threads, [&](std::size_t k, unsigned) {
+        std::size_t row = first_row[k];
+        for_each_line(bounds[k], bounds[k + 1], [&](std::string_view line) {
+            std::size_t start = 0;
+            for (std::size_t f = 0; f < fields.size(); ++f) {
+                std::size_t comma = line.find(',', start);
+                if (comma == std::string_view::npos) comma = line.size();
+                const bool last_field = f + 1 == fields.size();
+                if ((comma == line.size()) != last_field || !parse_field(line.substr(start, comma - start), fields[f], row, data)) {
+                    throw std::invalid_argument("Error: malformed portfolio row " + std::to_string(row + 1));
+                }
+                start = comma + 1;
+            }
+            ++row;
+        });
+    });
+    fill_defaults(data, present);
+    return data;
+}
+
+bool is_binary(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) throw std::runtime_error("Error: could not open " + path);
+    char magic[sizeof(portfolio_magic)] = {};
+    file.read(magic, sizeof(magic));
+    return file.gcount() == sizeof(magic) && std::memcmp(magic, portfolio_magic, sizeof(magic)) == 0;
+}
+
+void convert_text_to_binary(const std::string& text_path, const std::string& binary_path, unsigned n_threads) {
+    const portfolio_data data = load_text(text_path, n_threads);
+    write_binary(binary_path, data.columns());
+}
+
+void price(const portfolio_columns& columns, std::span<double> prices, unsigned n_threads, american_method method) {
+    check_column_sizes(columns);
+    if (prices.size() != columns.size()) throw std::invalid_argument("Error: batch input spans must all have the same length");
+    portfolio::from_columns(columns, method).price(prices, n_threads);
+}
+
+} // namespace portfolio_io
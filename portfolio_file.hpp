@@ -0,0 +1,90 @@
+// portfolio_file.hpp
+//
+// Portfolio storage for start-of-day loads of millions of contracts.
+//
+// Binary layout (little-endian, version 1): a 128-byte header followed by one fixed-width column per field, each
+// starting on a 64-byte boundary. Columns are spot, strike, rate, volatility, maturity, cost_of_carry (double) and
+// option_type (1 European, 2 American, 3 Asian), call_put_type (1 call, 2 put), nSimulations, nTimeSteps (int32).
+// mapped_portfolio maps the file read-only and hands the columns out as spans with no copy or parse step. Files
+// are read and written in host byte order, so the library only builds for little-endian hosts (a static_assert in
+// portfolio_file.cpp).
+//
+// Text layout: CSV with a header line naming the columns with the same keys as options.txt (any order;
+// nSimulations and nTimeSteps default to 10000 and 252), or the single-contract "key: value" file read by
+// file_interface. The CSV loader splits the file at line boundaries and parses the pieces on all cores.
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#ifndef PORTFOLIO_FILE_HPP
+#define PORTFOLIO_FILE_HPP
+
+#include "pricing_methods.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Read-only view of a portfolio's columns (one contract per index)
+struct portfolio_columns {
+    std::span<const double> spot, strike, rate, volatility, maturity, cost_of_carry;
+    std::span<const int> option_type, call_put_type, n_simulations, n_time_steps;
+
+    std::size_t size() const { return spot.size(); }
+};
+
+// Portfolio held in memory, column by column
+struct portfolio_data {
+    std::vector<double> spot, strike, rate, volatility, maturity, cost_of_carry;
+    std::vector<int> option_type, call_put_type, n_simulations, n_time_steps;
+
+    void resize(std::size_t n);
+    std::size_t size() const { return spot.size(); }
+    portfolio_columns columns() const;
+};
+
+// Binary portfolio file mapped into memory; the columns stay valid for the lifetime of the object
+class mapped_portfolio {
+public:
+    explicit mapped_portfolio(const std::string& path);
+    ~mapped_portfolio();
+    mapped_portfolio(const mapped_portfolio&) = delete;
+    mapped_portfolio& operator=(const mapped_portfolio&) = delete;
+
+    const portfolio_columns& columns() const { return view; }
+    std::size_t size() const { return view.size(); }
+
+private:
+    void release();
+
+    void* base = nullptr; // mapping (or fallback buffer)
+    std::size_t length = 0;
+    bool mapped = false;
+    portfolio_columns view;
+};
+
+namespace portfolio_io {
+
+inline constexpr std::uint32_t format_version = 1;
+
+// Writes columns in the binary layout above
+void write_binary(const std::string& path, const portfolio_columns& columns);
+
+// CSV (parallel over n_threads, 0 = all cores) or single-contract key: value text, detected from the first line
+portfolio_data load_text(const std::string& path, unsigned n_threads = 0);
+
+// True if the file starts with the binary layout's magic (any version), i.e. it is for mapped_portfolio, not load_text
+bool is_binary(const std::string& path);
+
+// Text (either layout) to binary
+void convert_text_to_binary(const std::string& text_path, const std::string& binary_path, unsigned n_threads = 0);
+
+// Prices every contract through portfolio::from_columns(columns, method).price, so a file prices exactly as the
+// same contracts added to a portfolio
+void price(const portfolio_columns& columns, std::span<double> prices, unsigned n_threads = 0,
+           american_method method = american_method::bjerksund_stensland);
+
+} // namespace portfolio_io
+
+#endif // PORTFOLIO_FILE_HPP
@@ -0,0 +1,386 @@
+// pricing_daemon.cpp
+//
+// Implementation of the pricing daemon: accept loop, per-connection readers and writers, and the coalescing batcher
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#include "pricing_daemon.hpp"
+#include "bounded_queue.hpp"
+#include "daemon_protocol.hpp"
+#include "latency_histogram.hpp"
+#include "european_option.hpp"
+#include "asian_option.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <csignal>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+
+// One client socket; closed when its reader, its writer and every queued request are done with it. Only the writer
+// writes to it: the batcher appends to the outbox and moves on.
+struct daemon_connection {
+    explicit daemon_connection(int fd) : fd(fd) {}
+    ~daemon_connection() { ::close(fd); }
+    daemon_connection(const daemon_connection&) = delete;
+    daemon_connection& operator=(const daemon_connection&) = delete;
+
+    int fd;
+    std::vector<daemon_protocol::reply> batch_replies; // replies of the current batch (batcher only)
+
+    std::mutex mutex; // guards the members below
+    std::condition_variable changed;
+    std::vector<daemon_protocol::reply> outbox; // replies waiting for the writer
+    std::size_t in_flight = 0; // requests read but not yet written back, at most max_in_flight
+    bool reading = true;
+};
+
+struct queued_request {
+    daemon_protocol::request message;
+    std::shared_ptr<daemon_connection> client;
+    clock_type::time_point received;
+};
+
+// Writer thread of a connection: sends whatever the batcher has handed over, one write per hand-over, until the
+// reader has stopped and every request it read has been answered. After a failed write the rest are dropped.
+static void write_replies(daemon_connection& client) {
+    std::vector<daemon_protocol::reply> writing;
+    bool writable = true;
+    std::unique_lock lock(client.mutex);
+    while (true) {
+        client.changed.wait(lock, [&] { return !client.outbox.empty() || (!client.reading && client.in_flight == 0); });
+        if (client.outbox.empty()) return;
+        writing.swap(client.outbox);
+        lock.unlock();
+        if (writable) writable = daemon_protocol::write_full(client.fd, writing.data(), writing.size() * sizeof(daemon_protocol::reply));
+        lock.lock();
+        client.in_flight -= writing.size();
+        writing.clear();
+        client.changed.notify_all(); // the reader may be waiting at the window
+    }
+}
+
+// Reader thread of a connection: queues requests, holding off at max_in_flight unanswered ones (or until the daemon
+// stops, since a client that does not read would otherwise keep it there)
+static void read_requests(const std::shared_ptr<daemon_connection>& owner, bounded_queue<queued_request>& queue, const std::atomic<bool>& running) {
+    daemon_connection& client = *owner;
+    std::thread writer(write_replies, std::ref(client));
+    daemon_protocol::request message;
+    while (running && daemon_protocol::read_full(client.fd, &message, sizeof(message))) {
+        {
+            std::unique_lock lock(client.mutex);
+            client.changed.wait(lock, [&] { return client.in_flight < daemon_protocol::max_in_flight || !running; });
+            if (!running) break;
+            ++client.in_flight;
+        }
+        if (!queue.push({message, owner, clock_type::now()})) {
+            const std::lock_guard lock(client.mutex);
+            --client.in_flight;
+            break;
+        }
+    }
+    {
+        const std::lock_guard lock(client.mutex);
+        client.reading = false;
+    }
+    client.changed.notify_all();
+    writer.join();
+}
+
+// Batcher state kept warm across batches
+struct batcher_state {
+    pricing_methods pricer;
+    latency_histogram latency; // nanoseconds
+    std::uint64_t batches = 0;
+    std::uint64_t batched_requests = 0;
+
+    // Staging for the batch kernels
+    std::vector<std::size_t> index;
+    std::vector<double> S, K, r, T, sig, b, prices;
+    std::vector<int> type;
+
+    // Asian Monte-Carlo results by contract (the seed is fixed, so a repeat gives the same price)
+    using asian_key = std::tuple<double, double, double, double, double, double, int, int, int>;
+    std::map<asian_key, mc_result> asian_cache;
+    static constexpr std::size_t asian_cache_limit = 4096;
+};
+
+static constexpr std::uint8_t european_outputs = daemon_protocol::out_price | daemon_protocol::out_delta | daemon_protocol::out_gamma
+                                                 | daemon_protocol::out_vega | daemon_protocol::out_theta | daemon_protocol::out_rho
+                                                 | daemon_protocol::out_pcp_price;
+static constexpr std::uint8_t american_outputs = daemon_protocol::out_price | daemon_protocol::out_delta | daemon_protocol::out_gamma
+                                                 | daemon_protocol::out_vega | daemon_protocol::out_theta | daemon_protocol::out_rho;
+static constexpr std::uint8_t asian_outputs = daemon_protocol::out_price | daemon_protocol::out_std_error;
+
+static bool valid_inputs(const daemon_protocol::request& m) {
+    const bool finite = std::isfinite(m.spot) && std::isfinite(m.strike) && std::isfinite(m.rate) && std::isfinite(m.volatility)
+                        && std::isfinite(m.maturity) && std::isfinite(m.cost_of_carry);
+    const bool positive = m.spot > 0 && m.strike > 0 && m.volatility > 0 && m.maturity > 0;
+    const bool simulation = m.option_type != 3 || (m.n_simulations > 0 && m.n_time_steps > 0);
+    return finite && positive && simulation && m.option_type >= 1 && m.option_type <= 3 && (m.call_put_type == 1 || m.call_put_type == 2);
+}
+
+// Writes value into the reply slot of its output bit
+static void set_output(daemon_protocol::reply& reply, std::uint8_t bit, double value) {
+    if (reply.outputs & bit) reply.values[std::countr_zero(bit)] = value;
+}
+
+// Requests that need more than a price go through the option classes
+static void price_single(const daemon_protocol::request& m, daemon_protocol::reply& reply, batcher_state& state) {
+    using namespace daemon_protocol;
+    const int type = (m.call_put_type == 1) ? option::CALL : option::PUT;
+    if (m.option_type == 1) {
+        const european_greeks g = european_option(m.spot, m.strike, m.rate, m.maturity, m.volatility, m.cost_of_carry, type).price_and_greeks();
+        const double values[] = {g.price, g.delta, g.gamma, g.vega, g.theta, g.rho, g.pcp_price};
+        for (std::size_t k = 0; k < std::size(values); ++k) set_output(reply, static_cast<std::uint8_t>(1u << k), values[k]);
+    } else if (m.option_type == 2) { // Bjerksund-Stensland as in the batch kernel, Greeks bumped on the same formula
+        const american_greeks g = state.pricer.price_and_greeks_american(m.spot, m.strike, m.rate, m.maturity, m.volatility, m.cost_of_carry, type,
+                                                                         american_method::bjerksund_stensland);
+        const double values[] = {g.price, g.delta, g.gamma, g.vega, g.theta, g.rho};
+        for (std::size_t k = 0; k < std::size(values); ++k) set_output(reply, static_cast<std::uint8_t>(1u << k), values[k]);
+    } else {
+        const batcher_state::asian_key key{m.spot, m.strike, m.rate, m.maturity, m.volatility, m.cost_of_carry, m.call_put_type, m.n_simulations, m.n_time_steps};
+        auto cached = state.asian_cache.find(key);
+        if (cached == state.asian_cache.end()) {
+            asian_option asian_opt(m.spot, m.strike, m.rate, m.maturity, m.volatility, m.cost_of_carry, type, m.n_simulations, m.n_time_steps);
+            asian_opt.set_threads(1); // stays on the batcher thread
+            if (state.asian_cache.size() >= batcher_state::asian_cache_limit) state.asian_cache.clear();
+            cached = state.asian_cache.emplace(key, asian_opt.price_with_error()).first;
+        }
+        set_output(reply, out_price, cached->second.price);
+        set_output(reply, out_std_error, cached->second.std_error);
+    }
+}
+
+// Prices one price-only run (European or American) through its batch kernel
+static void price_staged(batcher_state& state, int option_type, std::vector<daemon_protocol::reply>& replies) {
+    if (state.index.empty()) return;
+    state.prices.resize(state.index.size());
+    if (option_type == 1) {
+        state.pricer.price_european_batch(state.S, state.K, state.r, state.T, state.sig, state.b, state.type, state.prices);
+    } else {
+        state.pricer.price_american_batch(state.S, state.K, state.r, state.T, state.sig, state.b, state.type,
+                                          american_method::bjerksund_stensland, state.prices);
+    }
+    for (std::size_t j = 0; j < state.index.size(); ++j) replies[state.index[j]].values[0] = state.prices[j];
+}
+
+static void stage(batcher_state& state, std::size_t i, const daemon_protocol::request& m) {
+    state.index.push_back(i);
+    state.S.push_back(m.spot);
+    state.K.push_back(m.strike);
+    state.r.push_back(m.rate);
+    state.T.push_back(m.maturity);
+    state.sig.push_back(m.volatility);
+    state.b.push_back(m.cost_of_carry);
+    state.type.push_back((m.call_put_type == 1) ? option::CALL : option::PUT);
+}
+
+static void clear_stage(batcher_state& state) {
+    for (auto* column : {&state.S, &state.K, &state.r, &state.T, &state.sig, &state.b, &state.prices}) column->clear();
+    state.index.clear();
+    state.type.clear();
+}
+
+// Fills the reply of every request in the batch; returns true if one of them asked the daemon to shut down
+static bool answer_batch(const std::vector<queued_request>& batch, std::vector<daemon_protocol::reply>& replies, batcher_state& state) {
+    using namespace daemon_protocol;
+    bool shutdown_requested = false;
+    replies.assign(batch.size(), reply{});
+    for (int option_type : {1, 2}) { // price-only runs, one kernel call per kind
+        clear_stage(state);
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            const request& m = batch[i].message;
+            if (m.type == price && m.version == version && m.option_type == option_type && (m.outputs == 0 || m.outputs == out_price)
+                && valid_inputs(m)) {
+                replies[i].outputs = out_price;
+                stage(state, i, m);
+            }
+        }
+        price_staged(state, option_type, replies);
+    }
+
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        const request& m = batch[i].message;
+        reply& out = replies[i];
+        out.type = m.type;
+        out.id = m.id;
+        if (out.outputs) continue; // priced in a kernel above
+        if (m.version != version) {
+            out.status = bad_message;
+        } else if (m.type == price) {
+            const std::uint8_t wanted = m.outputs ? m.outputs : static_cast<std::uint8_t>(out_price);
+            const std::uint8_t offered = (m.option_type == 1) ? european_outputs : (m.option_type == 2) ? american_outputs : asian_outputs;
+            if (!valid_inputs(m)) {
+                out.status = invalid_input;
+            } else if (wanted & ~offered) {
+                out.status = unsupported_output;
+            } else {
+                out.outputs = wanted;
+                try {
+                    price_single(m, out, state);
+                } catch (const std::exception&) {
+                    out.status = invalid_input;
+                    out.outputs = 0;
+                }
+            }
+        } else if (m.type == stats) {
+            const double us = 1e-3;
+            out.values[stats_count] = static_cast<double>(state.latency.count());
+            out.values[stats_p50] = state.latency.percentile(0.50) * us;
+            out.values[stats_p99] = state.latency.percentile(0.99) * us;
+            out.values[stats_p999] = state.latency.percentile(0.999) * us;
+            out.values[stats_max] = static_cast<double>(state.latency.max()) * us;
+            out.values[stats_mean] = state.latency.mean() * us;
+            out.values[stats_batches] = static_cast<double>(state.batches);
+            out.values[stats_mean_batch] = state.batches ? static_cast<double>(state.batched_requests) / static_cast<double>(state.batches) : 0.0;
+        } else if (m.type == reset_stats) {
+            state.latency.reset();
+            state.batches = 0;
+            state.batched_requests = 0;
+        } else if (m.type == daemon_protocol::shutdown) {
+            shutdown_requested = true;
+        } else {
+            out.status = bad_message;
+        }
+    }
+    return shutdown_requested;
+}
+
+pricing_daemon::pricing_daemon(const std::string& address) : address(address), max_batch(1024), running(false) {}
+
+void pricing_daemon::set_max_batch(std::size_t max_batch) {
+    this->max_batch = std::max<std::size_t>(max_batch, 1);
+}
+
+void pricing_daemon::display_results() {
+    std::cout << "Pricing daemon listening on " << address << std::endl;
+    serve();
+}
+
+void pricing_daemon::stop() {
+    running = false;
+}
+
+void pricing_daemon::serve() {
+    std::signal(SIGPIPE, SIG_IGN); // a client hanging up must not kill the daemon
+    const int listener = daemon_protocol::listen_on(address);
+    running = true;
+
+    // Readers block on a full queue, which pushes back on clients instead of growing without bound
+    bounded_queue<queued_request> queue(16 * max_batch);
+    std::thread batcher([&] {
+        batcher_state state;
+        std::vector<queued_request> batch;
+        std::vector<daemon_protocol::reply> replies;
+        std::vector<daemon_connection*> touched;
+        while (queue.pop_batch(batch, max_batch)) {
+            const bool shutdown_requested = answer_batch(batch, replies, state);
+
+            // One hand-over per connection; replies keep their per-connection request order
+            for (std::size_t i = 0; i < batch.size(); ++i) {
+                daemon_connection* client = batch[i].client.get();
+                if (client->batch_replies.empty()) touched.push_back(client);
+                client->batch_replies.push_back(replies[i]);
+            }
+            for (daemon_connection* client : touched) {
+                {
+                    const std::lock_guard lock(client->mutex);
+                    client->outbox.insert(client->outbox.end(), client->batch_replies.begin(), client->batch_replies.end());
+                }
+                client->changed.notify_all();
+                client->batch_replies.clear();
+            }
+            touched.clear();
+
+            const auto written = clock_type::now();
+            std::size_t priced = 0;
+            for (const queued_request& item : batch) {
+                if (item.message.type != daemon_protocol::price) continue;
+                state.latency.record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(written - item.received).count()));
+                ++priced;
+            }
+            if (priced) {
+                ++state.batches;
+                state.batched_requests += priced;
+            }
+            batch.clear();
+            if (shutdown_requested) running = false;
+        }
+    });
+
+    // Accept loop; polls so that stop() and shutdown messages are noticed
+    struct reader_thread {
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> done;
+    };
+    std::vector<reader_thread> readers;
+    std::vector<std::weak_ptr<daemon_connection>> clients;
+    while (running) {
+        pollfd pending{listener, POLLIN, 0};
+        if (::poll(&pending, 1, 100) <= 0) continue;
+        const int fd = ::accept(listener, nullptr, nullptr);
+        if (fd < 0) continue;
+        const int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // no-op on Unix sockets
+
+        // Reap readers whose clients have gone
+        for (std::size_t k = 0; k < readers.size();) {
+            if (*readers[k].done) {
+                readers[k].thread.join();
+                readers[k] = std::move(readers.back());
+                readers.pop_back();
+            } else {
+                ++k;
+            }
+        }
+        std::erase_if(clients, [](const std::weak_ptr<daemon_connection>& c) { return c.expired(); });
+
+        auto client = std::make_shared<daemon_connection>(fd);
+        auto done = std::make_shared<std::atomic<bool>>(false);
+        clients.push_back(client);
+        readers.push_back({std::thread([this, &queue, client, done] {
+                               read_requests(client, queue, running);
+                               *done = true;
+                           }),
+                           done});
+    }
+
+    // Stop the readers (in a read, at the window or in a push) and let the batcher answer what is queued. Writers then
+    // get a moment to flush; a client that is still not reading after it is cut off, failing its writer's write.
+    for (const auto& weak : clients) {
+        if (auto client = weak.lock()) {
+            ::shutdown(client->fd, SHUT_RD);
+            const std::lock_guard lock(client->mutex);
+            client->changed.notify_all();
+        }
+    }
+    queue.close();
+    batcher.join();
+    const auto deadline = clock_type::now() + std::chrono::seconds(1);
+    while (clock_type::now() < deadline
+           && !std::all_of(readers.begin(), readers.end(), [](const reader_thread& reader) { return static_cast<bool>(*reader.done); })) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    for (const auto& weak : clients) {
+        if (auto client = weak.lock()) ::shutdown(client->fd, SHUT_RDWR);
+    }
+    for (reader_thread& reader : readers) reader.thread.join();
+    ::close(listener);
+    daemon_protocol::remove_socket(address);
+}
@@ -0,0 +1,44 @@
+// pricing_daemon.hpp
+//
+// Long-running pricing server on a Unix domain socket or loopback TCP (wire format in daemon_protocol.hpp).
+// Each connection has a reader thread that queues incoming requests and a writer thread that sends the replies; a
+// single batcher thread takes everything queued at once (up to max_batch), prices price-only European and American
+// requests through the batch kernels and the rest through the option classes, then hands each connection's replies
+// to its writer. The batcher never touches a socket, so a client that is slow to read cannot stall the others; its
+// reader stops at max_in_flight unanswered requests. Under load concurrent requests coalesce into large batches;
+// when idle a request is priced as soon as it arrives. On stop every queued request is answered, and a client that
+// has not read its replies a second later is disconnected.
+//
+// The batcher keeps its staging buffers and a cache of Asian Monte-Carlo results (deterministic for a fixed seed)
+// warm across requests, and records the latency of every request from frame received to reply handed to the writer;
+// a stats message returns p50/p99/p99.9. American requests are priced by Bjerksund-Stensland whatever they ask for,
+// and their Greeks are central differences of that price.
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#ifndef PRICING_DAEMON_HPP
+#define PRICING_DAEMON_HPP
+
+#include "interfaces.hpp"
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+class pricing_daemon : public interfaces {
+public:
+    explicit pricing_daemon(const std::string& address = "unix:/tmp/option_pricer.sock");
+    void display_results() override; // Serves until a shutdown message or stop()
+
+    // Largest number of requests priced together
+    void set_max_batch(std::size_t max_batch);
+    void serve();
+    void stop(); // safe from any thread
+
+private:
+    std::string address;
+    std::size_t max_batch;
+    std::atomic<bool> running;
+};
+
+#endif // PRICING_DAEMON_HPP
@@ -6,13 +6,22 @@
 // @version 2.0
 
 #include "pricing_methods.hpp"
+#include "simd_math.hpp"
+#include "normal_math.hpp"
+#include "parallel.hpp"
+#include "sobol.hpp"
+#include "brownian_bridge.hpp"
+#include "normal_pool.hpp"
+#include "instrumentation.hpp"
 #include <iostream>
 #include <cmath>
-#include <boost/math/distributions/normal.hpp>
 #include <random>
 #include <vector>
+#include <algorithm>
+#include <limits>
 
-using namespace boost::math;
+using normal_math::cdf; // in-house or boost backend, see normal_math.hpp
+using normal_math::pdf;
 
 void pricing_methods::parameter_check(double S, double K, double r, double T, double sig, double b) {
     // Check for NaN
@@ -57,36 +66,303 @@ double pricing_methods::d2 (double S, double K, double r, double T, double sig,
 
 // Black-Scholes Call Price
 double pricing_methods::price_european_call(double S, double K, double r, double T, double sig, double b) const {
+    INSTRUMENT_PROBE(european_price);
     double d1Value = d1(S, K, r, T, sig, b);
     double d2Value = d2(S, K, r, T, sig, b);
 
-    normal_distribution<> N(0, 1);
-    return (S * exp((b - r) * T) * cdf(N, d1Value)) - (K * exp(-r * T) * cdf(N, d2Value));
+    return (S * exp((b - r) * T) * cdf(d1Value)) - (K * exp(-r * T) * cdf(d2Value));
 }
 
 // Black-Scholes Put Price
 double pricing_methods::price_european_put(double S, double K, double r, double T, double sig, double b) const {
+    INSTRUMENT_PROBE(european_price);
     
     double d1Value = d1(S, K, r, T, sig, b);
     double d2Value = d2(S, K, r, T, sig, b);
-    normal_distribution<> N(0, 1);
     
-    return (K * exp(-r * T) * cdf(N, -d2Value)) - (S * exp((b - r) * T) * cdf(N, -d1Value));
+    return (K * exp(-r * T) * cdf(-d2Value)) - (S * exp((b - r) * T) * cdf(-d1Value));
+}
+
+// Batch Black-Scholes kernel, one lane per contract, specialised at compile time on the side and the carry regime
+// of the whole batch so the dead branches and carry terms drop out:
+//     call    S e^((b-r)T) N(d1) - K e^(-rT) N(d2)
+//     put     K e^(-rT) N(-d2) - S e^((b-r)T) N(-d1)
+//     mixed   w (S e^((b-r)T) N(w d1) - K e^(-rT) N(w d2)), w = +1 call / -1 put read per lane
+// with b = r (stock) the carry factor is 1 and b is not loaded; with b = 0 (futures, Black-76) the carry factor is
+// the discount factor, so one exponential serves both.
+enum class batch_side { call, put, mixed };
+enum class carry_regime { general, stock, future };
+
+template <class L, batch_side Side, carry_regime Carry>
+static inline void price_european_lanes(const double* S, const double* K, const double* r, const double* T,
+                                        const double* sig, const double* b, const int* type, double* out) {
+    using reg = typename L::reg;
+    const reg s = L::load(S), k = L::load(K), rr = L::load(r), t = L::load(T), v = L::load(sig);
+    const reg half_var = L::mul(L::mul(v, v), L::set1(0.5));
+    reg drift; // b + sig^2 / 2
+    if constexpr (Carry == carry_regime::stock) drift = L::add(rr, half_var);
+    else if constexpr (Carry == carry_regime::future) drift = half_var;
+    else drift = L::add(L::load(b), half_var);
+
+    const reg vol_sqrt_t = L::mul(v, L::sqrt(t));
+    const reg d1 = L::div(L::fmadd(drift, t, simd_math::log_v<L>(L::div(s, k))), vol_sqrt_t);
+    const reg d2 = L::sub(d1, vol_sqrt_t);
+    const reg discount_factor = simd_math::exp_v<L>(L::mul(L::sub(L::set1(0.0), rr), t));
+    reg carry; // S e^((b-r)T)
+    if constexpr (Carry == carry_regime::stock) carry = s;
+    else if constexpr (Carry == carry_regime::future) carry = L::mul(s, discount_factor);
+    else carry = L::mul(s, simd_math::exp_v<L>(L::mul(L::sub(L::load(b), rr), t)));
+    const reg discount = L::mul(k, discount_factor);
+
+    reg value;
+    if constexpr (Side == batch_side::call) {
+        value = L::sub(L::mul(carry, simd_math::ncdf_v<L>(d1)), L::mul(discount, simd_math::ncdf_v<L>(d2)));
+    } else if constexpr (Side == batch_side::put) {
+        // The mixed expression with w = -1 rather than the put formula above, so a put prices to the same bits
+        // whichever kernel its batch takes
+        const reg zero = L::set1(0.0), w = L::set1(-1.0);
+        const reg n1 = simd_math::ncdf_v<L>(L::sub(zero, d1));
+        const reg n2 = simd_math::ncdf_v<L>(L::sub(zero, d2));
+        value = L::mul(w, L::sub(L::mul(carry, n1), L::mul(discount, n2)));
+    } else {
+        const reg w = L::select(L::eq(L::load_int(type), L::set1(option::CALL)), L::set1(1.0), L::set1(-1.0));
+        const reg n1 = simd_math::ncdf_v<L>(L::mul(w, d1));
+        const reg n2 = simd_math::ncdf_v<L>(L::mul(w, d2));
+        value = L::mul(w, L::sub(L::mul(carry, n1), L::mul(discount, n2)));
+    }
+    // A worthless option comes out as +0 or -0 depending on whether the lane fused the final multiply-subtract;
+    // adding +0 makes it +0 in every lane
+    L::store(out, L::add(value, L::set1(0.0)));
+}
+
+template <batch_side Side, carry_regime Carry>
+static void price_european_run(std::span<const double> S, std::span<const double> K, std::span<const double> r, std::span<const double> T,
+                               std::span<const double> sig, std::span<const double> b, std::span<const int> option_type, std::span<double> prices) {
+    using lane = simd_math::native_lane;
+    const std::size_t n = prices.size();
+    std::size_t i = 0;
+    for (; i + lane::width <= n; i += lane::width) {
+        price_european_lanes<lane, Side, Carry>(&S[i], &K[i], &r[i], &T[i], &sig[i], &b[i], &option_type[i], &prices[i]);
+    }
+    for (; i < n; ++i) { // Remainder with the same polynomials so results don't depend on position in the batch
+        price_european_lanes<simd_math::scalar_lane, Side, Carry>(&S[i], &K[i], &r[i], &T[i], &sig[i], &b[i], &option_type[i], &prices[i]);
+    }
+}
+
+template <batch_side Side>
+static void price_european_run(carry_regime carry, std::span<const double> S, std::span<const double> K, std::span<const double> r,
+                               std::span<const double> T, std::span<const double> sig, std::span<const double> b,
+                               std::span<const int> option_type, std::span<double> prices) {
+    switch (carry) {
+    case carry_regime::stock:
+        return price_european_run<Side, carry_regime::stock>(S, K, r, T, sig, b, option_type, prices);
+    case carry_regime::future:
+        return price_european_run<Side, carry_regime::future>(S, K, r, T, sig, b, option_type, prices);
+    default:
+        return price_european_run<Side, carry_regime::general>(S, K, r, T, sig, b, option_type, prices);
+    }
+}
+
+void pricing_methods::price_european_batch(std::span<const double> S, std::span<const double> K, std::span<const double> r,
+                                           std::span<const double> T, std::span<const double> sig, std::span<const double> b,
+                                           std::span<const int> option_type, std::span<double> prices) const {
+    INSTRUMENT_PROBE_ITEMS(european_batch, S.size());
+    const std::size_t n = prices.size();
+    if (S.size() != n || K.size() != n || r.size() != n || T.size() != n || sig.size() != n || b.size() != n || option_type.size() != n) {
+        throw std::invalid_argument("Error: batch input spans must all have the same length");
+    }
+    // One pass to validate and classify the batch: are all contracts on one side, and is the carry b = r or b = 0
+    // throughout? The specialisation is chosen once here, not per contract.
+    // Branch-free so the pass vectorises; it costs well under a nanosecond per contract.
+    const int call = option::CALL, put = option::PUT;
+    std::size_t calls = 0, puts = 0, stock = 0, future = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        calls += option_type[i] == call;
+        puts += option_type[i] == put;
+        stock += b[i] == r[i];
+        future += b[i] == 0.0;
+    }
+    if (calls + puts != n) throw std::domain_error("Select 1 for call or 2 for put");
+    const bool all_calls = calls == n, all_puts = puts == n, all_stock = stock == n, all_future = future == n;
+    const carry_regime carry = all_stock ? carry_regime::stock : all_future ? carry_regime::future : carry_regime::general;
+    if (all_calls) price_european_run<batch_side::call>(carry, S, K, r, T, sig, b, option_type, prices);
+    else if (all_puts) price_european_run<batch_side::put>(carry, S, K, r, T, sig, b, option_type, prices);
+    else price_european_run<batch_side::mixed>(carry, S, K, r, T, sig, b, option_type, prices);
+}
+
+// Implied volatility
+// After the normalisation in implied_volatility_batch every quote is an out-of-the-money call on the normalised Black
+// price: with x = ln(F/K) <= 0 and s = sig sqrt(T),
+//     B(s) = e^(x/2) N(x/s + s/2) - e^(-x/2) N(x/s - s/2),  B'(s) = e^(x/2) n(x/s + s/2) (the vega),
+//     B''/B' = x^2/s^3 - s/4,  B'''/B' = (B''/B')^2 - 3x^2/s^4 - 1/4,
+// and the target beta lies in (0, e^(x/2)). Below the inflection point s_c = sqrt(2|x|) the solve runs on ln B, which
+// is close to linear in 1/s^2 there; above it on B itself.
+static constexpr int iv_max_iterations = 32;
+static constexpr double iv_tolerance = 1e-13; // relative change in s that counts as converged
+
+template <class L>
+static inline void implied_vol_lanes(const double* x_in, const double* beta_in, double* active_io, double* s_out) {
+    using reg = typename L::reg;
+    const reg zero = L::set1(0.0), one = L::set1(1.0), half = L::set1(0.5);
+    const reg infinity = L::set1(std::numeric_limits<double>::infinity());
+    const reg x = L::load(x_in), beta = L::load(beta_in);
+    const reg abs_x = L::abs(x);
+    const reg e_plus = simd_math::exp_v<L>(L::mul(x, half)); // e^(x/2), also the upper bound on beta
+    const reg e_minus = simd_math::exp_v<L>(L::mul(abs_x, half));
+    const reg x2 = L::mul(x, x);
+    const reg log_beta = simd_math::log_v<L>(beta);
+
+    // Region and initial guess: small-vol asymptote ln B ~ -x^2 / (2 s^2) below the inflection point,
+    // large-vol asymptote e^(x/2) - B ~ (e^(x/2) + e^(-x/2)) N(-s/2) above it
+    const reg s_c = L::sqrt(L::add(abs_x, abs_x));
+    const reg b_c = L::sub(L::mul(e_plus, half), L::mul(e_minus, simd_math::ncdf_v<L>(L::sub(zero, s_c))));
+    const reg lower = L::select(L::lt(beta, b_c), one, zero);
+    const reg guess_low = L::div(abs_x, L::sqrt(L::mul(L::set1(-2.0), log_beta)));
+    const reg guess_high = L::mul(L::set1(-2.0), simd_math::ninv_v<L>(L::div(L::sub(e_plus, beta), L::add(e_plus, e_minus))));
+    reg s = L::select(L::gt(lower, half), guess_low, guess_high);
+
+    reg active = L::load(active_io);
+    reg s_lo = zero, s_hi = infinity;
+    for (int iteration = 0; iteration < iv_max_iterations; ++iteration) {
+        const reg inv_s = L::div(one, s);
+        const reg h = L::mul(x, inv_s);
+        const reg d1 = L::fmadd(s, half, h);
+        const reg d2 = L::sub(h, L::mul(s, half));
+        const reg value = L::sub(L::mul(e_plus, simd_math::ncdf_v<L>(d1)), L::mul(e_minus, simd_math::ncdf_v<L>(d2)));
+        const reg vega = L::mul(e_plus, simd_math::npdf_v<L>(d1));
+        const reg x2_s2 = L::mul(x2, L::mul(inv_s, inv_s));
+        const reg r2 = L::sub(L::mul(x2_s2, inv_s), L::mul(s, L::set1(0.25)));
+        const reg r3 = L::sub(L::mul(r2, r2), L::fmadd(L::set1(3.0), L::mul(x2_s2, L::mul(inv_s, inv_s)), L::set1(0.25)));
+
+        // B is increasing in s, so every iterate tightens the bracket
+        const auto above = L::gt(value, beta);
+        s_hi = L::select(above, L::min(s_hi, s), s_hi);
+        s_lo = L::select(above, s_lo, L::max(s_lo, s));
+
+        // Newton ratio and the Householder ratios h2 = f''/f', h3 = f'''/f' of the objective in use
+        const reg q = L::div(vega, value);
+        const reg nu_value = L::div(L::sub(beta, value), vega);
+        const reg nu_log = L::div(L::sub(log_beta, simd_math::log_v<L>(value)), q);
+        const auto use_log = L::gt(lower, half);
+        const reg nu = L::select(use_log, nu_log, nu_value);
+        const reg h2 = L::select(use_log, L::sub(r2, q), r2);
+        const reg h3 = L::select(use_log, L::fmadd(L::mul(q, q), L::set1(2.0), L::sub(r3, L::mul(L::mul(r2, q), L::set1(3.0)))), r3);
+        const reg step = L::div(L::mul(nu, L::fmadd(L::mul(h2, nu), half, one)),
+                                L::fmadd(nu, L::fmadd(L::mul(h3, nu), L::set1(1.0 / 6.0), h2), one));
+
+        // Fall back to bisection (doubling while there is no upper bound) when the step leaves the bracket
+        reg next = L::add(s, step);
+        // (closed bracket: an iterate that lands on the root takes a zero step and is kept)
+        const reg inside = L::select(L::eq(next, next), L::select(L::lt(next, s_lo), zero, L::select(L::gt(next, s_hi), zero, one)), zero);
+        const reg bisect = L::select(L::lt(s_hi, infinity), L::mul(L::add(s_lo, s_hi), half), L::add(s, s));
+        next = L::select(L::gt(inside, half), next, bisect);
+
+        const auto converged = L::lt(L::abs(L::sub(next, s)), L::mul(next, L::set1(iv_tolerance)));
+        s = L::select(L::gt(active, half), next, s);
+        active = L::select(converged, zero, active);
+        if (!L::any(L::gt(active, half))) break;
+    }
+    L::store(s_out, s);
+    L::store(active_io, active);
+}
+
+void pricing_methods::implied_volatility_batch(std::span<const double> price, std::span<const double> S, std::span<const double> K,
+                                               std::span<const double> r, std::span<const double> T, std::span<const double> b,
+                                               std::span<const int> option_type, std::span<double> vol, std::span<iv_status> status) const {
+    INSTRUMENT_PROBE_ITEMS(implied_vol_batch, price.size());
+    const std::size_t n = vol.size();
+    if (price.size() != n || S.size() != n || K.size() != n || r.size() != n || T.size() != n || b.size() != n
+        || option_type.size() != n || status.size() != n) {
+        throw std::invalid_argument("Error: batch input spans must all have the same length");
+    }
+
+    // Every chunk goes through the same lane kernel (short chunks are padded with idle lanes), so a quote's vol does
+    // not depend on its position in the batch
+    using lane = simd_math::native_lane;
+    constexpr std::size_t W = lane::width;
+    for (std::size_t first = 0; first < n; first += W) {
+        const std::size_t count = std::min(W, n - first);
+        double x[W], beta[W], active[W], s[W];
+        for (std::size_t j = 0; j < W; ++j) {
+            x[j] = -1.0;
+            beta[j] = 0.1;
+            active[j] = 0.0;
+        }
+
+        // Normalise: time value over D sqrt(F K), reduced to the out-of-the-money call at x = -|ln(F/K)|
+        for (std::size_t j = 0; j < count; ++j) {
+            const std::size_t i = first + j;
+            vol[i] = std::numeric_limits<double>::quiet_NaN();
+            const int type = option_type[i];
+            if ((type != option::CALL && type != option::PUT) || !(S[i] > 0) || !(K[i] > 0) || !(T[i] > 0) || !std::isfinite(S[i])
+                || !std::isfinite(K[i]) || !std::isfinite(T[i]) || !std::isfinite(r[i]) || !std::isfinite(b[i]) || !std::isfinite(price[i])) {
+                status[i] = iv_status::invalid_input;
+                continue;
+            }
+            const double forward = S[i] * exp(b[i] * T[i]);
+            const double moneyness = -std::fabs(log(forward / K[i]));
+            const double intrinsic = std::max(type == option::CALL ? forward - K[i] : K[i] - forward, 0.0);
+            const double normalised = (price[i] * exp(r[i] * T[i]) - intrinsic) / sqrt(forward * K[i]);
+            if (!(normalised > 0)) {
+                status[i] = iv_status::below_intrinsic;
+                vol[i] = 0.0;
+            } else if (!(normalised < exp(0.5 * moneyness))) {
+                status[i] = iv_status::above_maximum;
+            } else {
+                status[i] = iv_status::converged;
+                x[j] = moneyness;
+                beta[j] = normalised;
+                active[j] = 1.0;
+            }
+        }
+
+        implied_vol_lanes<lane>(x, beta, active, s);
+
+        for (std::size_t j = 0; j < count; ++j) {
+            const std::size_t i = first + j;
+            if (status[i] != iv_status::converged) continue;
+            vol[i] = s[j] / sqrt(T[i]);
+            if (active[j] != 0.0) status[i] = iv_status::max_iterations;
+        }
+    }
+}
+
+double pricing_methods::implied_volatility(double price, double S, double K, double r, double T, double b, int option_type) const {
+    INSTRUMENT_PROBE(implied_vol);
+    double vol = 0.0;
+    iv_status status = iv_status::invalid_input;
+    implied_volatility_batch({&price, 1}, {&S, 1}, {&K, 1}, {&r, 1}, {&T, 1}, {&b, 1}, {&option_type, 1}, {&vol, 1}, {&status, 1});
+    switch (status) {
+    case iv_status::converged:
+        return vol;
+    case iv_status::below_intrinsic:
+        throw std::invalid_argument("Error: option price is at or below intrinsic value, no implied volatility");
+    case iv_status::above_maximum:
+        throw std::invalid_argument("Error: option price is above the no-arbitrage upper bound, no implied volatility");
+    case iv_status::max_iterations:
+        throw std::invalid_argument("Error: implied volatility did not converge");
+    default:
+        if (option_type != option::CALL && option_type != option::PUT) throw std::domain_error("Select 1 for call or 2 for put");
+        throw std::invalid_argument("Error: implied volatility needs positive, finite S, K, T and finite price, r, b");
+    }
 }
 
 // Put-Call Parity pricing methods (for european_option only):
 // Given a put, return a call
 double pricing_methods::PCP_put_to_call(double S, double K, double r, double T, double p) const {
+    INSTRUMENT_PROBE(put_call_parity);
 	return p + S - K * exp(-r * T); // Uses put (p) in calculation
 }
 
 // Given a call, return a put
 double pricing_methods::PCP_call_to_put(double S, double K, double r, double T, double c) const { 
+    INSTRUMENT_PROBE(put_call_parity);
 	return c + K * exp(-r * T) - S; // Uses call (c) in calculation
 }
 
 // Function to check if pcp holds
 bool pricing_methods::PCP_check(double S, double K, double r, double T, double c, double p) const {
+    INSTRUMENT_PROBE(put_call_parity);
     double LHS = c + K * exp(-r * T); // Left hand side of Put-Call parity equation
     double RHS = p + S; // Right hand side of Put-Call parity equation
     const double Tolerance = 0.01; // Tolerance for rounding errors and other slight impercisions
@@ -106,61 +382,166 @@ bool pricing_methods::PCP_check(double S, double K, double r, double T, double c
 // Greeks - only for european_option
 // Delta for a Call option
 double pricing_methods::delta_call(double S, double K, double r, double T, double sig, double b) const {
-    normal_distribution<> N(0, 1);
+    INSTRUMENT_PROBE(european_delta);
     double d1Value = d1(S, K, r, T, sig, b);
-    return exp((b - r) * T) * cdf(N, d1Value);
+    return exp((b - r) * T) * cdf(d1Value);
 }
 
 // Delta for a Put option
 double pricing_methods::delta_put(double S, double K, double r, double T, double sig, double b) const {
-    normal_distribution<> N(0, 1);
+    INSTRUMENT_PROBE(european_delta);
     double d1Value = d1(S, K, r, T, sig, b);
-    return exp((b - r) * T) * (cdf(N, d1Value) - 1); // Key difference
+    return exp((b - r) * T) * (cdf(d1Value) - 1); // Key difference
 }
 
 // Gamma for both Call and Put options (Gamma is the same for both)
 double pricing_methods::gamma(double S, double K, double r, double T, double sig, double b) const {
-    normal_distribution<> N(0, 1);
+    INSTRUMENT_PROBE(european_gamma);
     double d1Value = d1(S, K, r, T, sig, b);
-    return pdf(N, d1Value) * exp((b - r) * T) / (S * sig * sqrt(T));
+    return pdf(d1Value) * exp((b - r) * T) / (S * sig * sqrt(T));
 }
 
 // Vega for both
 double pricing_methods::vega(double S, double K, double r, double T, double sig, double b) const {
-    return S * sqrt(T) * pdf(normal_distribution<>(0, 1), d1(S, K, r, T, sig, b));
+    INSTRUMENT_PROBE(european_vega);
+    return S * exp((b - r) * T) * sqrt(T) * pdf(d1(S, K, r, T, sig, b));
 }
 
-// Theta for Call
+// Theta for Call (calendar decay -dV/dT, Haug's generalised form)
 double pricing_methods::theta_call(double S, double K, double r, double T, double sig, double b) const {
+    INSTRUMENT_PROBE(european_theta);
     double d1Value = d1(S, K, r, T, sig, b);
     double d2Value = d2(S, K, r, T, sig, b);
-    double first_term = -S * pdf(normal_distribution<>(0, 1), d1Value) * sig / (2 * sqrt(T));
-    double second_term = b * S * cdf(normal_distribution<>(0, 1), d1Value);
-    double third_term = r * K * exp(-r * T) * cdf(normal_distribution<>(0, 1), d2Value);
+    double carry = exp((b - r) * T);
+    double first_term = -S * carry * pdf(d1Value) * sig / (2 * sqrt(T));
+    double second_term = (b - r) * S * carry * cdf(d1Value);
+    double third_term = r * K * exp(-r * T) * cdf(d2Value);
     return first_term - second_term - third_term;
 }
 
 // Theta for Put
 double pricing_methods::theta_put(double S, double K, double r, double T, double sig, double b) const {
+    INSTRUMENT_PROBE(european_theta);
     double d1Value = d1(S, K, r, T, sig, b);
     double d2Value = d2(S, K, r, T, sig, b);
-    double first_term = -S * pdf(normal_distribution<>(0, 1), d1Value) * sig / (2 * sqrt(T));
-    double second_term = b * S * cdf(normal_distribution<>(0, 1), -d1Value);
-    double third_term = r * K * exp(-r * T) * cdf(normal_distribution<>(0, 1), -d2Value);
+    double carry = exp((b - r) * T);
+    double first_term = -S * carry * pdf(d1Value) * sig / (2 * sqrt(T));
+    double second_term = (b - r) * S * carry * cdf(-d1Value);
+    double third_term = r * K * exp(-r * T) * cdf(-d2Value);
     return first_term + second_term + third_term;
 }
 
-// Rho for call
+// Rho for call (Haug's generalised rho): b = r - q moves with r at a fixed yield q, except for futures (b = 0), where
+// only the discount moves and rho = -T * price
 double pricing_methods::rho_call(double S, double K, double r, double T, double sig, double b) const {
-    return K * T * exp(-r * T) * cdf(normal_distribution<>(0, 1), d2(S, K, r, T, sig, b));
+    INSTRUMENT_PROBE(european_rho);
+    if (b == 0.0) return -T * price_european_call(S, K, r, T, sig, b);
+    return K * T * exp(-r * T) * cdf(d2(S, K, r, T, sig, b));
 }
 
-// Rho for put
+// Rho for put (same convention)
 double pricing_methods::rho_put(double S, double K, double r, double T, double sig, double b) const {
-    return -K * T * exp(-r * T) * cdf(normal_distribution<>(0, 1), -d2(S, K, r, T, sig, b));
+    INSTRUMENT_PROBE(european_rho);
+    if (b == 0.0) return -T * price_european_put(S, K, r, T, sig, b);
+    return -K * T * exp(-r * T) * cdf(-d2(S, K, r, T, sig, b));
 }
 
 
+// Fused price + Greeks: same formulas as the individual functions above, shared subexpressions evaluated once
+european_greeks pricing_methods::price_and_greeks_european(double S, double K, double r, double T, double sig, double b, int option_type) const {
+    INSTRUMENT_PROBE(european_greeks);
+    const double sqrt_T = sqrt(T);
+    const double vol_sqrt_T = sig * sqrt_T;
+    const double d1Value = (log(S / K) + (b + (sig * sig) * 0.5) * T) / vol_sqrt_T;
+    const double d2Value = d1Value - vol_sqrt_T;
+    const double carry = exp((b - r) * T);
+    const double discount = exp(-r * T);
+    const double n_d1 = pdf(d1Value);
+
+    european_greeks g;
+    g.gamma = n_d1 * carry / (S * vol_sqrt_T);
+    g.vega = S * carry * sqrt_T * n_d1;
+    const double theta_decay = -S * carry * n_d1 * sig / (2 * sqrt_T);
+
+    if (option_type == option::CALL) {
+        const double N_d1 = cdf(d1Value);
+        const double N_d2 = cdf(d2Value);
+        g.price = S * carry * N_d1 - K * discount * N_d2;
+        g.delta = carry * N_d1;
+        g.theta = theta_decay - (b - r) * S * carry * N_d1 - r * K * discount * N_d2;
+        g.rho = K * T * discount * N_d2;
+        g.pcp_price = g.price + K * discount - S;
+    } else if (option_type == option::PUT) {
+        const double N_md1 = cdf(-d1Value);
+        const double N_md2 = cdf(-d2Value);
+        g.price = K * discount * N_md2 - S * carry * N_md1;
+        g.delta = -carry * N_md1;
+        g.theta = theta_decay + (b - r) * S * carry * N_md1 + r * K * discount * N_md2;
+        g.rho = -K * T * discount * N_md2;
+        g.pcp_price = g.price + S - K * discount;
+    } else {
+        throw std::domain_error("Select 1 for call or 2 for put");
+    }
+    if (b == 0.0) g.rho = -T * g.price; // futures: only the discount moves with r
+    return g;
+}
+
+
+
+// Batch price and Greeks: the formulas of price_and_greeks_european with the call/put branch folded into the sign
+// w = +1 / -1, so both sides share one lane
+template <class L>
+static inline void price_and_greeks_lanes(const double* S, const double* K, const double* r, const double* T, const double* sig,
+                                          const double* b, const int* type, const european_greeks_columns& out, std::size_t i) {
+    using reg = typename L::reg;
+    const reg s = L::load(S), k = L::load(K), rr = L::load(r), t = L::load(T), v = L::load(sig), bb = L::load(b);
+    const reg w = L::select(L::eq(L::load_int(type), L::set1(option::CALL)), L::set1(1.0), L::set1(-1.0));
+    const reg sqrt_t = L::sqrt(t);
+    const reg vol_sqrt_t = L::mul(v, sqrt_t);
+    const reg d1 = L::div(L::fmadd(L::fmadd(L::mul(v, v), L::set1(0.5), bb), t, simd_math::log_v<L>(L::div(s, k))), vol_sqrt_t);
+    const reg d2 = L::sub(d1, vol_sqrt_t);
+    const reg carry = simd_math::exp_v<L>(L::mul(L::sub(bb, rr), t));
+    const reg k_discount = L::mul(k, simd_math::exp_v<L>(L::mul(L::sub(L::set1(0.0), rr), t)));
+    const reg n_d1 = simd_math::npdf_v<L>(d1);
+    const reg N1 = simd_math::ncdf_v<L>(L::mul(w, d1)); // N(w d1)
+    const reg N2 = simd_math::ncdf_v<L>(L::mul(w, d2)); // N(w d2)
+
+    const reg s_carry_N1 = L::mul(L::mul(s, carry), N1), k_discount_N2 = L::mul(k_discount, N2);
+    const reg price = L::mul(w, L::sub(s_carry_N1, k_discount_N2));
+    L::store(&out.price[i], price);
+    L::store(&out.delta[i], L::mul(w, L::mul(carry, N1)));
+    L::store(&out.gamma[i], L::div(L::mul(n_d1, carry), L::mul(s, vol_sqrt_t)));
+    L::store(&out.vega[i], L::mul(L::mul(L::mul(s, carry), sqrt_t), n_d1));
+    const reg theta_decay = L::div(L::mul(L::mul(L::mul(s, carry), n_d1), v), L::mul(L::set1(-2.0), sqrt_t));
+    const reg theta_carry = L::fmadd(L::sub(bb, rr), s_carry_N1, L::mul(rr, k_discount_N2));
+    L::store(&out.theta[i], L::sub(theta_decay, L::mul(w, theta_carry)));
+    const reg rho_carry = L::mul(w, L::mul(t, k_discount_N2)), rho_future = L::mul(L::sub(L::set1(0.0), t), price);
+    L::store(&out.rho[i], L::select(L::eq(bb, L::set1(0.0)), rho_future, rho_carry));
+    L::store(&out.pcp_price[i], L::fmadd(w, L::sub(k_discount, s), price));
+}
+
+void pricing_methods::price_and_greeks_european_batch(std::span<const double> S, std::span<const double> K, std::span<const double> r,
+                                                      std::span<const double> T, std::span<const double> sig, std::span<const double> b,
+                                                      std::span<const int> option_type, const european_greeks_columns& out) const {
+    INSTRUMENT_PROBE_ITEMS(european_greeks_batch, S.size());
+    const std::size_t n = S.size();
+    if (K.size() != n || r.size() != n || T.size() != n || sig.size() != n || b.size() != n || option_type.size() != n) {
+        throw std::invalid_argument("Error: batch input spans must all have the same length");
+    }
+    for (const auto& column : {out.price, out.delta, out.gamma, out.vega, out.theta, out.rho, out.pcp_price}) {
+        if (column.size() != n) throw std::invalid_argument("Error: batch input spans must all have the same length");
+    }
+    for (int type : option_type) {
+        if (type != option::CALL && type != option::PUT) throw std::domain_error("Select 1 for call or 2 for put");
+    }
+
+    using lane = simd_math::native_lane;
+    std::size_t i = 0;
+    for (; i + lane::width <= n; i += lane::width) {
+        price_and_greeks_lanes<lane>(&S[i], &K[i], &r[i], &T[i], &sig[i], &b[i], &option_type[i], out, i);
+    }
+    for (; i < n; ++i) price_and_greeks_lanes<simd_math::scalar_lane>(&S[i], &K[i], &r[i], &T[i], &sig[i], &b[i], &option_type[i], out, i);
+}
 
 // American option pricers:
 // Y1 variable (for call)
@@ -175,12 +556,14 @@ double pricing_methods::y2(double K, double r, double sig, double b) const {
 
 // American Call Price
 double pricing_methods::price_american_call(double S, double K, double r, double sig, double b) const {
+    INSTRUMENT_PROBE(american_perpetual);
     double y1Value = y1(K, r, sig, b);
     return ( (K / (y1Value - 1.0)) * pow(((y1Value - 1.0) / y1Value) * (S / K), y1Value) );
 }
 
 // American Put Price
 double pricing_methods::price_american_put(double S, double K, double r, double sig, double b) const {
+    INSTRUMENT_PROBE(american_perpetual);
     double y2Value = y2(K, r, sig, b);
     return ( (K / (1.0-y2Value)) * pow(((y2Value - 1.0) / y2Value) * (S / K), y2Value) );
     
@@ -189,9 +572,276 @@ double pricing_methods::price_american_put(double S, double K, double r, double
 
 
 
+// Barone-Adesi-Whaley critical price S* for a call: Newton iteration on S* - K = c(S*) + (1 - e^((b-r)T) N(d1(S*))) S*/q2
+static double baw_critical_call(const pricing_methods& pm, double K, double r, double T, double sig, double b) {
+    const double n = 2 * b / (sig * sig);
+    const double m = 2 * r / (sig * sig);
+    const double q2u = (-(n - 1) + sqrt((n - 1) * (n - 1) + 4 * m)) / 2;
+    const double su = K / (1 - 1 / q2u);
+    const double h2 = -(b * T + 2 * sig * sqrt(T)) * K / (su - K);
+    double Si = K + (su - K) * (1 - exp(h2)); // seed from the perpetual boundary
+    const double k = 1 - exp(-r * T);
+    const double q2 = (-(n - 1) + sqrt((n - 1) * (n - 1) + 4 * m / k)) / 2;
+    const double carry = exp((b - r) * T);
+    const double vol_sqrt_T = sig * sqrt(T);
+
+    for (int iteration = 0; iteration < 100; ++iteration) {
+        const double d1Value = (log(Si / K) + (b + sig * sig / 2) * T) / vol_sqrt_T;
+        const double lhs = Si - K;
+        const double rhs = pm.price_european_call(Si, K, r, T, sig, b) + (1 - carry * cdf(d1Value)) * Si / q2;
+        if (std::abs(lhs - rhs) / K < 1e-9) break;
+        const double slope = carry * cdf(d1Value) * (1 - 1 / q2) + (1 - carry * pdf(d1Value) / vol_sqrt_T) / q2;
+        Si = (K + rhs - slope * Si) / (1 - slope);
+    }
+    return Si;
+}
+
+// Barone-Adesi-Whaley critical price S** for a put
+static double baw_critical_put(const pricing_methods& pm, double K, double r, double T, double sig, double b) {
+    const double n = 2 * b / (sig * sig);
+    const double m = 2 * r / (sig * sig);
+    const double q1u = (-(n - 1) - sqrt((n - 1) * (n - 1) + 4 * m)) / 2;
+    const double su = K / (1 - 1 / q1u);
+    const double h1 = (b * T - 2 * sig * sqrt(T)) * K / (K - su);
+    double Si = su + (K - su) * exp(h1);
+    const double k = 1 - exp(-r * T);
+    const double q1 = (-(n - 1) - sqrt((n - 1) * (n - 1) + 4 * m / k)) / 2;
+    const double carry = exp((b - r) * T);
+    const double vol_sqrt_T = sig * sqrt(T);
+
+    for (int iteration = 0; iteration < 100; ++iteration) {
+        const double d1Value = (log(Si / K) + (b + sig * sig / 2) * T) / vol_sqrt_T;
+        const double lhs = K - Si;
+        const double rhs = pm.price_european_put(Si, K, r, T, sig, b) - (1 - carry * cdf(-d1Value)) * Si / q1;
+        if (std::abs(lhs - rhs) / K < 1e-9) break;
+        const double slope = -carry * cdf(-d1Value) * (1 - 1 / q1) - (1 + carry * pdf(-d1Value) / vol_sqrt_T) / q1;
+        Si = (K - rhs + slope * Si) / (1 + slope);
+    }
+    return Si;
+}
+
+// Barone-Adesi-Whaley American call
+double pricing_methods::price_american_baw_call(double S, double K, double r, double T, double sig, double b) const {
+    INSTRUMENT_PROBE(american_baw);
+    if (b >= r) return price_european_call(S, K, r, T, sig, b); // never optimal to exercise early
+    const double Sk = baw_critical_call(*this, K, r, T, sig, b);
+    if (S >= Sk) return S - K;
+    const double n = 2 * b / (sig * sig);
+    const double m = 2 * r / (sig * sig);
+    const double q2 = (-(n - 1) + sqrt((n - 1) * (n - 1) + 4 * m / (1 - exp(-r * T)))) / 2;
+    const double d1Value = (log(Sk / K) + (b + sig * sig / 2) * T) / (sig * sqrt(T));
+    const double a2 = (Sk / q2) * (1 - exp((b - r) * T) * cdf(d1Value));
+    return price_european_call(S, K, r, T, sig, b) + a2 * pow(S / Sk, q2);
+}
+
+// Barone-Adesi-Whaley American put
+double pricing_methods::price_american_baw_put(double S, double K, double r, double T, double sig, double b) const {
+    INSTRUMENT_PROBE(american_baw);
+    if (r <= 0) return price_european_put(S, K, r, T, sig, b); // no interest to earn on the strike
+    const double Sk = baw_critical_put(*this, K, r, T, sig, b);
+    if (S <= Sk) return K - S;
+    const double n = 2 * b / (sig * sig);
+    const double m = 2 * r / (sig * sig);
+    const double q1 = (-(n - 1) - sqrt((n - 1) * (n - 1) + 4 * m / (1 - exp(-r * T)))) / 2;
+    const double d1Value = (log(Sk / K) + (b + sig * sig / 2) * T) / (sig * sqrt(T));
+    const double a1 = -(Sk / q1) * (1 - exp((b - r) * T) * cdf(-d1Value));
+    return price_european_put(S, K, r, T, sig, b) + a1 * pow(S / Sk, q1);
+}
+
+// Bjerksund-Stensland phi function
+static double bjs_phi(double S, double T, double gamma, double H, double I, double r, double b, double sig) {
+    const double lambda = -r + gamma * b + 0.5 * gamma * (gamma - 1) * sig * sig;
+    const double kappa = 2 * b / (sig * sig) + 2 * gamma - 1;
+    const double vol_sqrt_T = sig * sqrt(T);
+    const double d = -(log(S / H) + (b + (gamma - 0.5) * sig * sig) * T) / vol_sqrt_T;
+    return exp(lambda * T) * pow(S, gamma) * (cdf(d) - pow(I / S, kappa) * cdf(d - 2 * log(I / S) / vol_sqrt_T));
+}
+
+// Bjerksund-Stensland 2002 ksi function (two exercise dates t1 < T2)
+static double bjs_ksi(double S, double T2, double gamma, double H, double I2, double I1, double t1, double r, double b, double sig) {
+    const double drift = b + (gamma - 0.5) * sig * sig;
+    const double vol_t1 = sig * sqrt(t1);
+    const double vol_T2 = sig * sqrt(T2);
+    const double e1 = (log(S / I1) + drift * t1) / vol_t1;
+    const double e2 = (log(I2 * I2 / (S * I1)) + drift * t1) / vol_t1;
+    const double e3 = (log(S / I1) - drift * t1) / vol_t1;
+    const double e4 = (log(I2 * I2 / (S * I1)) - drift * t1) / vol_t1;
+    const double f1 = (log(S / H) + drift * T2) / vol_T2;
+    const double f2 = (log(I2 * I2 / (S * H)) + drift * T2) / vol_T2;
+    const double f3 = (log(I1 * I1 / (S * H)) + drift * T2) / vol_T2;
+    const double f4 = (log(S * I1 * I1 / (H * I2 * I2)) + drift * T2) / vol_T2;
+    const double rho = sqrt(t1 / T2);
+    const double lambda = -r + gamma * b + 0.5 * gamma * (gamma - 1) * sig * sig;
+    const double kappa = 2 * b / (sig * sig) + 2 * gamma - 1;
+    using normal_math::bivariate_cdf;
+    return exp(lambda * T2) * pow(S, gamma) *
+           (bivariate_cdf(-e1, -f1, rho) - pow(I2 / S, kappa) * bivariate_cdf(-e2, -f2, rho)
+            - pow(I1 / S, kappa) * bivariate_cdf(-e3, -f3, -rho) + pow(I1 / I2, kappa) * bivariate_cdf(-e4, -f4, -rho));
+}
+
+// Bjerksund-Stensland 2002 American call
+double pricing_methods::price_american_bjs_call(double S, double K, double r, double T, double sig, double b) const {
+    INSTRUMENT_PROBE(american_bjs);
+    if (b >= r) return price_european_call(S, K, r, T, sig, b); // never optimal to exercise early
+    const double t1 = 0.5 * (sqrt(5.0) - 1) * T;
+    const double beta = (0.5 - b / (sig * sig)) + sqrt(pow(b / (sig * sig) - 0.5, 2) + 2 * r / (sig * sig));
+    const double B_inf = beta / (beta - 1) * K;
+    const double B0 = std::max(K, r / (r - b) * K);
+    const double ht1 = -(b * t1 + 2 * sig * sqrt(t1)) * K * K / ((B_inf - B0) * B0);
+    const double ht2 = -(b * T + 2 * sig * sqrt(T)) * K * K / ((B_inf - B0) * B0);
+    const double I1 = B0 + (B_inf - B0) * (1 - exp(ht1));
+    const double I2 = B0 + (B_inf - B0) * (1 - exp(ht2));
+    if (S >= I2) return S - K;
+    const double alpha1 = (I1 - K) * pow(I1, -beta);
+    const double alpha2 = (I2 - K) * pow(I2, -beta);
+
+    return alpha2 * pow(S, beta) - alpha2 * bjs_phi(S, t1, beta, I2, I2, r, b, sig)
+         + bjs_phi(S, t1, 1, I2, I2, r, b, sig) - bjs_phi(S, t1, 1, I1, I2, r, b, sig)
+         - K * bjs_phi(S, t1, 0, I2, I2, r, b, sig) + K * bjs_phi(S, t1, 0, I1, I2, r, b, sig)
+         + alpha1 * bjs_phi(S, t1, beta, I1, I2, r, b, sig) - alpha1 * bjs_ksi(S, T, beta, I1, I2, I1, t1, r, b, sig)
+         + bjs_ksi(S, T, 1, I1, I2, I1, t1, r, b, sig) - bjs_ksi(S, T, 1, K, I2, I1, t1, r, b, sig)
+         - K * bjs_ksi(S, T, 0, I1, I2, I1, t1, r, b, sig) + K * bjs_ksi(S, T, 0, K, I2, I1, t1, r, b, sig);
+}
+
+// Bjerksund-Stensland 2002 American put via the put-call transformation P(S, K, r, b) = C(K, S, r - b, -b)
+double pricing_methods::price_american_bjs_put(double S, double K, double r, double T, double sig, double b) const {
+    INSTRUMENT_PROBE(american_bjs);
+    return price_american_bjs_call(K, S, r - b, T, sig, -b);
+}
+
+// Crank-Nicolson pricing: one grid per thread, allocated on first use and reused by every later solve
+static crank_nicolson_engine& pde_grid() {
+    thread_local crank_nicolson_engine engine;
+    return engine;
+}
+
+pde_result pricing_methods::price_american_pde(double S, double K, double r, double T, double sig, double b, int option_type) const {
+    INSTRUMENT_PROBE(american_pde);
+    crank_nicolson_engine& engine = pde_grid();
+    const double x = log(S / K);
+    engine.solve(r, T, sig, b, option_type, true, x, x);
+    return engine.value(S, K);
+}
+
+pde_result pricing_methods::price_european_pde(double S, double K, double r, double T, double sig, double b, int option_type) const {
+    INSTRUMENT_PROBE(european_pde);
+    crank_nicolson_engine& engine = pde_grid();
+    const double x = log(S / K);
+    engine.solve(r, T, sig, b, option_type, false, x, x);
+    return engine.value(S, K);
+}
+
+// Batch American pricing: the method and call/put branch are resolved per contract without virtual dispatch
+void pricing_methods::price_american_batch(std::span<const double> S, std::span<const double> K, std::span<const double> r,
+                                           std::span<const double> T, std::span<const double> sig, std::span<const double> b,
+                                           std::span<const int> option_type, american_method method, std::span<double> prices) const {
+    INSTRUMENT_PROBE_ITEMS(american_batch, S.size());
+    const std::size_t n = prices.size();
+    if (S.size() != n || K.size() != n || r.size() != n || T.size() != n || sig.size() != n || b.size() != n || option_type.size() != n) {
+        throw std::invalid_argument("Error: batch input spans must all have the same length");
+    }
+    if (method != american_method::perpetual && method != american_method::barone_adesi_whaley && method != american_method::bjerksund_stensland
+        && method != american_method::crank_nicolson) {
+        throw std::invalid_argument("Error: unknown American pricing method");
+    }
+    for (int type : option_type) {
+        if (type != option::CALL && type != option::PUT) throw std::domain_error("Select 1 for call or 2 for put");
+    }
+    if (method == american_method::crank_nicolson) {
+        // One solve per run of contracts with identical (r, T, sig, b, type); every strike and spot of the run is
+        // read off the same log-moneyness grid
+        crank_nicolson_engine& engine = pde_grid();
+        for (std::size_t first = 0; first < n;) {
+            std::size_t last = first + 1;
+            double x_lo = log(S[first] / K[first]), x_hi = x_lo;
+            while (last < n && r[last] == r[first] && T[last] == T[first] && sig[last] == sig[first] && b[last] == b[first]
+                   && option_type[last] == option_type[first]) {
+                const double x = log(S[last] / K[last]);
+                x_lo = std::min(x_lo, x);
+                x_hi = std::max(x_hi, x);
+                ++last;
+            }
+            engine.solve(r[first], T[first], sig[first], b[first], option_type[first], true, x_lo, x_hi);
+            for (std::size_t i = first; i < last; ++i) prices[i] = engine.value(S[i], K[i]).price;
+            first = last;
+        }
+        return;
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        const bool call = option_type[i] == option::CALL;
+        switch (method) {
+        case american_method::perpetual:
+            prices[i] = call ? price_american_call(S[i], K[i], r[i], sig[i], b[i]) : price_american_put(S[i], K[i], r[i], sig[i], b[i]);
+            break;
+        case american_method::barone_adesi_whaley:
+            prices[i] = call ? price_american_baw_call(S[i], K[i], r[i], T[i], sig[i], b[i]) : price_american_baw_put(S[i], K[i], r[i], T[i], sig[i], b[i]);
+            break;
+        default: // bjerksund_stensland (checked above)
+            prices[i] = call ? price_american_bjs_call(S[i], K[i], r[i], T[i], sig[i], b[i]) : price_american_bjs_put(S[i], K[i], r[i], T[i], sig[i], b[i]);
+            break;
+        }
+    }
+}
+
+
+// Price of one American option by the given method
+static double american_value(const pricing_methods& pm, american_method method, double S, double K, double r, double T, double sig,
+                             double b, int type) {
+    const bool call = type == option::CALL;
+    switch (method) {
+    case american_method::barone_adesi_whaley:
+        return call ? pm.price_american_baw_call(S, K, r, T, sig, b) : pm.price_american_baw_put(S, K, r, T, sig, b);
+    case american_method::bjerksund_stensland:
+        return call ? pm.price_american_bjs_call(S, K, r, T, sig, b) : pm.price_american_bjs_put(S, K, r, T, sig, b);
+    case american_method::crank_nicolson:
+        return pm.price_american_pde(S, K, r, T, sig, b, type).price;
+    default:
+        return call ? pm.price_american_call(S, K, r, sig, b) : pm.price_american_put(S, K, r, sig, b);
+    }
+}
+
+// Grid Greeks for crank_nicolson, central differences of the method's own price otherwise. Theta is the calendar
+// decay (V(T - dT) - V(T)) / dT, the sign convention of the European and grid thetas.
+american_greeks pricing_methods::price_and_greeks_american(double S, double K, double r, double T, double sig, double b, int option_type,
+                                                           american_method method) const {
+    if (option_type != option::CALL && option_type != option::PUT) throw std::domain_error("Select 1 for call or 2 for put");
+    if (method != american_method::perpetual && method != american_method::barone_adesi_whaley && method != american_method::bjerksund_stensland
+        && method != american_method::crank_nicolson) {
+        throw std::invalid_argument("Error: unknown American pricing method");
+    }
+    auto value = [&](double S_, double r_, double T_, double sig_, double b_) { return american_value(*this, method, S_, K, r_, T_, sig_, b_, option_type); };
+    american_greeks g{};
+    if (method == american_method::crank_nicolson) {
+        const pde_result grid = price_american_pde(S, K, r, T, sig, b, option_type);
+        g.price = grid.price;
+        g.delta = grid.delta;
+        g.gamma = grid.gamma;
+        g.theta = grid.theta;
+    } else {
+        g.price = value(S, r, T, sig, b);
+        const double h = 1e-3 * S;
+        const double up = value(S + h, r, T, sig, b), down = value(S - h, r, T, sig, b);
+        g.delta = (up - down) / (2 * h);
+        g.gamma = (up - 2 * g.price + down) / (h * h);
+        if (method != american_method::perpetual) {
+            const double dT = std::min(1.0 / 365, 0.5 * T);
+            g.theta = (value(S, r, T - dT, sig, b) - g.price) / dT;
+        }
+    }
+    const double dsig = std::min(1e-3, 0.5 * sig);
+    g.vega = (value(S, r, T, sig + dsig, b) - value(S, r, T, sig - dsig, b)) / (2 * dsig);
+    const double dr = 1e-4, db = (b != 0.0) ? dr : 0.0; // the European convention: b = r - q moves with r, futures keep b = 0
+    g.rho = (value(S, r + dr, T, sig, b + db) - value(S, r - dr, T, sig, b - db)) / (2 * dr);
+    return g;
+}
+
+
+
 // Asian option pricing methods
 // Function to simulate the path of the underlying asset price
 std::vector<double> pricing_methods::random_walk(double S, double T, double r, double sig, int N, std::mt19937& rng) const {
+    INSTRUMENT_PROBE(random_walk);
+    INSTRUMENT_MC(1, N, N);
     std::vector<double> path(N + 1);
     path[0] = S;
     std::normal_distribution<> dist(0.0, 1.0);  // Standard normal distribution
@@ -205,50 +855,445 @@ std::vector<double> pricing_methods::random_walk(double S, double T, double r, d
     return path;
 }
 
-// Function to price an Asian call option using Monte Carlo simulation
-double pricing_methods::price_asian_call(double S, double K, double T, double r, double sig, double b, int N, int M) const {
-    double payoff_sum = 0.0;
-    std::mt19937 rng(42); // Random seed for reproducibility
+// Counter-based variant: the path's N normals come from normal_pool in one call (Philox blocks keyed by (k, path))
+// and are overwritten by the spots in place
+std::vector<double> pricing_methods::random_walk(double S, double T, double r, double sig, int N, const philox& rng, std::uint64_t path) const {
+    INSTRUMENT_PROBE(random_walk);
+    INSTRUMENT_MC(1, N, N);
+    std::vector<double> path_values(N + 1);
+    normal_pool(rng).path(path, N, path_values.data() + 1);
+    path_values[0] = S;
+
+    double dt = T / N;  // Time increment
+    for (int i = 1; i <= N; ++i) {
+        path_values[i] = path_values[i - 1] * std::exp((r - 0.5 * sig * sig) * dt + sig * std::sqrt(dt) * path_values[i]);
+    }
+
+    return path_values;
+}
+
+// Streaming path kernel: advances path_lanes paths in lockstep, keeping the log-spot, running sum and running log
+// sum per lane on the stack. drift = (r - sig^2/2) dt and diffusion = sig sqrt(dt) are precomputed by the caller; exp
+// is the SIMD polynomial. With Antithetic the mirrored paths (-Z) are advanced from the same normals. With Greeks the
+// kernel also keeps the sums the pathwise derivatives of the average need (S/N sum e^x x and S/N sum e^x (j+1), with
+// x the log-move to fixing j + 1) and the first step's normal for the likelihood-ratio gamma.
+static constexpr std::size_t path_lanes = 8;
+
+struct lane_averages {
+    double arithmetic[2][path_lanes]; // [0] paths, [1] antithetic mirrors
+    double log_geometric[2][path_lanes];
+    double weighted_log[2][path_lanes]; // Greeks only
+    double weighted_step[2][path_lanes]; // Greeks only
+    double first_normal[path_lanes]; // Greeks only, mirrors use its negative
+};
+
+static_assert(path_lanes == mc_normals::lanes, "shared normals are stored in the kernel's lane order");
+static_assert(path_lanes == normal_pool::lanes, "one pool batch covers the kernel's lanes");
+
+// Normals come from `normals` when given (shared buffer of the same seed), otherwise from the pool
+template <bool Antithetic, bool Greeks = false>
+static void average_price_lanes(const normal_pool& pool, const mc_normals* normals, std::uint64_t first_path, double S, double drift, double diffusion, int N,
+                                lane_averages& out) {
+    using lane = simd_math::native_lane;
+    constexpr int sets = Antithetic ? 2 : 1;
+    alignas(64) double log_move[2][path_lanes] = {};
+    alignas(64) double sum[2][path_lanes] = {};
+    alignas(64) double log_sum[2][path_lanes] = {};
+    alignas(64) double weighted_log[2][path_lanes] = {};
+    alignas(64) double weighted_step[2][path_lanes] = {};
+    alignas(64) double Z[normal_pool::batch_steps][path_lanes];
+
+    for (int i = 0; i < N; ++i) {
+        const double* z;
+        if (normals) {
+            z = normals->at(first_path, i);
+        } else {
+            if (i % normal_pool::batch_steps == 0) pool.lanes_steps(first_path, static_cast<std::uint32_t>(i), Z); // steps past N are unused
+            z = Z[i % normal_pool::batch_steps];
+        }
+        if constexpr (Greeks) {
+            if (i == 0) std::copy(z, z + path_lanes, out.first_normal);
+        }
+        for (int set = 0; set < sets; ++set) {
+            const double sign = (set == 0) ? 1.0 : -1.0;
+            for (std::size_t l = 0; l < path_lanes; l += lane::width) {
+                const auto x = lane::fmadd(lane::load(z + l), lane::set1(sign * diffusion), lane::add(lane::load(log_move[set] + l), lane::set1(drift)));
+                const auto e = simd_math::exp_v<lane>(x);
+                lane::store(log_move[set] + l, x);
+                lane::store(log_sum[set] + l, lane::add(lane::load(log_sum[set] + l), x));
+                lane::store(sum[set] + l, lane::add(lane::load(sum[set] + l), e));
+                if constexpr (Greeks) {
+                    lane::store(weighted_log[set] + l, lane::fmadd(e, x, lane::load(weighted_log[set] + l)));
+                    lane::store(weighted_step[set] + l, lane::fmadd(e, lane::set1(i + 1.0), lane::load(weighted_step[set] + l)));
+                }
+            }
+        }
+    }
+    for (int set = 0; set < sets; ++set) {
+        for (std::size_t l = 0; l < path_lanes; ++l) {
+            out.arithmetic[set][l] = S * sum[set][l] / N;
+            out.log_geometric[set][l] = std::log(S) + log_sum[set][l] / N;
+            if constexpr (Greeks) {
+                out.weighted_log[set][l] = S * weighted_log[set][l] / N;
+                out.weighted_step[set][l] = S * weighted_step[set][l] / N;
+            }
+        }
+    }
+}
+
+// Pathwise and likelihood-ratio Greek samples of one path, undiscounted. With A the arithmetic average, w = +1 / -1
+// for a call / put, payoff y = max(0, w (A - K)) and I = 1{w (A - K) > 0}, and x_j = ln(S_j / S), t_j = (j + 1) dt:
+//     delta  I w A / S                                             (dA/dS = A / S)
+//     gamma  I w A / S^2 (Z_1 / (sig sqrt(dt)) - 1)                (pathwise delta, likelihood ratio on the first step)
+//     vega   I w (S/N) sum e^x_j (x_j - (r + sig^2/2) t_j) / sig   (dx_j/dsig)
+//     theta  r y - I w (S/N) sum e^x_j (x_j + (r - sig^2/2) t_j) / (2T)   (-dV/dT with the fixings scaled by T)
+//     rho    I w (S/N) sum e^x_j t_j - T y                          (drift and discount both move with r)
+struct asian_path_sensitivities {
+    double S, K, T, r, sig, dt, w;
+
+    void operator()(double average, double weighted_log, double weighted_step, double first_normal, double (&g)[5]) const {
+        const double y = std::max(0.0, w * (average - K));
+        const double in_the_money = (y > 0.0) ? w : 0.0;
+        const double weighted_time = weighted_step * dt;
+        g[0] = in_the_money * average / S;
+        g[1] = in_the_money * average / (S * S) * (first_normal / (sig * std::sqrt(dt)) - 1.0);
+        g[2] = in_the_money * (weighted_log - (r + 0.5 * sig * sig) * weighted_time) / sig;
+        g[3] = r * y - in_the_money * (weighted_log + (r - 0.5 * sig * sig) * weighted_time) / (2.0 * T);
+        g[4] = in_the_money * weighted_time - T * y;
+    }
+};
+
+// Moments are kept centred: per block a count, means and sums of squared (and cross) deviations from the means,
+// updated per sample with Welford's recurrence and merged across blocks with Chan et al.'s pairwise formula, in block
+// order so the totals stay bit-identical for any thread count. Raw sums of squares would cancel catastrophically in
+// sum_sq - n mean^2 for deep in-the-money payoffs, whose spread is small against their mean.
+
+// Per-block moments of the Greek samples (delta, gamma, vega, theta, rho)
+struct asian_greek_moments {
+    double n = 0.0, mean[5] = {}, m2[5] = {};
+
+    void add(const double (&g)[5]) {
+        n += 1.0;
+        for (int k = 0; k < 5; ++k) {
+            const double delta = g[k] - mean[k];
+            mean[k] += delta / n;
+            m2[k] += delta * (g[k] - mean[k]);
+        }
+    }
+    void merge(const asian_greek_moments& m) {
+        if (m.n == 0.0) return;
+        const double total = n + m.n;
+        for (int k = 0; k < 5; ++k) {
+            const double delta = m.mean[k] - mean[k];
+            mean[k] += delta * (m.n / total);
+            m2[k] += m.m2[k] + delta * delta * (n * m.n / total);
+        }
+        n = total;
+    }
+};
+
+// Per-block moments of the arithmetic payoff Y and the geometric payoff X: means, squared deviations and the
+// co-moment sum (x - mean_x)(y - mean_y)
+struct asian_block_moments {
+    double n = 0.0, mean_y = 0.0, mean_x = 0.0, m2_y = 0.0, m2_x = 0.0, c_xy = 0.0;
+
+    void add(double y, double x) {
+        n += 1.0;
+        const double dy = y - mean_y, dx = x - mean_x;
+        mean_y += dy / n;
+        mean_x += dx / n;
+        m2_y += dy * (y - mean_y);
+        m2_x += dx * (x - mean_x);
+        c_xy += dx * (y - mean_y);
+    }
+    void merge(const asian_block_moments& m) {
+        if (m.n == 0.0) return;
+        const double total = n + m.n, weight = n * m.n / total;
+        const double dy = m.mean_y - mean_y, dx = m.mean_x - mean_x;
+        mean_y += dy * (m.n / total);
+        mean_x += dx * (m.n / total);
+        m2_y += m.m2_y + dy * dy * weight;
+        m2_x += m.m2_x + dx * dx * weight;
+        c_xy += m.c_xy + dx * dy * weight;
+        n = total;
+    }
+};
+
+// Sample mean of Y, or the control-variate estimator Y - beta (X - E[X]) with beta = Cov(X, Y) / Var(X), and the
+// variance of one sample of that estimator. The residual variance Var(Y) - beta Cov(X, Y) is taken from the centred
+// sums, so it only loses the digits the correlation itself cancels; rounding can still leave it a few ulps below zero.
+static void estimate_from_moments(const asian_block_moments& total, bool control_variate, double expected_x, double& estimate, double& variance) {
+    const double dof = total.n - 1.0;
+    estimate = total.mean_y;
+    variance = dof > 0.0 ? total.m2_y / dof : 0.0;
+    if (control_variate && total.m2_x > 0.0) {
+        const double beta = total.c_xy / total.m2_x;
+        estimate = total.mean_y - beta * (total.mean_x - expected_x);
+        variance = dof > 0.0 ? std::max(0.0, total.m2_y - beta * total.c_xy) / dof : 0.0;
+    }
+}
+
+// Closed-form geometric Asian: ln G is normal with mean ln S + (r - sig^2/2) dt (N+1)/2 and variance sig^2 dt (N+1)(2N+1)/(6N)
+double pricing_methods::price_geometric_asian(double S, double K, double T, double r, double sig, int N, int option_type) const {
+    INSTRUMENT_PROBE(asian_geometric);
+    const double dt = T / N;
+    const double mean = std::log(S) + (r - 0.5 * sig * sig) * dt * (N + 1) * 0.5;
+    const double stdev = sig * std::sqrt(dt * (N + 1) * (2.0 * N + 1) / (6.0 * N));
+    const double forward = std::exp(mean + 0.5 * stdev * stdev);
+    const double d2Value = (mean - std::log(K)) / stdev;
+    const double d1Value = d2Value + stdev;
+
+    if (option_type == option::CALL) {
+        return std::exp(-r * T) * (forward * cdf(d1Value) - K * cdf(d2Value));
+    } else if (option_type == option::PUT) {
+        return std::exp(-r * T) * (K * cdf(-d2Value) - forward * cdf(-d1Value));
+    } else {
+        throw std::domain_error("Select 1 for call or 2 for put");
+    }
+}
+
+// Monte Carlo engine shared by the Asian call and put. Paths are cut into fixed blocks independent of the thread
+// count; each block's moments are written to their own slot and the slots are added in block order, so the result is
+// bit-identical for any number of threads. The only heap allocation is the block_moments vector.
+mc_result pricing_methods::price_asian_mc(double S, double K, double T, double r, double sig, double b, int N, int M, int option_type, const asian_mc_config& config) const {
+    INSTRUMENT_PROBE(asian_mc);
+    return asian_mc(S, K, T, r, sig, N, M, option_type, config, nullptr);
+}
+
+std::size_t pricing_methods::asian_mc_paths(int M, const asian_mc_config& config) {
+    return config.antithetic ? (static_cast<std::size_t>(M) + 1) / 2 : static_cast<std::size_t>(M);
+}
+
+// Same run with the Greek samples accumulated next to the payoff (see asian_path_sensitivities)
+asian_greeks pricing_methods::price_and_greeks_asian_mc(double S, double K, double T, double r, double sig, double b, int N, int M, int option_type,
+                                                        const asian_mc_config& config) const {
+    INSTRUMENT_PROBE(asian_mc_greeks);
+    asian_greeks greeks;
+    greeks.price = asian_mc(S, K, T, r, sig, N, M, option_type, config, &greeks);
+    return greeks;
+}
+
+// Greeks from the merged samples: mean and standard error of each, discounted
+static void greeks_from_moments(const asian_greek_moments& total, double discount, asian_greeks& greeks) {
+    mc_result* out[5] = {&greeks.delta, &greeks.gamma, &greeks.vega, &greeks.theta, &greeks.rho};
+    for (int k = 0; k < 5; ++k) {
+        const double variance = total.n > 1.0 ? total.m2[k] / (total.n - 1.0) : 0.0;
+        *out[k] = {discount * total.mean[k], discount * std::sqrt(variance / total.n)};
+    }
+}
+
+mc_result pricing_methods::asian_mc(double S, double K, double T, double r, double sig, int N, int M, int option_type, const asian_mc_config& config,
+                                    asian_greeks* greeks) const {
+    if (N <= 0 || M <= 0) throw std::invalid_argument("Error: number of time steps and simulations must be positive");
+    if (option_type != option::CALL && option_type != option::PUT) throw std::domain_error("Select 1 for call or 2 for put");
+    if (greeks && config.geometric_average) throw std::invalid_argument("Error: Asian Greeks are for the arithmetic average only");
+    if (config.sampler == mc_sampler::sobol) {
+        if (config.normals) throw std::invalid_argument("Error: shared normals apply to the pseudo-random sampler only");
+        return price_asian_qmc(S, K, T, r, sig, N, M, option_type, config, greeks);
+    }
+
+    // One sample per path, or per antithetic pair
+    const std::size_t n_samples = asian_mc_paths(M, config);
+    const mc_normals* normals = config.normals;
+    if (normals && (normals->seed() != config.seed || normals->steps() != N || normals->paths() < n_samples)) {
+        throw std::invalid_argument("Error: shared normals do not match the seed, time steps or simulations of the run");
+    }
+    // Mirrors reuse normals, and replayed normals are not drawn again
+    INSTRUMENT_MC((config.antithetic ? 2 : 1) * n_samples, (config.antithetic ? 2 : 1) * n_samples * N, normals ? 0 : n_samples * N);
+    const std::size_t block_size = 1024; // multiple of path_lanes
+    const std::size_t n_blocks = (n_samples + block_size - 1) / block_size;
+    std::vector<asian_block_moments> block_moments(n_blocks);
+    std::vector<asian_greek_moments> block_greeks(greeks ? n_blocks : 0);
+    const normal_pool pool(config.seed);
 
-    for (int i = 0; i < M; ++i) {
-        std::vector<double> path = random_walk(S, T, r, sig, N, rng);
+    const double dt = T / N;
+    const double drift = (r - 0.5 * sig * sig) * dt;
+    const double diffusion = sig * std::sqrt(dt);
+    const double sign = (option_type == option::CALL) ? 1.0 : -1.0;
+    const asian_path_sensitivities sensitivities{S, K, T, r, sig, dt, sign};
 
-        // Calculate the arithmetic average price
-        double average_price = 0.0;
-        for (int j = 1; j <= N; ++j) {
-            average_price += path[j];
+    parallel::for_blocks(n_blocks, config.n_threads, [&](std::size_t block, unsigned) {
+        const std::size_t first = block * block_size;
+        const std::size_t last = std::min(first + block_size, n_samples);
+        asian_block_moments m;
+        asian_greek_moments g;
+        lane_averages averages;
+        for (std::size_t p = first; p < last; p += path_lanes) {
+            if (greeks) {
+                if (config.antithetic) average_price_lanes<true, true>(pool, normals, p, S, drift, diffusion, N, averages);
+                else average_price_lanes<false, true>(pool, normals, p, S, drift, diffusion, N, averages);
+            } else {
+                if (config.antithetic) average_price_lanes<true>(pool, normals, p, S, drift, diffusion, N, averages);
+                else average_price_lanes<false>(pool, normals, p, S, drift, diffusion, N, averages);
+            }
+            const std::size_t active = std::min(path_lanes, last - p); // lanes past the last sample are simulated and dropped
+            for (std::size_t l = 0; l < active; ++l) {
+                auto average = [&](int set) { return config.geometric_average ? std::exp(averages.log_geometric[set][l]) : averages.arithmetic[set][l]; };
+                double y = std::max(0.0, sign * (average(0) - K));
+                double x = config.control_variate ? std::max(0.0, sign * (std::exp(averages.log_geometric[0][l]) - K)) : 0.0;
+                if (config.antithetic) {
+                    y = 0.5 * (y + std::max(0.0, sign * (average(1) - K)));
+                    if (config.control_variate) x = 0.5 * (x + std::max(0.0, sign * (std::exp(averages.log_geometric[1][l]) - K)));
+                }
+                m.add(y, x);
+                if (greeks) {
+                    double sample[5];
+                    sensitivities(averages.arithmetic[0][l], averages.weighted_log[0][l], averages.weighted_step[0][l], averages.first_normal[l], sample);
+                    if (config.antithetic) {
+                        double mirror[5];
+                        sensitivities(averages.arithmetic[1][l], averages.weighted_log[1][l], averages.weighted_step[1][l], -averages.first_normal[l], mirror);
+                        for (int k = 0; k < 5; ++k) sample[k] = 0.5 * (sample[k] + mirror[k]);
+                    }
+                    g.add(sample);
+                }
+            }
         }
-        average_price /= N;
+        block_moments[block] = m;
+        if (greeks) block_greeks[block] = g;
+    });
 
-        // Calculate the payoff
-        double payoff = std::max(0.0, average_price - K);
-        payoff_sum += payoff;
+    asian_block_moments total;
+    for (const auto& m : block_moments) total.merge(m);
+
+    const double discount = std::exp(-r * T);
+    const double expected_x = config.control_variate ? price_geometric_asian(S, K, T, r, sig, N, option_type) / discount : 0.0;
+    double estimate, variance;
+    estimate_from_moments(total, config.control_variate, expected_x, estimate, variance);
+    if (greeks) {
+        asian_greek_moments total_greeks;
+        for (const auto& g : block_greeks) total_greeks.merge(g);
+        greeks_from_moments(total_greeks, discount, *greeks);
     }
 
     // Discount the average payoff to present value
-    return (payoff_sum / M) * std::exp(-r * T);
+    return {estimate * discount, discount * std::sqrt(variance / n_samples)};
 }
 
-// Function to price an Asian put option using Monte Carlo simulation
-double pricing_methods::price_asian_put(double S, double K, double T, double r, double sig, double b, int N, int M) const {
-    double payoff_sum = 0.0;
-    std::mt19937 rng(42); // Random seed for reproducibility
+// out[i] = f(in[i]) over the widest SIMD lane, remainder in the scalar lane; f(lane_tag, reg) picks the lane from the tag
+template <class F>
+static void apply_lanes(const double* in, double* out, int n, F f) {
+    using lane = simd_math::native_lane;
+    int i = 0;
+    for (; i + static_cast<int>(lane::width) <= n; i += lane::width) lane::store(out + i, f(lane{}, lane::load(in + i)));
+    for (; i < n; ++i) out[i] = f(simd_math::scalar_lane{}, in[i]);
+}
+
+// Randomised QMC: R independent random digital shifts of one Sobol point set, paths built by Brownian bridge so the
+// first Sobol coordinates fix W(T) and the coarse midpoints. Each replicate gives an unbiased estimate; the price is
+// their mean and the standard error comes from their spread. Deterministic for any thread count.
+mc_result pricing_methods::price_asian_qmc(double S, double K, double T, double r, double sig, int N, int M, int option_type, const asian_mc_config& config,
+                                          asian_greeks* greeks) const {
+    const std::size_t replicates = static_cast<std::size_t>(std::max(1, config.qmc_replicates));
+    const std::size_t points = (static_cast<std::size_t>(M) + replicates - 1) / replicates;
+    const std::size_t n_samples = config.antithetic ? (points + 1) / 2 : points; // mirrored paths use -W
+    INSTRUMENT_MC(replicates * (config.antithetic ? 2 : 1) * n_samples, replicates * (config.antithetic ? 2 : 1) * n_samples * N,
+                  replicates * n_samples * N); // Sobol coordinates
+    const std::size_t block_size = 1024;
+    const std::size_t blocks_per_replicate = (n_samples + block_size - 1) / block_size;
+    std::vector<asian_block_moments> block_moments(replicates * blocks_per_replicate);
+    std::vector<asian_greek_moments> block_greeks(greeks ? block_moments.size() : 0);
+
+    const sobol_sequence sobol(N);
+    const brownian_bridge bridge(N, T);
+    std::vector<std::uint32_t> shifts(replicates * N);
+    const philox rng(config.seed);
+    for (std::size_t rep = 0; rep < replicates; ++rep) {
+        for (int d = 0; d < N; ++d) shifts[rep * N + d] = rng({static_cast<std::uint32_t>(d), static_cast<std::uint32_t>(rep), 0, 0x51A7u})[0];
+    }
+
+    const double dt = T / N;
+    const double mu = r - 0.5 * sig * sig;
+    const double log_S = std::log(S);
+    const double sign = (option_type == option::CALL) ? 1.0 : -1.0;
+    const asian_path_sensitivities sensitivities{S, K, T, r, sig, dt, sign};
+
+    parallel::for_blocks(block_moments.size(), config.n_threads, [&](std::size_t block, unsigned) {
+        const std::size_t rep = block / blocks_per_replicate;
+        const std::size_t first = (block % blocks_per_replicate) * block_size;
+        const std::size_t last = std::min(first + block_size, n_samples);
+        const std::uint32_t* shift = &shifts[rep * N];
+        std::vector<std::uint32_t> point(N);
+        std::vector<double> u(N), z(N), W(N), log_spot(N), spot(N);
+        asian_block_moments m;
+        asian_greek_moments g;
 
-    for (int i = 0; i < M; ++i) {
-        std::vector<double> path = random_walk(S, T, r, sig, N, rng);
+        sobol.point(first, point.data());
+        for (std::size_t i = first; i < last; ++i) {
+            for (int d = 0; d < N; ++d) u[d] = (static_cast<double>(point[d] ^ shift[d]) + 0.5) * 0x1.0p-32;
+            apply_lanes(u.data(), z.data(), N, [](auto lane_tag, auto v) { return simd_math::ninv_fast_v<decltype(lane_tag)>(v); });
+            bridge.build(z.data(), W.data());
 
-        // Calculate the arithmetic average price
-        double average_price = 0.0;
-        for (int j = 1; j <= N; ++j) {
-            average_price += path[j];
+            double y = 0.0, x = 0.0, sample[5] = {};
+            const int sets = config.antithetic ? 2 : 1;
+            for (int set = 0; set < sets; ++set) {
+                const double w_sign = (set == 0) ? sig : -sig;
+                double sum = 0.0, log_sum = 0.0;
+                for (int j = 0; j < N; ++j) {
+                    log_spot[j] = log_S + mu * dt * (j + 1) + w_sign * W[j];
+                    log_sum += log_spot[j];
+                }
+                apply_lanes(log_spot.data(), spot.data(), N, [](auto lane_tag, auto v) { return simd_math::exp_v<decltype(lane_tag)>(v); });
+                for (int j = 0; j < N; ++j) sum += spot[j];
+                y += std::max(0.0, sign * ((config.geometric_average ? std::exp(log_sum / N) : sum / N) - K));
+                if (config.control_variate) x += std::max(0.0, sign * (std::exp(log_sum / N) - K));
+                if (greeks) {
+                    double weighted_log = 0.0, weighted_step = 0.0, path[5];
+                    for (int j = 0; j < N; ++j) {
+                        weighted_log += spot[j] * (log_spot[j] - log_S);
+                        weighted_step += spot[j] * (j + 1);
+                    }
+                    // The bridge's first increment W(t_1) / sqrt(dt) is the first step's normal
+                    sensitivities(sum / N, weighted_log / N, weighted_step / N, (set == 0 ? W[0] : -W[0]) / std::sqrt(dt), path);
+                    for (int k = 0; k < 5; ++k) sample[k] += path[k] / sets;
+                }
+            }
+            m.add(y / sets, x / sets);
+            if (greeks) g.add(sample);
+            if (i + 1 < last) sobol.next(i, point.data());
         }
-        average_price /= N;
+        block_moments[block] = m;
+        if (greeks) block_greeks[block] = g;
+    });
 
-        // Calculate the payoff for the put option
-        double payoff = std::max(0.0, K - average_price);
-        payoff_sum += payoff;
+    const double discount = std::exp(-r * T);
+    const double expected_x = config.control_variate ? price_geometric_asian(S, K, T, r, sig, N, option_type) / discount : 0.0;
+    asian_block_moments replicate_prices; // one sample per replicate estimate (the X side stays unused)
+    asian_greek_moments replicate_greeks; // one sample per replicate mean of each Greek
+    for (std::size_t rep = 0; rep < replicates; ++rep) {
+        asian_block_moments total;
+        for (std::size_t k = 0; k < blocks_per_replicate; ++k) total.merge(block_moments[rep * blocks_per_replicate + k]);
+        double estimate, variance;
+        estimate_from_moments(total, config.control_variate, expected_x, estimate, variance);
+        replicate_prices.add(estimate, 0.0);
+        if (greeks) {
+            asian_greek_moments total_greeks;
+            for (std::size_t k = 0; k < blocks_per_replicate; ++k) total_greeks.merge(block_greeks[rep * blocks_per_replicate + k]);
+            replicate_greeks.add(total_greeks.mean);
+        }
+    }
+    double mean, var_rep;
+    estimate_from_moments(replicate_prices, false, 0.0, mean, var_rep);
+    if (greeks) {
+        // Each replicate mean is one sample, so the spread across replicates gives the standard errors
+        greeks_from_moments(replicate_greeks, discount, *greeks);
     }
 
     // Discount the average payoff to present value
-    return (payoff_sum / M) * std::exp(-r * T);
+    return {mean * discount, discount * std::sqrt(var_rep / replicates)};
+}
+
+// Function to price an Asian call option using Monte Carlo simulation
+double pricing_methods::price_asian_call(double S, double K, double T, double r, double sig, double b, int N, int M, std::uint64_t seed, unsigned n_threads) const {
+    asian_mc_config config;
+    config.seed = seed;
+    config.n_threads = n_threads;
+    return price_asian_mc(S, K, T, r, sig, b, N, M, option::CALL, config).price;
+}
+
+// Function to price an Asian put option using Monte Carlo simulation
+double pricing_methods::price_asian_put(double S, double K, double T, double r, double sig, double b, int N, int M, std::uint64_t seed, unsigned n_threads) const {
+    asian_mc_config config;
+    config.seed = seed;
+    config.n_threads = n_threads;
+    return price_asian_mc(S, K, T, r, sig, b, N, M, option::PUT, config).price;
 }
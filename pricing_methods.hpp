@@ -8,10 +8,92 @@
 #ifndef PRICING_METHODS_HPP
 #define PRICING_METHODS_HPP
 
+#include "mc_normals.hpp"
 #include "option.hpp"
+#include "philox.hpp"
+#include "pde_engine.hpp"
+#include <cstdint>
 #include <iostream>
 #include <vector>
 #include <random>
+#include <span>
+
+// Price, Greeks and put-call parity counterpart of one European option (filled by price_and_greeks_european)
+struct european_greeks {
+    double price;
+    double delta;
+    double gamma;
+    double vega;
+    double theta;
+    double rho;
+    double pcp_price; // put price for a call, call price for a put
+};
+
+// Output columns of price_and_greeks_european_batch, one entry per contract in each
+struct european_greeks_columns {
+    std::span<double> price, delta, gamma, vega, theta, rho, pcp_price;
+};
+
+// Pricing method for american_option
+enum class american_method {
+    perpetual, // closed form, no maturity
+    barone_adesi_whaley, // quadratic approximation (1987)
+    bjerksund_stensland, // two-step flat boundary approximation (2002)
+    crank_nicolson // finite-difference grid with Brennan-Schwartz early exercise
+};
+
+// Path generator for the Asian Monte-Carlo engine
+enum class mc_sampler {
+    pseudo_random, // Philox normals, paths stepped forward in time
+    sobol // randomised QMC: digitally shifted Sobol points + Brownian bridge
+};
+
+// Monte-Carlo engine settings for the Asian pricers
+struct asian_mc_config {
+    std::uint64_t seed = 42; // Philox key, same seed gives the same price
+    unsigned n_threads = 0; // 0 = all cores
+    bool antithetic = false; // pair every path with its mirror (-Z); M paths = M/2 pairs
+    bool control_variate = false; // geometric-average Asian (closed form) as control variate
+    mc_sampler sampler = mc_sampler::pseudo_random;
+    int qmc_replicates = 16; // sobol only: independent digital shifts, M/replicates points each
+    const mc_normals* normals = nullptr; // pseudo_random only: pre-generated normals for this seed and N, read instead of drawn
+    bool geometric_average = false; // geometric-average payoff instead: validation path against price_geometric_asian (no Greeks)
+};
+
+// Per-quote outcome of the implied-volatility solver (the batch solver reports these instead of throwing)
+enum class iv_status : std::uint8_t {
+    converged,
+    below_intrinsic, // price at or below the intrinsic (forward) value, vol is 0 or undefined
+    above_maximum, // price at or above the zero-strike bound (S e^((b-r)T) for a call, K e^(-rT) for a put)
+    max_iterations, // no convergence within the iteration cap, best iterate returned
+    invalid_input // non-positive or non-finite S, K, T, non-finite price/r/b, or option type not 1 or 2
+};
+
+// Monte-Carlo estimate and the standard error of the estimator
+struct mc_result {
+    double price;
+    double std_error;
+};
+
+// Price and Greeks of one American option, all from the same method (filled by price_and_greeks_american)
+struct american_greeks {
+    double price;
+    double delta;
+    double gamma;
+    double vega;
+    double theta; // calendar decay; 0 for the perpetual formula
+    double rho;
+};
+
+// Asian price and Greeks from one Monte-Carlo run, each with its standard error (theta per year, calendar decay)
+struct asian_greeks {
+    mc_result price;
+    mc_result delta;
+    mc_result gamma;
+    mc_result vega;
+    mc_result theta;
+    mc_result rho;
+};
 
 class pricing_methods {
 public:
@@ -24,6 +106,25 @@ public:
     double price_european_call(double S, double K, double r, double T, double sig, double b) const;
     double price_european_put(double S, double K, double r, double T, double sig, double b) const;
 
+// Batch Black-Scholes over structure-of-arrays inputs (one contract per index, option_type is option::CALL/PUT).
+// Vectorised with the widest lane the build targets (AVX-512, AVX2 or scalar, see simd_math.hpp). Prices agree with
+// price_european_call/put to within 1e-12 * max(S, K) absolute for T > 0, sig > 0. A batch that is all calls or all
+// puts, or has b = r or b = 0 throughout, runs a kernel specialised for that case (same results, fewer operations).
+    void price_european_batch(std::span<const double> S, std::span<const double> K, std::span<const double> r,
+                              std::span<const double> T, std::span<const double> sig, std::span<const double> b,
+                              std::span<const int> option_type, std::span<double> prices) const;
+
+// Implied volatility: the quote is normalised to an out-of-the-money Black price (the reduction used by Jaeckel's
+// "Let's Be Rational"), started from the small- or large-vol asymptote and polished with third-order Householder
+// steps kept inside a bracket. The batch version runs lanes of quotes in lockstep and reports a status per quote
+// instead of throwing; it only throws if the spans differ in length. Out-of-the-money quotes recover the vol to
+// ~1e-12 relative; deep in-the-money quotes are limited by how much time value survives in the price.
+    void implied_volatility_batch(std::span<const double> price, std::span<const double> S, std::span<const double> K,
+                                  std::span<const double> r, std::span<const double> T, std::span<const double> b,
+                                  std::span<const int> option_type, std::span<double> vol, std::span<iv_status> status) const;
+    // Single quote; throws std::invalid_argument unless the solve converges
+    double implied_volatility(double price, double S, double K, double r, double T, double b, int option_type) const;
+
 // European option put-call parity functions
     double PCP_put_to_call(double S, double K, double r, double T, double p) const; // Put-call parity (PCP) price for CALL (given put get call price)
     double PCP_call_to_put(double S, double K, double r, double T, double c) const; // Put-call parity price for PUT (given put get call)
@@ -37,23 +138,70 @@ public:
     double gamma(double S, double K, double r, double T, double sig, double b) const; 
     // Vega
     double vega(double S, double K, double r, double T, double sig, double b) const;
-    // Theta for call and put
+    // Theta for call and put: calendar decay -dV/dT per year
     double theta_call(double S, double K, double r, double T, double sig, double b) const;
     double theta_put(double S, double K, double r, double T, double sig, double b) const;
-    // Rho for call and put
+    // Rho for call and put: b = r - q moves with r (fixed q) unless b = 0 (futures), where rho = -T * price
     double rho_call(double S, double K, double r, double T, double sig, double b) const;
     double rho_put(double S, double K, double r, double T, double sig, double b) const;
+    // Price, all Greeks and the parity counterpart from a single evaluation of d1, d2, the discount factors and N(.)
+    european_greeks price_and_greeks_european(double S, double K, double r, double T, double sig, double b, int option_type) const;
+    // The same over structure-of-arrays inputs, vectorised like price_european_batch
+    void price_and_greeks_european_batch(std::span<const double> S, std::span<const double> K, std::span<const double> r,
+                                         std::span<const double> T, std::span<const double> sig, std::span<const double> b,
+                                         std::span<const int> option_type, const european_greeks_columns& out) const;
 
 // Black-Scholes for American options formulae
     double y1(double K, double r, double sig, double b) const;
     double y2(double K, double r, double sig, double b) const;
     double price_american_call(double S, double K, double r, double sig, double b) const;
     double price_american_put(double S, double K, double r, double sig, double b) const;
+    // Finite maturity: Barone-Adesi-Whaley (Newton solve for the critical price) and Bjerksund-Stensland 2002
+    double price_american_baw_call(double S, double K, double r, double T, double sig, double b) const;
+    double price_american_baw_put(double S, double K, double r, double T, double sig, double b) const;
+    double price_american_bjs_call(double S, double K, double r, double T, double sig, double b) const;
+    double price_american_bjs_put(double S, double K, double r, double T, double sig, double b) const;
+    // Crank-Nicolson grid price with delta, gamma and theta; the European version is the validation path
+    pde_result price_american_pde(double S, double K, double r, double T, double sig, double b, int option_type) const;
+    pde_result price_european_pde(double S, double K, double r, double T, double sig, double b, int option_type) const;
+    // Batch over structure-of-arrays inputs with one method for the whole batch (T is ignored for perpetual).
+    // crank_nicolson solves once per run of consecutive contracts sharing (r, T, sig, b, type), e.g. a strike chain.
+    // Every option_type is checked before any pricing (std::domain_error), the method too (std::invalid_argument)
+    void price_american_batch(std::span<const double> S, std::span<const double> K, std::span<const double> r,
+                              std::span<const double> T, std::span<const double> sig, std::span<const double> b,
+                              std::span<const int> option_type, american_method method, std::span<double> prices) const;
+    // Price and Greeks from one method, so the Greeks are derivatives of that price: the grid delta, gamma and theta
+    // for crank_nicolson, central differences of the method's own price otherwise; vega and rho are always bumped
+    // (rho moves b with r unless b = 0, as in the European rho)
+    american_greeks price_and_greeks_american(double S, double K, double r, double T, double sig, double b, int option_type,
+                                              american_method method = american_method::bjerksund_stensland) const;
 
 // Black-Scholes for Asian options simulated with Monte-Carlo
     std::vector<double> random_walk(double S, double T, double r, double sig, int N, std::mt19937& rng) const;
-    double price_asian_call(double S, double K, double T, double r, double sig, double b, int N, int M) const;
-    double price_asian_put(double S, double K, double T, double r, double sig, double b, int N, int M) const;
+    // Path number `path` of a counter-based walk: depends only on (seed, path), not on which thread generates it
+    std::vector<double> random_walk(double S, double T, double r, double sig, int N, const philox& rng, std::uint64_t path) const;
+    // N time steps, M paths split over n_threads threads (0 = all cores); bit-identical for any thread count
+    double price_asian_call(double S, double K, double T, double r, double sig, double b, int N, int M, std::uint64_t seed = 42, unsigned n_threads = 0) const;
+    double price_asian_put(double S, double K, double T, double r, double sig, double b, int N, int M, std::uint64_t seed = 42, unsigned n_threads = 0) const;
+    // Full engine: price and standard error with optional antithetic sampling and geometric control variate
+    mc_result price_asian_mc(double S, double K, double T, double r, double sig, double b, int N, int M, int option_type, const asian_mc_config& config) const;
+    // Price and Greeks in the same pass: pathwise delta, vega, theta and rho, likelihood-ratio (mixed) gamma. The
+    // control variate applies to the price only. The extra path sums ride on the exp() already taken per step, so
+    // the run costs about the same as price_asian_mc, against six more runs for bump-and-reprice.
+    asian_greeks price_and_greeks_asian_mc(double S, double K, double T, double r, double sig, double b, int N, int M, int option_type,
+                                           const asian_mc_config& config) const;
+    // Paths a pseudo-random price_asian_mc run with M simulations draws normals for (mirrors reuse their path's), i.e.
+    // the size of the mc_normals that can be shared across its runs
+    static std::size_t asian_mc_paths(int M, const asian_mc_config& config);
+    // Closed-form geometric-average Asian on the same N discrete fixings as the Monte-Carlo paths
+    double price_geometric_asian(double S, double K, double T, double r, double sig, int N, int option_type) const;
+
+private:
+    // Engines behind price_asian_mc / price_and_greeks_asian_mc; Greeks are filled in when greeks is not null
+    mc_result asian_mc(double S, double K, double T, double r, double sig, int N, int M, int option_type, const asian_mc_config& config,
+                       asian_greeks* greeks) const;
+    mc_result price_asian_qmc(double S, double K, double T, double r, double sig, int N, int M, int option_type, const asian_mc_config& config,
+                              asian_greeks* greeks) const;
 
 };
 
@@ -0,0 +1,220 @@
+// risk_engine.cpp
+//
+// Parallel position-weighted Greek aggregation over a portfolio with per-work-item bucket sums merged in item order
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#include "risk_engine.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <charconv>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+// Contracts per work item: European Greeks are cheap, American ones cost several reprices each
+static constexpr std::size_t european_chunk = 4096;
+static constexpr std::size_t american_chunk = 256;
+
+risk_totals& risk_totals::operator+=(const risk_totals& other) {
+    value += other.value;
+    delta += other.delta;
+    dollar_delta += other.dollar_delta;
+    gamma += other.gamma;
+    dollar_gamma += other.dollar_gamma;
+    vega += other.vega;
+    theta += other.theta;
+    rho += other.rho;
+    positions += other.positions;
+    return *this;
+}
+
+// Per-contract value and Greeks before position weighting
+struct contract_risk {
+    double value = 0.0, delta = 0.0, gamma = 0.0, vega = 0.0, theta = 0.0, rho = 0.0;
+};
+
+// Sums of one bucket cell over one work item
+struct cell_sum {
+    std::size_t cell;
+    risk_totals totals;
+};
+
+// Per-thread scratch: the current work item's cell sums in first-touch order, where each cell sits in them, and the
+// Greek columns of one European chunk
+struct item_table {
+    static constexpr std::size_t untouched = std::size_t(-1);
+    std::vector<std::size_t> slot_of; // by cell
+    std::vector<cell_sum> sums;
+    std::vector<double> columns;
+};
+
+static std::size_t bucket_of(const std::vector<double>& edges, double x) {
+    return static_cast<std::size_t>(std::upper_bound(edges.begin(), edges.end(), x) - edges.begin());
+}
+
+static void check_edges(const std::vector<double>& edges) {
+    if (!std::is_sorted(edges.begin(), edges.end()) || std::adjacent_find(edges.begin(), edges.end()) != edges.end()) {
+        throw std::invalid_argument("Error: risk bucket edges must be strictly increasing");
+    }
+}
+
+risk_engine::risk_engine(risk_bucketing bucketing) : bucketing(std::move(bucketing)) {
+    check_edges(this->bucketing.expiry_edges);
+    check_edges(this->bucketing.moneyness_edges);
+    if (this->bucketing.expiry_buckets() > 0xFFFF || this->bucketing.moneyness_buckets() > 0xFFFF) {
+        throw std::invalid_argument("Error: too many risk buckets");
+    }
+}
+
+risk_report risk_engine::aggregate(const portfolio& book, std::span<const double> quantity, std::span<const std::uint32_t> underlying,
+                                   unsigned n_threads) const {
+    if (quantity.size() != book.size() || underlying.size() != book.size()) {
+        throw std::invalid_argument("Error: quantity and underlying must have one entry per contract");
+    }
+    const std::size_t n_underlyings = underlying.empty() ? 0 : std::size_t(*std::max_element(underlying.begin(), underlying.end())) + 1;
+    const std::size_t n_expiry = bucketing.expiry_buckets(), n_moneyness = bucketing.moneyness_buckets();
+    const std::size_t table_size = n_underlyings * n_expiry * n_moneyness;
+
+    // Adds a contract's position-weighted risk to the thread's table
+    auto accumulate = [&](item_table& table, std::size_t position, double S, double K, double T, const contract_risk& g) {
+        const double q = quantity[position];
+        const std::size_t cell = (underlying[position] * n_expiry + bucket_of(bucketing.expiry_edges, T)) * n_moneyness
+                                 + bucket_of(bucketing.moneyness_edges, S / K);
+        std::size_t& slot = table.slot_of[cell];
+        if (slot == item_table::untouched) {
+            slot = table.sums.size();
+            table.sums.push_back({cell, risk_totals()});
+        }
+        risk_totals& t = table.sums[slot].totals;
+        t.value += q * g.value;
+        t.delta += q * g.delta;
+        t.dollar_delta += q * g.delta * S;
+        t.gamma += q * g.gamma;
+        t.dollar_gamma += q * g.gamma * S * S * 0.01;
+        t.vega += q * g.vega;
+        t.theta += q * g.theta;
+        t.rho += q * g.rho;
+        ++t.positions;
+    };
+
+    const portfolio::contract_block& eu = book.european;
+    const portfolio::american_block& am = book.american;
+    const portfolio::asian_block& as = book.asian;
+    const std::size_t european_items = (eu.size() + european_chunk - 1) / european_chunk;
+    const std::size_t american_items = (am.size() + american_chunk - 1) / american_chunk;
+    const std::size_t n_items = european_items + american_items + as.size();
+    // Each item is summed in contract order and the items are merged into cells in item order, so the report does not
+    // depend on the thread count or on which thread ran which item. A finished item waits in its slot until every
+    // earlier one has been merged; merged sum vectors are recycled, so few are alive at once.
+    std::vector<risk_totals> cells(table_size);
+    std::vector<std::vector<cell_sum>> finished(n_items);
+    std::vector<char> done(n_items, 0);
+    std::vector<std::vector<cell_sum>> spare;
+    std::size_t merged = 0;
+    std::mutex merge_mutex;
+    std::vector<item_table> scratch(parallel::resolve_threads(n_threads));
+    const pricing_methods& pm = book.pricer;
+
+    parallel::for_blocks(n_items, n_threads, [&](std::size_t item, unsigned thread) {
+        item_table& table = scratch[thread];
+        if (table.slot_of.empty()) table.slot_of.assign(table_size, item_table::untouched);
+        if (item < european_items) {
+            // Greeks for the whole chunk from the vectorised kernel, then one pass to bucket them
+            const std::size_t first = item * european_chunk, count = std::min(european_chunk, eu.size() - first);
+            std::vector<double>& columns = table.columns;
+            columns.resize(7 * european_chunk);
+            auto column = [&](int c) { return std::span<double>(columns).subspan(c * european_chunk, count); };
+            const european_greeks_columns e{column(0), column(1), column(2), column(3), column(4), column(5), column(6)};
+            auto slice = [&](const auto& v) { return std::span(v).subspan(first, count); };
+            pm.price_and_greeks_european_batch(slice(eu.spot), slice(eu.strike), slice(eu.rate), slice(eu.maturity), slice(eu.volatility),
+                                               slice(eu.cost_of_carry), slice(eu.option_type), e);
+            for (std::size_t j = 0; j < count; ++j) {
+                const std::size_t i = first + j;
+                accumulate(table, eu.position[i], eu.spot[i], eu.strike[i], eu.maturity[i], {e.price[j], e.delta[j], e.gamma[j], e.vega[j], e.theta[j], e.rho[j]});
+            }
+        } else if (item < european_items + american_items) {
+            const std::size_t first = (item - european_items) * american_chunk, last = std::min(am.size(), first + american_chunk);
+            for (std::size_t i = first; i < last; ++i) {
+                const american_greeks a = pm.price_and_greeks_american(am.spot[i], am.strike[i], am.rate[i], am.maturity[i], am.volatility[i],
+                                                                       am.cost_of_carry[i], am.option_type[i], am.method[i]);
+                accumulate(table, am.position[i], am.spot[i], am.strike[i], am.maturity[i], {a.price, a.delta, a.gamma, a.vega, a.theta, a.rho});
+            }
+        } else {
+            const std::size_t i = item - european_items - american_items;
+            asian_mc_config config = as.config[i];
+            config.n_threads = 1; // the book is already spread across the threads
+            const asian_greeks a = pm.price_and_greeks_asian_mc(as.spot[i], as.strike[i], as.maturity[i], as.rate[i], as.volatility[i],
+                                                                as.cost_of_carry[i], as.n_time_steps[i], as.n_simulations[i], as.option_type[i], config);
+            const contract_risk g{a.price.price, a.delta.price, a.gamma.price, a.vega.price, a.theta.price, a.rho.price};
+            accumulate(table, as.position[i], as.spot[i], as.strike[i], as.maturity[i], g);
+        }
+        for (const cell_sum& sum : table.sums) table.slot_of[sum.cell] = item_table::untouched;
+
+        const std::lock_guard lock(merge_mutex);
+        finished[item].swap(table.sums);
+        done[item] = 1;
+        for (; merged < n_items && done[merged]; ++merged) {
+            for (const cell_sum& sum : finished[merged]) cells[sum.cell] += sum.totals;
+            finished[merged].clear();
+            spare.push_back(std::move(finished[merged]));
+        }
+        if (!spare.empty()) {
+            table.sums = std::move(spare.back());
+            spare.pop_back();
+        }
+    });
+
+    // Roll up
+    risk_report report;
+    report.bucketing = bucketing;
+    report.by_underlying.resize(n_underlyings);
+    for (std::size_t c = 0; c < table_size; ++c) {
+        if (cells[c].positions == 0) continue;
+        const std::size_t u = c / (n_expiry * n_moneyness);
+        report.buckets.push_back({static_cast<std::uint32_t>(u), static_cast<std::uint16_t>(c / n_moneyness % n_expiry),
+                                  static_cast<std::uint16_t>(c % n_moneyness), cells[c]});
+        report.by_underlying[u] += cells[c];
+        report.book += cells[c];
+    }
+    return report;
+}
+
+// Report output
+static std::string edge_label(const std::vector<double>& edges, std::size_t bucket) {
+    auto number = [](double value) {
+        char buffer[32];
+        return std::string(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value).ptr);
+    };
+    const std::string low = bucket == 0 ? "" : number(edges[bucket - 1]);
+    const std::string high = bucket == edges.size() ? "" : number(edges[bucket]);
+    return "[" + low + ";" + high + ")";
+}
+
+static void write_totals(std::ostream& out, const risk_totals& t) {
+    char buffer[256];
+    char* p = buffer;
+    for (const double value : {t.value, t.delta, t.dollar_delta, t.gamma, t.dollar_gamma, t.vega, t.theta, t.rho}) {
+        *p++ = ',';
+        p = std::to_chars(p, buffer + sizeof(buffer), value).ptr;
+    }
+    out.write(buffer, p - buffer);
+    out << ',' << t.positions << '\n';
+}
+
+void risk_report::write_csv(std::ostream& out) const {
+    out << "underlying,expiry,moneyness,value,delta,dollar_delta,gamma,dollar_gamma,vega,theta,rho,positions\n";
+    for (const risk_bucket& b : buckets) {
+        out << b.underlying << ',' << edge_label(bucketing.expiry_edges, b.expiry_bucket) << ','
+            << edge_label(bucketing.moneyness_edges, b.moneyness_bucket);
+        write_totals(out, b.totals);
+    }
+    for (std::size_t u = 0; u < by_underlying.size(); ++u) {
+        if (by_underlying[u].positions == 0) continue;
+        out << u << ",all,all";
+        write_totals(out, by_underlying[u]);
+    }
+    out << "book,all,all";
+    write_totals(out, book);
+}
@@ -0,0 +1,82 @@
+// risk_engine.hpp
+//
+// Book-level risk: position-weighted value and Greeks over a portfolio, summed per (underlying, expiry bucket,
+// moneyness bucket) and rolled up per underlying and for the whole book.
+//
+// Per contract: European options use pricing_methods::price_and_greeks_european_batch, a chunk at a time. American
+// options use pricing_methods::price_and_greeks_american with their own method (grid delta, gamma and theta for
+// crank_nicolson, central differences of their own pricer otherwise; vega and rho bumped). Asian
+// options take their price and Greeks from one Monte-Carlo run (pricing_methods::price_and_greeks_asian_mc). The
+// book is split into chunks spread over the threads. Each chunk is summed into a dense bucket table private to its
+// thread, so the inner loop shares nothing, and leaves the cells it touched in its own slot; the slots are merged in
+// chunk order, so the report is bit-for-bit the same for any thread count.
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#ifndef RISK_ENGINE_HPP
+#define RISK_ENGINE_HPP
+
+#include "portfolio.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <vector>
+
+// Position-weighted sums (quantity x per-contract value)
+struct risk_totals {
+    double value = 0.0;
+    double delta = 0.0; // underlying units
+    double dollar_delta = 0.0; // delta x S
+    double gamma = 0.0;
+    double dollar_gamma = 0.0; // change in dollar delta for a 1% move, gamma x S^2 / 100
+    double vega = 0.0; // per unit of volatility
+    double theta = 0.0; // per year
+    double rho = 0.0; // per unit of rate
+    std::uint64_t positions = 0;
+
+    risk_totals& operator+=(const risk_totals& other);
+};
+
+// Bucket edges: a contract falls in the first bucket whose upper edge exceeds it, or in the last (open) bucket.
+// Moneyness is S / K.
+struct risk_bucketing {
+    std::vector<double> expiry_edges = {1.0 / 12, 0.25, 0.5, 1.0, 2.0, 5.0}; // years
+    std::vector<double> moneyness_edges = {0.8, 0.9, 0.97, 1.03, 1.1, 1.2};
+
+    std::size_t expiry_buckets() const { return expiry_edges.size() + 1; }
+    std::size_t moneyness_buckets() const { return moneyness_edges.size() + 1; }
+};
+
+struct risk_bucket {
+    std::uint32_t underlying;
+    std::uint16_t expiry_bucket;
+    std::uint16_t moneyness_bucket;
+    risk_totals totals;
+};
+
+struct risk_report {
+    risk_bucketing bucketing;
+    std::vector<risk_bucket> buckets; // non-empty buckets, ordered by (underlying, expiry, moneyness)
+    std::vector<risk_totals> by_underlying; // indexed by underlying id
+    risk_totals book;
+
+    // One line per non-empty bucket, then one per underlying (bucket columns "all") and one for the book
+    void write_csv(std::ostream& out) const;
+};
+
+class risk_engine {
+public:
+    explicit risk_engine(risk_bucketing bucketing = risk_bucketing());
+
+    // quantity and underlying are indexed like the book's contracts (insertion order). Underlying ids are dense,
+    // 0 to max id, so the bucket tables can be indexed directly.
+    risk_report aggregate(const portfolio& book, std::span<const double> quantity, std::span<const std::uint32_t> underlying,
+                          unsigned n_threads = 0) const;
+
+private:
+    risk_bucketing bucketing;
+};
+
+#endif // RISK_ENGINE_HPP
@@ -0,0 +1,182 @@
+// scenario_engine.cpp
+//
+// Taylor and full-revaluation stress P&L over a portfolio, parallel over (chunk, scenario) work items
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#include "scenario_engine.hpp"
+#include "parallel.hpp"
+#include "risk_engine.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+// Contracts per work item (each item reprices its chunk under one scenario)
+static constexpr std::size_t european_chunk = 4096;
+static constexpr std::size_t american_chunk = 256;
+
+std::vector<scenario_shock> scenario_engine::grid(std::span<const double> spot, std::span<const double> volatility, std::span<const double> rate) {
+    std::vector<scenario_shock> shocks;
+    shocks.reserve(spot.size() * volatility.size() * rate.size());
+    for (const double s : spot) {
+        for (const double v : volatility) {
+            for (const double r : rate) shocks.push_back({s, v, r});
+        }
+    }
+    return shocks;
+}
+
+// Shocked inputs of one chunk of a block, written into per-thread scratch columns
+struct shocked_chunk {
+    std::vector<double> spot, rate, volatility, cost_of_carry, prices;
+
+    void fill(const std::vector<double>& S, const std::vector<double>& r, const std::vector<double>& sig, const std::vector<double>& b,
+              std::size_t first, std::size_t count, const scenario_shock& shock) {
+        for (auto* column : {&spot, &rate, &volatility, &cost_of_carry, &prices}) column->resize(count);
+        for (std::size_t j = 0; j < count; ++j) {
+            const std::size_t i = first + j;
+            spot[j] = S[i] * (1.0 + shock.spot);
+            rate[j] = r[i] + shock.rate;
+            volatility[j] = sig[i] + shock.volatility;
+            cost_of_carry[j] = (b[i] != 0.0) ? b[i] + shock.rate : b[i];
+        }
+    }
+};
+
+scenario_report scenario_engine::run(const portfolio& book, std::span<const double> quantity, std::span<const scenario_shock> shocks,
+                                     scenario_mode mode, unsigned n_threads) const {
+    if (quantity.size() != book.size()) throw std::invalid_argument("Error: quantity must have one entry per contract");
+    const bool taylor = mode != scenario_mode::full_revaluation, full = mode != scenario_mode::taylor;
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const std::size_t n_scenarios = shocks.size();
+
+    // The shocks must leave every contract priceable (in Taylor mode too: an expansion around an unpriceable point means nothing)
+    double min_vol = std::numeric_limits<double>::infinity();
+    for (const auto* block : {&book.european, static_cast<const portfolio::contract_block*>(&book.american),
+                              static_cast<const portfolio::contract_block*>(&book.asian)}) {
+        if (block->size()) min_vol = std::min(min_vol, *std::min_element(block->volatility.begin(), block->volatility.end()));
+    }
+    for (const scenario_shock& x : shocks) {
+        if (x.spot <= -1.0) throw std::invalid_argument("Error: spot shock must be above -100%");
+        if (min_vol + x.volatility <= 0.0) throw std::invalid_argument("Error: volatility shock takes a contract's volatility to zero or below");
+    }
+
+    scenario_report report;
+    report.scenarios.resize(n_scenarios);
+    for (std::size_t s = 0; s < n_scenarios; ++s) report.scenarios[s] = {shocks[s], nan, nan, nan};
+
+    if (taylor) {
+        // One bucket for the whole book: its totals are all the expansion needs
+        risk_bucketing whole_book;
+        whole_book.expiry_edges.clear();
+        whole_book.moneyness_edges.clear();
+        const std::vector<std::uint32_t> one_underlying(book.size(), 0);
+        const risk_totals g = risk_engine(whole_book).aggregate(book, quantity, one_underlying, n_threads).book;
+        report.base_value = g.value;
+        for (scenario_result& result : report.scenarios) {
+            const scenario_shock& x = result.shock;
+            result.taylor_pnl = g.dollar_delta * x.spot + 50.0 * g.dollar_gamma * x.spot * x.spot + g.vega * x.volatility + g.rho * x.rate;
+        }
+    }
+
+    if (full) {
+        std::vector<double> base(book.size());
+        book.price(base, n_threads);
+        double base_value = 0.0;
+        for (std::size_t i = 0; i < base.size(); ++i) base_value += quantity[i] * base[i];
+        report.base_value = base_value;
+
+        const portfolio::contract_block& eu = book.european;
+        const portfolio::american_block& am = book.american;
+        const portfolio::asian_block& as = book.asian;
+        const pricing_methods& pm = book.pricer;
+        const std::size_t european_units = (eu.size() + european_chunk - 1) / european_chunk;
+        const std::size_t american_units = (am.size() + american_chunk - 1) / american_chunk;
+        const std::size_t n_units = european_units + american_units + as.size();
+
+        // pnl[unit * n_scenarios + scenario]; consecutive items share a chunk, so its inputs stay in cache
+        std::vector<double> pnl(n_units * n_scenarios, 0.0);
+        std::vector<shocked_chunk> scratch(parallel::resolve_threads(n_threads));
+        parallel::for_blocks(n_units * n_scenarios, n_threads, [&](std::size_t item, unsigned thread) {
+            const std::size_t unit = item / n_scenarios;
+            const scenario_shock& x = shocks[item % n_scenarios];
+            shocked_chunk& c = scratch[thread];
+            double sum = 0.0;
+            if (unit < european_units + american_units) {
+                const bool is_european = unit < european_units;
+                const portfolio::contract_block& block = is_european ? eu : static_cast<const portfolio::contract_block&>(am);
+                const std::size_t chunk = is_european ? european_chunk : american_chunk;
+                const std::size_t first = (is_european ? unit : unit - european_units) * chunk;
+                const std::size_t count = std::min(chunk, block.size() - first);
+                c.fill(block.spot, block.rate, block.volatility, block.cost_of_carry, first, count, x);
+                auto slice = [&](const auto& column) { return std::span(column).subspan(first, count); };
+                if (is_european) {
+                    pm.price_european_batch(c.spot, slice(eu.strike), c.rate, slice(eu.maturity), c.volatility, c.cost_of_carry,
+                                            slice(eu.option_type), c.prices);
+                } else {
+                    // One batch call per run of contracts sharing a method, as in portfolio::price
+                    for (std::size_t run = 0; run < count;) {
+                        const american_method method = am.method[first + run];
+                        std::size_t last = run + 1;
+                        while (last < count && am.method[first + last] == method) ++last;
+                        const std::size_t length = last - run;
+                        auto part = [&](const auto& column) { return std::span(column).subspan(run, length); };
+                        auto block_part = [&](const auto& column) { return std::span(column).subspan(first + run, length); };
+                        pm.price_american_batch(part(c.spot), block_part(am.strike), part(c.rate), block_part(am.maturity), part(c.volatility),
+                                                part(c.cost_of_carry), block_part(am.option_type), method,
+                                                std::span<double>(c.prices).subspan(run, length));
+                        run = last;
+                    }
+                }
+                for (std::size_t j = 0; j < count; ++j) {
+                    const std::size_t position = block.position[first + j];
+                    sum += quantity[position] * (c.prices[j] - base[position]);
+                }
+            } else {
+                const std::size_t i = unit - european_units - american_units;
+                asian_mc_config config = as.config[i];
+                config.n_threads = 1; // the scenarios are already spread across the threads
+                const double r = as.rate[i] + x.rate, b = as.cost_of_carry[i] + ((as.cost_of_carry[i] != 0.0) ? x.rate : 0.0);
+                const double shocked = pm.price_asian_mc(as.spot[i] * (1.0 + x.spot), as.strike[i], as.maturity[i], r, as.volatility[i] + x.volatility,
+                                                         b, as.n_time_steps[i], as.n_simulations[i], as.option_type[i], config).price;
+                sum = quantity[as.position[i]] * (shocked - base[as.position[i]]);
+            }
+            pnl[item] = sum;
+        });
+
+        for (std::size_t s = 0; s < n_scenarios; ++s) {
+            double total = 0.0;
+            for (std::size_t unit = 0; unit < n_units; ++unit) total += pnl[unit * n_scenarios + s];
+            report.scenarios[s].full_pnl = total;
+        }
+    }
+
+    if (taylor && full) {
+        for (std::size_t s = 0; s < n_scenarios; ++s) {
+            scenario_result& result = report.scenarios[s];
+            result.error = result.taylor_pnl - result.full_pnl;
+            if (std::fabs(result.error) > report.max_abs_error) {
+                report.max_abs_error = std::fabs(result.error);
+                report.worst_scenario = s;
+            }
+        }
+    }
+    return report;
+}
+
+void scenario_report::write_csv(std::ostream& out) const {
+    out << "spot_shock,vol_shock,rate_shock,taylor_pnl,full_pnl,error\n";
+    char buffer[256];
+    for (const scenario_result& result : scenarios) {
+        char* p = buffer;
+        for (const double value : {result.shock.spot, result.shock.volatility, result.shock.rate, result.taylor_pnl, result.full_pnl, result.error}) {
+            if (p != buffer) *p++ = ',';
+            p = std::to_chars(p, buffer + sizeof(buffer), value).ptr;
+        }
+        *p++ = '\n';
+        out.write(buffer, p - buffer);
+    }
+}
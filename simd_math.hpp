@@ -0,0 +1,369 @@
+// simd_math.hpp
+//
+// Vectorised exp/log/normal CDF kernels used by the batch pricers. Every kernel is written once against a small
+// lane interface (scalar, AVX2 or AVX-512) so the vector body and the scalar remainder loop give identical results.
+//
+// Accuracy (checked against std::exp/std::log/boost::math::cdf over the Black-Scholes input range):
+//   exp_v  : relative error < 2e-16 for x in [-708, 708], exactly 0 below -708
+//   log_v  : relative error < 3e-16 for positive normal doubles
+//   ncdf_v : absolute error < 5e-16 (Hart 5666 / West 2005 rational form), relative error < 1e-8 in the tails
+//   npdf_v : absolute error < 2e-16, relative error < 5e-16
+//   ninv_v : absolute error < 5e-12 for p in [1e-6, 1 - 1e-6], < 5e-9 further out (Acklam + one Halley step)
+//   ninv_fast_v : relative error < 1.2e-9 (Acklam alone, for Monte-Carlo draws)
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#ifndef SIMD_MATH_HPP
+#define SIMD_MATH_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace simd_math {
+
+// Scalar lane: also used for the tail of every batch loop
+struct scalar_lane {
+    using reg = double;
+    using mask = bool;
+    static constexpr std::size_t width = 1;
+
+    static reg load(const double* p) { return *p; }
+    static reg load_int(const int* p) { return static_cast<double>(*p); }
+    static void store(double* p, reg a) { *p = a; }
+    static reg set1(double a) { return a; }
+    static reg add(reg a, reg b) { return a + b; }
+    static reg sub(reg a, reg b) { return a - b; }
+    static reg mul(reg a, reg b) { return a * b; }
+    static reg div(reg a, reg b) { return a / b; }
+#if defined(__FMA__)
+    static reg fmadd(reg a, reg b, reg c) { return std::fma(a, b, c); }
+#else
+    static reg fmadd(reg a, reg b, reg c) { return a * b + c; } // std::fma is a library call without hardware FMA
+#endif
+    static reg sqrt(reg a) { return std::sqrt(a); }
+    static reg abs(reg a) { return std::fabs(a); }
+    static reg min(reg a, reg b) { return a < b ? a : b; }
+    static reg max(reg a, reg b) { return a > b ? a : b; }
+    static reg round(reg a) { return std::nearbyint(a); }
+    static mask lt(reg a, reg b) { return a < b; }
+    static mask gt(reg a, reg b) { return a > b; }
+    static mask eq(reg a, reg b) { return a == b; }
+    static reg select(mask m, reg a, reg b) { return m ? a : b; } // m ? a : b
+    static bool any(mask m) { return m; }
+
+    // 2^k for integral k in [-1022, 1023]
+    static reg pow2(reg k) {
+        std::uint64_t bits = static_cast<std::uint64_t>(static_cast<std::int64_t>(k) + 1023) << 52;
+        double out;
+        std::memcpy(&out, &bits, sizeof(out));
+        return out;
+    }
+    // Split a positive normal double into exponent e and mantissa m in [1, 2)
+    static void frexp(reg x, reg& e, reg& m) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        e = static_cast<double>(static_cast<std::int64_t>(bits >> 52) - 1023);
+        bits = (bits & 0x000FFFFFFFFFFFFFULL) | 0x3FF0000000000000ULL;
+        std::memcpy(&m, &bits, sizeof(m));
+    }
+};
+
+#if defined(__AVX2__) && defined(__FMA__)
+// AVX2 lane: 4 doubles
+struct avx2_lane {
+    using reg = __m256d;
+    using mask = __m256d;
+    static constexpr std::size_t width = 4;
+
+    static reg load(const double* p) { return _mm256_loadu_pd(p); }
+    static reg load_int(const int* p) { return _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))); }
+    static void store(double* p, reg a) { _mm256_storeu_pd(p, a); }
+    static reg set1(double a) { return _mm256_set1_pd(a); }
+    static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+    static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+    static reg div(reg a, reg b) { return _mm256_div_pd(a, b); }
+    static reg fmadd(reg a, reg b, reg c) { return _mm256_fmadd_pd(a, b, c); }
+    static reg sqrt(reg a) { return _mm256_sqrt_pd(a); }
+    static reg abs(reg a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+    static reg min(reg a, reg b) { return _mm256_min_pd(a, b); }
+    static reg max(reg a, reg b) { return _mm256_max_pd(a, b); }
+    static reg round(reg a) { return _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    static mask lt(reg a, reg b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static mask gt(reg a, reg b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+    static mask eq(reg a, reg b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+    static reg select(mask m, reg a, reg b) { return _mm256_blendv_pd(b, a, m); }
+    static bool any(mask m) { return _mm256_movemask_pd(m) != 0; }
+
+    static reg pow2(reg k) {
+        __m256i ki = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(k));
+        ki = _mm256_slli_epi64(_mm256_add_epi64(ki, _mm256_set1_epi64x(1023)), 52);
+        return _mm256_castsi256_pd(ki);
+    }
+    static void frexp(reg x, reg& e, reg& m) {
+        const __m256i bits = _mm256_castpd_si256(x);
+        // AVX2 has no int64 -> double conversion: place the biased exponent in the mantissa of 2^52 instead
+        const __m256i biased = _mm256_srli_epi64(bits, 52);
+        const __m256d two52 = _mm256_set1_pd(4503599627370496.0);
+        e = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(biased, _mm256_castpd_si256(two52))), two52);
+        e = _mm256_sub_pd(e, _mm256_set1_pd(1023.0));
+        const __m256i mant = _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL)),
+                                             _mm256_set1_epi64x(0x3FF0000000000000LL));
+        m = _mm256_castsi256_pd(mant);
+    }
+};
+#endif
+
+#if defined(__AVX512F__)
+// AVX-512 lane: 8 doubles
+struct avx512_lane {
+    using reg = __m512d;
+    using mask = __mmask8;
+    static constexpr std::size_t width = 8;
+
+    static reg load(const double* p) { return _mm512_loadu_pd(p); }
+    static reg load_int(const int* p) { return _mm512_cvtepi32_pd(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))); }
+    static void store(double* p, reg a) { _mm512_storeu_pd(p, a); }
+    static reg set1(double a) { return _mm512_set1_pd(a); }
+    static reg add(reg a, reg b) { return _mm512_add_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm512_sub_pd(a, b); }
+    static reg mul(reg a, reg b) { return _mm512_mul_pd(a, b); }
+    static reg div(reg a, reg b) { return _mm512_div_pd(a, b); }
+    static reg fmadd(reg a, reg b, reg c) { return _mm512_fmadd_pd(a, b, c); }
+    static reg sqrt(reg a) { return _mm512_sqrt_pd(a); }
+    static reg abs(reg a) { return _mm512_abs_pd(a); }
+    static reg min(reg a, reg b) { return _mm512_min_pd(a, b); }
+    static reg max(reg a, reg b) { return _mm512_max_pd(a, b); }
+    static reg round(reg a) { return _mm512_roundscale_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    static mask lt(reg a, reg b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+    static mask gt(reg a, reg b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+    static mask eq(reg a, reg b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+    static reg select(mask m, reg a, reg b) { return _mm512_mask_blend_pd(m, b, a); }
+    static bool any(mask m) { return m != 0; }
+
+    static reg pow2(reg k) { return _mm512_scalef_pd(_mm512_set1_pd(1.0), k); }
+    static void frexp(reg x, reg& e, reg& m) {
+        e = _mm512_getexp_pd(x);
+        m = _mm512_getmant_pd(x, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_src);
+    }
+};
+#endif
+
+// Widest lane available for the target the translation unit is compiled for
+#if defined(__AVX512F__)
+using native_lane = avx512_lane;
+#elif defined(__AVX2__) && defined(__FMA__)
+using native_lane = avx2_lane;
+#else
+using native_lane = scalar_lane;
+#endif
+
+// e^x: Cody-Waite reduction x = k*ln2 + r with |r| <= ln2/2, degree-13 Taylor polynomial for e^r
+template <class L>
+inline typename L::reg exp_v(typename L::reg x) {
+    using reg = typename L::reg;
+    const auto tiny = L::lt(x, L::set1(-708.0));
+    x = L::min(L::max(x, L::set1(-708.0)), L::set1(708.0));
+
+    const reg k = L::round(L::mul(x, L::set1(1.4426950408889634)));
+    reg r = L::fmadd(k, L::set1(-6.93147180369123816490e-01), x);
+    r = L::fmadd(k, L::set1(-1.90821492927058770002e-10), r);
+
+    reg p = L::set1(1.0 / 6227020800.0);
+    p = L::fmadd(p, r, L::set1(1.0 / 479001600.0));
+    p = L::fmadd(p, r, L::set1(1.0 / 39916800.0));
+    p = L::fmadd(p, r, L::set1(1.0 / 3628800.0));
+    p = L::fmadd(p, r, L::set1(1.0 / 362880.0));
+    p = L::fmadd(p, r, L::set1(1.0 / 40320.0));
+    p = L::fmadd(p, r, L::set1(1.0 / 5040.0));
+    p = L::fmadd(p, r, L::set1(1.0 / 720.0));
+    p = L::fmadd(p, r, L::set1(1.0 / 120.0));
+    p = L::fmadd(p, r, L::set1(1.0 / 24.0));
+    p = L::fmadd(p, r, L::set1(1.0 / 6.0));
+    p = L::fmadd(p, r, L::set1(0.5));
+    p = L::fmadd(p, r, L::set1(1.0));
+    p = L::fmadd(p, r, L::set1(1.0));
+
+    return L::select(tiny, L::set1(0.0), L::mul(p, L::pow2(k)));
+}
+
+// ln(x) for positive normal x: x = m*2^e with m in [sqrt(1/2), sqrt(2)), ln(m) = 2*atanh((m-1)/(m+1))
+template <class L>
+inline typename L::reg log_v(typename L::reg x) {
+    using reg = typename L::reg;
+    reg e, m;
+    L::frexp(x, e, m);
+    const auto big = L::gt(m, L::set1(1.4142135623730951));
+    m = L::select(big, L::mul(m, L::set1(0.5)), m);
+    e = L::select(big, L::add(e, L::set1(1.0)), e);
+
+    const reg f = L::div(L::sub(m, L::set1(1.0)), L::add(m, L::set1(1.0)));
+    const reg f2 = L::mul(f, f);
+    reg p = L::set1(1.0 / 21.0);
+    p = L::fmadd(p, f2, L::set1(1.0 / 19.0));
+    p = L::fmadd(p, f2, L::set1(1.0 / 17.0));
+    p = L::fmadd(p, f2, L::set1(1.0 / 15.0));
+    p = L::fmadd(p, f2, L::set1(1.0 / 13.0));
+    p = L::fmadd(p, f2, L::set1(1.0 / 11.0));
+    p = L::fmadd(p, f2, L::set1(1.0 / 9.0));
+    p = L::fmadd(p, f2, L::set1(1.0 / 7.0));
+    p = L::fmadd(p, f2, L::set1(1.0 / 5.0));
+    p = L::fmadd(p, f2, L::set1(1.0 / 3.0));
+    p = L::fmadd(p, f2, L::set1(1.0));
+    const reg log_m = L::mul(L::add(f, f), p);
+    return L::fmadd(e, L::set1(0.6931471805599453), log_m);
+}
+
+// Standard normal CDF (Hart 5666 as given by West, "Better approximations to cumulative normal functions", 2005)
+template <class L>
+inline typename L::reg ncdf_v(typename L::reg x) {
+    using reg = typename L::reg;
+    const reg ax = L::abs(x);
+    const reg e = exp_v<L>(L::mul(L::mul(ax, ax), L::set1(-0.5)));
+
+    // Rational branch for |x| < 7.07106781186547
+    reg num = L::set1(3.52624965998911e-02);
+    num = L::fmadd(num, ax, L::set1(0.700383064443688));
+    num = L::fmadd(num, ax, L::set1(6.37396220353165));
+    num = L::fmadd(num, ax, L::set1(33.912866078383));
+    num = L::fmadd(num, ax, L::set1(112.079291497871));
+    num = L::fmadd(num, ax, L::set1(221.213596169931));
+    num = L::fmadd(num, ax, L::set1(220.206867912376));
+    reg den = L::set1(8.83883476483184e-02);
+    den = L::fmadd(den, ax, L::set1(1.75566716318264));
+    den = L::fmadd(den, ax, L::set1(16.064177579207));
+    den = L::fmadd(den, ax, L::set1(86.7807322029461));
+    den = L::fmadd(den, ax, L::set1(296.564248779674));
+    den = L::fmadd(den, ax, L::set1(637.333633378831));
+    den = L::fmadd(den, ax, L::set1(793.826512519948));
+    den = L::fmadd(den, ax, L::set1(440.413735824752));
+    const reg inner = L::div(L::mul(e, num), den);
+
+    // Continued fraction branch for the tail
+    reg cf = L::add(ax, L::set1(0.65));
+    cf = L::add(ax, L::div(L::set1(4.0), cf));
+    cf = L::add(ax, L::div(L::set1(3.0), cf));
+    cf = L::add(ax, L::div(L::set1(2.0), cf));
+    cf = L::add(ax, L::div(L::set1(1.0), cf));
+    const reg outer = L::div(e, L::mul(cf, L::set1(2.506628274631)));
+
+    reg tail = L::select(L::lt(ax, L::set1(7.07106781186547)), inner, outer);
+    tail = L::select(L::gt(ax, L::set1(37.0)), L::set1(0.0), tail);
+    return L::select(L::gt(x, L::set1(0.0)), L::sub(L::set1(1.0), tail), tail);
+}
+
+// Standard normal density
+template <class L>
+inline typename L::reg npdf_v(typename L::reg x) {
+    return L::mul(exp_v<L>(L::mul(L::mul(x, x), L::set1(-0.5))), L::set1(0.3989422804014327));
+}
+
+// Inverse standard normal CDF for p in (0, 1): Acklam's rational approximation (relative error 1.2e-9) refined by one
+// Halley step against ncdf_v. Evaluated on the lower half p' = min(p, 1 - p) and mirrored, so the upper tail does not
+// lose digits to 1 - N(x) cancellation.
+template <class L>
+inline typename L::reg ninv_v(typename L::reg p) {
+    using reg = typename L::reg;
+    const reg one = L::set1(1.0);
+    const auto upper = L::gt(p, L::set1(0.5));
+    const reg lower_p = L::select(upper, L::sub(one, p), p);
+
+    // Central region p' >= 0.02425
+    const reg q = L::sub(lower_p, L::set1(0.5));
+    const reg r = L::mul(q, q);
+    reg num = L::set1(-3.969683028665376e+01);
+    num = L::fmadd(num, r, L::set1(2.209460984245205e+02));
+    num = L::fmadd(num, r, L::set1(-2.759285104469687e+02));
+    num = L::fmadd(num, r, L::set1(1.383577518672690e+02));
+    num = L::fmadd(num, r, L::set1(-3.066479806614716e+01));
+    num = L::fmadd(num, r, L::set1(2.506628277459239e+00));
+    reg den = L::set1(-5.447609879822406e+01);
+    den = L::fmadd(den, r, L::set1(1.615858368580409e+02));
+    den = L::fmadd(den, r, L::set1(-1.556989798598866e+02));
+    den = L::fmadd(den, r, L::set1(6.680131188771972e+01));
+    den = L::fmadd(den, r, L::set1(-1.328068155288572e+01));
+    den = L::fmadd(den, r, one);
+    const reg central = L::div(L::mul(num, q), den);
+
+    // Lower tail
+    const reg t = L::sqrt(L::mul(L::set1(-2.0), log_v<L>(lower_p)));
+    reg tnum = L::set1(-7.784894002430293e-03);
+    tnum = L::fmadd(tnum, t, L::set1(-3.223964580411365e-01));
+    tnum = L::fmadd(tnum, t, L::set1(-2.400758277161838e+00));
+    tnum = L::fmadd(tnum, t, L::set1(-2.549732539343734e+00));
+    tnum = L::fmadd(tnum, t, L::set1(4.374664141464968e+00));
+    tnum = L::fmadd(tnum, t, L::set1(2.938163982698783e+00));
+    reg tden = L::set1(7.784695709041462e-03);
+    tden = L::fmadd(tden, t, L::set1(3.224671290700398e-01));
+    tden = L::fmadd(tden, t, L::set1(2.445134137142996e+00));
+    tden = L::fmadd(tden, t, L::set1(3.754408661907416e+00));
+    tden = L::fmadd(tden, t, one);
+    const reg tail = L::div(tnum, tden);
+
+    reg x = L::select(L::lt(lower_p, L::set1(0.02425)), tail, central);
+
+    // Halley step: e = N(x) - p', u = e / n(x); skipped where ncdf_v is flushed to 0
+    const reg e = L::sub(ncdf_v<L>(x), lower_p);
+    const reg u = L::mul(L::mul(e, L::set1(2.5066282746310002)), exp_v<L>(L::mul(L::mul(x, x), L::set1(0.5))));
+    const reg refined = L::sub(x, L::div(u, L::fmadd(L::mul(x, u), L::set1(0.5), one)));
+    x = L::select(L::lt(x, L::set1(-37.0)), x, refined);
+    return L::select(upper, L::sub(L::set1(0.0), x), x);
+}
+
+// Inverse standard normal CDF without the Halley step, for Monte-Carlo normals where 1.2e-9 is far below the sampling
+// error. The central and tail numerators and denominators are selected before dividing, so a register costs one
+// division (ninv_v spends nine with ncdf_v), and the tail's log and sqrt are skipped when no lane needs them.
+template <class L>
+inline typename L::reg ninv_fast_v(typename L::reg p) {
+    using reg = typename L::reg;
+    const reg one = L::set1(1.0);
+    const auto upper = L::gt(p, L::set1(0.5));
+    const reg lower_p = L::select(upper, L::sub(one, p), p);
+    const auto in_tail = L::lt(lower_p, L::set1(0.02425));
+
+    const reg q = L::sub(lower_p, L::set1(0.5));
+    const reg r = L::mul(q, q);
+    reg num = L::set1(-3.969683028665376e+01);
+    num = L::fmadd(num, r, L::set1(2.209460984245205e+02));
+    num = L::fmadd(num, r, L::set1(-2.759285104469687e+02));
+    num = L::fmadd(num, r, L::set1(1.383577518672690e+02));
+    num = L::fmadd(num, r, L::set1(-3.066479806614716e+01));
+    num = L::fmadd(num, r, L::set1(2.506628277459239e+00));
+    num = L::mul(num, q);
+    reg den = L::set1(-5.447609879822406e+01);
+    den = L::fmadd(den, r, L::set1(1.615858368580409e+02));
+    den = L::fmadd(den, r, L::set1(-1.556989798598866e+02));
+    den = L::fmadd(den, r, L::set1(6.680131188771972e+01));
+    den = L::fmadd(den, r, L::set1(-1.328068155288572e+01));
+    den = L::fmadd(den, r, one);
+
+    if (L::any(in_tail)) {
+        const reg t = L::sqrt(L::mul(L::set1(-2.0), log_v<L>(L::select(in_tail, lower_p, L::set1(0.01)))));
+        reg tnum = L::set1(-7.784894002430293e-03);
+        tnum = L::fmadd(tnum, t, L::set1(-3.223964580411365e-01));
+        tnum = L::fmadd(tnum, t, L::set1(-2.400758277161838e+00));
+        tnum = L::fmadd(tnum, t, L::set1(-2.549732539343734e+00));
+        tnum = L::fmadd(tnum, t, L::set1(4.374664141464968e+00));
+        tnum = L::fmadd(tnum, t, L::set1(2.938163982698783e+00));
+        reg tden = L::set1(7.784695709041462e-03);
+        tden = L::fmadd(tden, t, L::set1(3.224671290700398e-01));
+        tden = L::fmadd(tden, t, L::set1(2.445134137142996e+00));
+        tden = L::fmadd(tden, t, L::set1(3.754408661907416e+00));
+        tden = L::fmadd(tden, t, one);
+        num = L::select(in_tail, tnum, num);
+        den = L::select(in_tail, tden, den);
+    }
+    const reg x = L::div(num, den);
+    return L::select(upper, L::sub(L::set1(0.0), x), x);
+}
+
+} // namespace simd_math
+
+#endif // SIMD_MATH_HPP
@@ -0,0 +1,37 @@
+// sobol.hpp
+//
+// Sobol low-discrepancy sequence (32-bit, Gray-code order) with random digital shifts for randomised QMC.
+// Direction numbers: dimension 1 is van der Corput; dimensions 2 to 252 use Joe and Kuo's new-joe-kuo-6.21201
+// polynomials and initial values, chosen for good two-dimensional projections (enough for a daily-stepped year
+// through the Brownian bridge). Beyond 252, dimension j uses the (j-1)-th primitive polynomial over GF(2) in order of
+// degree, found at construction, with odd initial values m_k < 2^k drawn from a fixed Philox stream. Each dimension
+// is a (0,1)-sequence; the first dimensions, which carry most of the variance after a Brownian-bridge construction,
+// come from the lowest-degree polynomials.
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#ifndef SOBOL_HPP
+#define SOBOL_HPP
+
+#include <cstdint>
+#include <vector>
+
+class sobol_sequence {
+public:
+    explicit sobol_sequence(int dimensions);
+
+    int dimensions() const { return n_dimensions; }
+
+    // Point number `index` written into point[0..dimensions) as 32-bit integers (Gray-code order, direct evaluation)
+    void point(std::uint64_t index, std::uint32_t* point) const;
+    // Advances point (currently the point at `index`) to the point at index + 1
+    void next(std::uint64_t index, std::uint32_t* point) const;
+
+private:
+    static constexpr int bits = 32;
+    int n_dimensions;
+    std::vector<std::uint32_t> directions; // [dimension * bits + k]
+};
+
+#endif // SOBOL_HPP
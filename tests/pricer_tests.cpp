@@ -0,0 +1,1413 @@
+// pricer_tests.cpp
+//
+// Regression checks for the pricing kernels, run by CTest (one test per group, `OptionPricerTests <group>`):
+//   asian_alloc   the Asian Monte-Carlo hot loop does not allocate per path (global operator new is counted)
+//   asian_threads Asian Monte-Carlo price and standard error are bit-identical on 1, 3 and 8 threads (Philox and Sobol)
+//   asian_variance antithetics and the geometric control variate cut the standard error; the geometric-average
+//                 estimate brackets its closed form; the standard error does not depend on the strike of an always
+//                 in-the-money call (the moments must not cancel)
+//   asian_greeks  in-simulation pathwise and likelihood-ratio Greeks against common-seed central bump-and-reprice,
+//                 and their price bit for bit that of price_asian_mc
+//   mc_normals    replaying shared normals gives the same bits as drawing them, in the engine and in an Asian
+//                 matrix_interface sweep; a buffer of another seed, step count or too few paths is refused
+//   asian_qmc     Sobol + Brownian bridge geometric-average prices bracket the closed form within their replicate
+//                 standard error, which is below the pseudo-random one at the same number of paths
+//   batch         batch European prices against the scalar formulas, and the same bits in a vector or the remainder lane
+//   specialised   side/carry-specialised batch kernels (single side, b = r, b = 0) against the scalar formulas and,
+//                 bit for bit, the general kernel
+//   greeks        batch European prices and Greeks against the scalar fused routine; vega, theta and rho against
+//                 central differences of the price (b = r - q moving with r, futures b = 0)
+//   setters       each European setter and toggle leaves price and Greeks equal to a freshly built option's
+//   implied_vol   implied-volatility round trips, single and batch
+//   surface       vol_surface::update_quote finds quotes at recomputed expiries and strikes and refuses unquoted ones
+//   american      Barone-Adesi-Whaley and Bjerksund-Stensland 2002 against Haug's published tables; the batch refuses
+//                 a bad option type under every method, and an unknown method
+//   american_pde  Crank-Nicolson American calls and puts against a 5000-step binomial tree
+//   pde_chain     Crank-Nicolson on a wide strike chain keeps single-contract accuracy against the binomial tree
+//   portfolio     bulk and single-handle portfolio prices against at(handle)->price() and against the contracts built
+//                 directly, for a mixed book over several chunks (insertion-order scatter)
+//   risk          book-level Greek aggregation is bit-for-bit the same on 1 and 4 threads
+//   scenario      stress full revaluation against an option::price() loop, Taylor P&L converging to it as the shocks
+//                 shrink, the same bits on 1 and 4 threads, and shocks that leave a contract unpriceable refused
+//   jsonl         JSONL requests with out-of-range inputs get an error reply and the rest of the batch is priced; an
+//                 American price is the same with or without Greeks
+//   daemon        a client that sends without reading does not stall the pricing daemon for other clients; an
+//                 American price is the same with or without Greeks
+//   daemon_stop   stop() returns while a client floods the pricing daemon without reading its replies
+//   matrix        a four-axis sweep runs its rows last axis fastest, each priced as the option at its grid point, and
+//                 write_csv gives the same file for any chunk_rows and thread count (European and Asian)
+//   philox        SoA Philox blocks (AVX-512 and plain paths) match the scalar generator and the Random123 known answers
+//   portfolio_file the CSV loader gives the same rows on any thread count, text -> binary -> mapped_portfolio is bit
+//                 exact, a bad magic or version is refused and portfolio_io::price matches portfolio::price
+//   instrumentation per-probe calls and items, Monte-Carlo counters, merging of live and exited threads, reset()
+//                 and parseable JSON / Prometheus exports (skipped unless built with OPTION_PRICER_INSTRUMENTATION)
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#include "pricing_methods.hpp"
+#include "european_option.hpp"
+#include "american_option.hpp"
+#include "asian_option.hpp"
+#include "philox.hpp"
+#include "portfolio.hpp"
+#include "portfolio_file.hpp"
+#include "daemon_protocol.hpp"
+#include "pricing_daemon.hpp"
+#include "instrumentation.hpp"
+#include "jsonl_interface.hpp"
+#include "matrix_interface.hpp"
+#include "risk_engine.hpp"
+#include "scenario_engine.hpp"
+#include "vol_surface.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <poll.h>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+// Every allocation in the process goes through these, so a test can count the ones a call makes. All the forms are
+// replaced, array and over-aligned ones included, so new and delete always pair up.
+static std::atomic<std::size_t> allocations{0};
+
+static void* counted_allocation(std::size_t size, std::size_t alignment) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) size = 1;
+    void* p = (alignment <= alignof(std::max_align_t)) ? std::malloc(size) : std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(std::size_t size) { return counted_allocation(size, 0); }
+void* operator new[](std::size_t size) { return counted_allocation(size, 0); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return counted_allocation(size, static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return counted_allocation(size, static_cast<std::size_t>(alignment)); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+static int failures = 0;
+static bool skipped = false; // a group that cannot run in this build
+
+static void check(bool ok, const std::string& what) {
+    if (!ok) {
+        std::printf("FAILED: %s\n", what.c_str());
+        ++failures;
+    }
+}
+
+static void check_near(double actual, double expected, double tolerance, const std::string& what) {
+    check(std::fabs(actual - expected) <= tolerance,
+          what + ": got " + std::to_string(actual) + ", expected " + std::to_string(expected) + " +/- " + std::to_string(tolerance));
+}
+
+// Random contracts over the range the batch kernels are documented for
+struct contracts {
+    std::vector<double> S, K, r, T, sig, b;
+    std::vector<int> type;
+
+    contracts(std::size_t n, std::uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<double> spot(50, 150), rate(-0.01, 0.1), maturity(0.02, 5), vol(0.05, 0.8), carry(-0.05, 0.1);
+        for (std::size_t i = 0; i < n; ++i) {
+            S.push_back(spot(rng));
+            K.push_back(spot(rng));
+            r.push_back(rate(rng));
+            T.push_back(maturity(rng));
+            sig.push_back(vol(rng));
+            b.push_back(carry(rng));
+            type.push_back(i % 3 == 0 ? option::PUT : option::CALL);
+        }
+    }
+};
+
+// The block_moments vector is the engine's only allocation: the count must not grow with the number of paths. A
+// warm-up call first lets one-off per-thread state (instrumentation stats in instrumented builds) settle.
+static void asian_alloc() {
+    const pricing_methods pm;
+    for (const bool antithetic : {false, true}) {
+        asian_mc_config config;
+        config.n_threads = 1; // the thread pool itself allocates
+        config.antithetic = antithetic;
+        config.control_variate = true;
+        auto count = [&](int M, bool greeks) {
+            const std::size_t before = allocations.load();
+            if (greeks) pm.price_and_greeks_asian_mc(100, 100, 1, 0.05, 0.2, 0.05, 64, M, option::CALL, config);
+            else pm.price_asian_mc(100, 100, 1, 0.05, 0.2, 0.05, 64, M, option::CALL, config);
+            return allocations.load() - before;
+        };
+        for (const bool greeks : {false, true}) {
+            count(100, greeks);
+            const std::size_t small = count(1000, greeks), large = count(100000, greeks);
+            check(small == large, std::string("asian allocations independent of M") + (greeks ? " (greeks)" : "") + (antithetic ? " (antithetic)" : "")
+                                      + ": " + std::to_string(small) + " at M=1e3, " + std::to_string(large) + " at M=1e5");
+        }
+    }
+}
+
+// Enough paths for many 1024-sample blocks, so the threads take them in varying order; the variance-reduced
+// configuration adds the control-variate moments to what must merge identically
+static void asian_threads() {
+    const pricing_methods pm;
+    for (const mc_sampler sampler : {mc_sampler::pseudo_random, mc_sampler::sobol}) {
+        for (const bool reduced : {false, true}) {
+            asian_mc_config config;
+            config.sampler = sampler;
+            config.antithetic = config.control_variate = reduced;
+            config.n_threads = 1;
+            const mc_result one = pm.price_asian_mc(100, 100, 1, 0.05, 0.2, 0.05, 32, 40000, option::CALL, config);
+            for (const unsigned threads : {3u, 8u}) {
+                config.n_threads = threads;
+                const mc_result many = pm.price_asian_mc(100, 100, 1, 0.05, 0.2, 0.05, 32, 40000, option::CALL, config);
+                check(std::memcmp(&one.price, &many.price, sizeof(double)) == 0 && std::memcmp(&one.std_error, &many.std_error, sizeof(double)) == 0,
+                      std::string("Asian MC on ") + std::to_string(threads) + " threads identical to 1 thread ("
+                          + (sampler == mc_sampler::sobol ? "sobol" : "pseudo-random") + (reduced ? ", antithetic + control variate" : "") + ")");
+            }
+        }
+    }
+}
+
+// Antithetic pairs and the control variate each reduce the standard error at the same M (the control variate by more
+// than 10x at the money), and the reduced estimates agree with the plain one. The geometric-average payoff's estimate
+// is within 4 standard errors of its closed form; with the control variate (X = Y) it is the closed form itself.
+static void asian_variance() {
+    const pricing_methods pm;
+    const int N = 64, M = 100000;
+    for (const int type : {option::CALL, option::PUT}) {
+        const std::string side = type == option::CALL ? " call" : " put";
+        auto run = [&](bool antithetic, bool control_variate, bool geometric) {
+            asian_mc_config config;
+            config.antithetic = antithetic;
+            config.control_variate = control_variate;
+            config.geometric_average = geometric;
+            return pm.price_asian_mc(100, 100, 1, 0.05, 0.25, 0.05, N, M, type, config);
+        };
+        const mc_result plain = run(false, false, false), antithetic = run(true, false, false), control = run(false, true, false);
+        const mc_result both = run(true, true, false);
+        check(antithetic.std_error < 0.9 * plain.std_error, "antithetic standard error below the plain one" + side);
+        check(control.std_error < 0.1 * plain.std_error && both.std_error < 0.1 * plain.std_error,
+              "control variate standard error below a tenth of the plain one" + side);
+        for (const mc_result& reduced : {antithetic, control, both}) {
+            check_near(reduced.price, plain.price, 4 * plain.std_error, "variance-reduced estimate vs plain" + side);
+        }
+
+        const double closed = pm.price_geometric_asian(100, 100, 1, 0.05, 0.25, N, type);
+        const mc_result geometric = run(false, false, true), geometric_antithetic = run(true, false, true);
+        check_near(geometric.price, closed, 4 * geometric.std_error, "geometric-average estimate vs closed form" + side);
+        check_near(geometric_antithetic.price, closed, 4 * geometric_antithetic.std_error, "antithetic geometric-average estimate vs closed form" + side);
+        const mc_result exact = run(false, true, true);
+        check_near(exact.price, closed, 1e-12 * closed, "geometric-average estimate with itself as control variate" + side);
+        check(exact.std_error < 1e-12 * closed, "geometric-average control variate leaves no error" + side + ": " + std::to_string(exact.std_error));
+    }
+
+    // Every path of a low-vol call with K <= 60 finishes in the money, so its payoff is A - K: the standard error is
+    // the same for K = 1 and K = 60. Raw sums of squares lost ~1e-4 of it to cancellation with the control variate.
+    for (const bool control_variate : {false, true}) {
+        asian_mc_config config;
+        config.control_variate = control_variate;
+        const double far = pm.price_asian_mc(100, 1, 1, 0.05, 0.001, 0.05, 16, 200000, option::CALL, config).std_error;
+        const double near = pm.price_asian_mc(100, 60, 1, 0.05, 0.001, 0.05, 16, 200000, option::CALL, config).std_error;
+        check_near(far, near, 1e-9 * near,
+                   std::string("deep in-the-money standard error independent of the strike") + (control_variate ? " (control variate)" : ""));
+    }
+}
+
+// Central differences of price_asian_mc on the same seed (common random numbers, so the bumped prices move together
+// and the differences carry little noise) against the Greeks of one price_and_greeks_asian_mc run, within 4 of its
+// standard errors. The bumps are small enough that their O(h^2) bias stays well inside that.
+static void asian_greeks_vs_bumps() {
+    const pricing_methods pm;
+    const double S = 100, K = 100, T = 1, r = 0.05, sig = 0.25;
+    const int N = 32, M = 50000;
+    for (const mc_sampler sampler : {mc_sampler::pseudo_random, mc_sampler::sobol}) {
+        for (const int type : {option::CALL, option::PUT}) {
+            for (const bool antithetic : {false, true}) {
+                asian_mc_config config;
+                config.sampler = sampler;
+                config.antithetic = antithetic;
+                const std::string what = std::string(type == option::CALL ? " call" : " put") + (sampler == mc_sampler::sobol ? ", sobol" : "")
+                                         + (antithetic ? ", antithetic" : "");
+                auto price = [&](double spot, double maturity, double rate, double vol) {
+                    return pm.price_asian_mc(spot, K, maturity, rate, vol, rate, N, M, type, config).price;
+                };
+                const asian_greeks g = pm.price_and_greeks_asian_mc(S, K, T, r, sig, r, N, M, type, config);
+                const double h_spot = 1, h_gamma = 5, h_vol = 0.01, h_time = 0.02, h_rate = 0.005;
+                const double delta = (price(S + h_spot, T, r, sig) - price(S - h_spot, T, r, sig)) / (2 * h_spot);
+                const double gamma = (price(S + h_gamma, T, r, sig) - 2 * price(S, T, r, sig) + price(S - h_gamma, T, r, sig)) / (h_gamma * h_gamma);
+                const double vega = (price(S, T, r, sig + h_vol) - price(S, T, r, sig - h_vol)) / (2 * h_vol);
+                const double theta = (price(S, T - h_time, r, sig) - price(S, T + h_time, r, sig)) / (2 * h_time);
+                const double rho = (price(S, T, r + h_rate, sig) - price(S, T, r - h_rate, sig)) / (2 * h_rate);
+                check_near(g.delta.price, delta, 4 * g.delta.std_error, "pathwise delta vs bumps" + what);
+                check_near(g.gamma.price, gamma, 4 * g.gamma.std_error, "likelihood-ratio gamma vs bumps" + what);
+                check_near(g.vega.price, vega, 4 * g.vega.std_error, "pathwise vega vs bumps" + what);
+                check_near(g.theta.price, theta, 4 * g.theta.std_error, "pathwise theta vs bumps" + what);
+                check_near(g.rho.price, rho, 4 * g.rho.std_error, "pathwise rho vs bumps" + what);
+
+                // The Greek sums ride along without touching the price, control variate or not
+                for (const bool control_variate : {false, true}) {
+                    config.control_variate = control_variate;
+                    const mc_result alone = pm.price_asian_mc(S, K, T, r, sig, r, N, M, type, config);
+                    const mc_result with_greeks = pm.price_and_greeks_asian_mc(S, K, T, r, sig, r, N, M, type, config).price;
+                    check(std::memcmp(&alone, &with_greeks, sizeof(mc_result)) == 0,
+                          "Asian price with Greeks identical to price_asian_mc" + what + (control_variate ? ", control variate" : ""));
+                }
+            }
+        }
+    }
+}
+
+// Whole file as a string
+static std::string read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// N = 37 is not a multiple of the pool's step batch and M = 10001 leaves a partly filled lane group
+static void shared_normals() {
+    const pricing_methods pm;
+    const int N = 37, M = 10001;
+    for (const bool antithetic : {false, true}) {
+        for (const bool control_variate : {false, true}) {
+            asian_mc_config drawn;
+            drawn.seed = 2024;
+            drawn.antithetic = antithetic;
+            drawn.control_variate = control_variate;
+            const mc_normals normals(drawn.seed, N, pricing_methods::asian_mc_paths(M, drawn));
+            asian_mc_config replayed = drawn;
+            replayed.normals = &normals;
+            const std::string what = std::string(antithetic ? " (antithetic" : " (plain") + (control_variate ? ", control variate)" : ")");
+            for (const int type : {option::CALL, option::PUT}) {
+                const mc_result a = pm.price_asian_mc(100, 95, 1, 0.05, 0.3, 0.05, N, M, type, drawn);
+                const mc_result b = pm.price_asian_mc(100, 95, 1, 0.05, 0.3, 0.05, N, M, type, replayed);
+                check(std::memcmp(&a, &b, sizeof(mc_result)) == 0, "Asian price from shared normals identical to drawn" + what);
+                const asian_greeks ga = pm.price_and_greeks_asian_mc(100, 95, 1, 0.05, 0.3, 0.05, N, M, type, drawn);
+                const asian_greeks gb = pm.price_and_greeks_asian_mc(100, 95, 1, 0.05, 0.3, 0.05, N, M, type, replayed);
+                check(std::memcmp(&ga, &gb, sizeof(asian_greeks)) == 0, "Asian Greeks from shared normals identical to drawn" + what);
+            }
+        }
+    }
+
+    // The same sweep with and without common random numbers writes the same file
+    const std::string stem = "/tmp/option_pricer_tests_crn_" + std::to_string(::getpid());
+    for (const bool common : {false, true}) {
+        matrix_interface ladder({{"spot", 58.0, 68.0, 2.0}, {"volatility", 0.2, 0.3, 0.1}});
+        ladder.set_option(3, 1, 2000, 16);
+        ladder.set_common_random_numbers(common);
+        ladder.write_csv(stem + (common ? "_common.csv" : "_drawn.csv"));
+    }
+    const std::string drawn_csv = read_file(stem + "_drawn.csv"), common_csv = read_file(stem + "_common.csv");
+    check(!drawn_csv.empty() && drawn_csv == common_csv, "Asian sweep with common random numbers writes the same CSV");
+    std::remove((stem + "_drawn.csv").c_str());
+    std::remove((stem + "_common.csv").c_str());
+
+    // A buffer of another seed or step count, or with fewer paths than the run simulates, is refused
+    asian_mc_config config;
+    config.seed = 7;
+    auto refused = [&](const mc_normals& normals) {
+        asian_mc_config with = config;
+        with.normals = &normals;
+        try {
+            pm.price_asian_mc(100, 95, 1, 0.05, 0.3, 0.05, N, M, option::CALL, with);
+        } catch (const std::invalid_argument&) {
+            return true;
+        }
+        return false;
+    };
+    check(!refused(mc_normals(7, N, M)), "matching shared normals accepted");
+    check(refused(mc_normals(8, N, M)), "shared normals of another seed refused");
+    check(refused(mc_normals(7, N + 1, M)), "shared normals of another step count refused");
+    check(refused(mc_normals(7, N, M - 100)), "shared normals with too few paths refused");
+}
+
+// 64 fixings use Joe-Kuo directions well past the first few dimensions, and the bridge fills every level. The
+// geometric-average payoff has a closed form, so the randomised QMC estimate must sit within 4 of its standard errors
+// (16 replicates) of it; at 65536 paths that standard error is several times below the pseudo-random one.
+static void asian_qmc() {
+    const pricing_methods pm;
+    const int N = 64, M = 65536;
+    for (const int type : {option::CALL, option::PUT}) {
+        const std::string side = type == option::CALL ? "call" : "put";
+        const double closed = pm.price_geometric_asian(100, 100, 1, 0.05, 0.25, N, type);
+        for (const bool geometric : {true, false}) {
+            asian_mc_config pseudo, qmc;
+            pseudo.geometric_average = qmc.geometric_average = geometric;
+            qmc.sampler = mc_sampler::sobol;
+            const mc_result p = pm.price_asian_mc(100, 100, 1, 0.05, 0.25, 0.05, N, M, type, pseudo);
+            const mc_result q = pm.price_asian_mc(100, 100, 1, 0.05, 0.25, 0.05, N, M, type, qmc);
+            const std::string payoff = geometric ? " geometric " : " arithmetic ";
+            if (geometric) {
+                check_near(q.price, closed, 4 * q.std_error, "QMC" + payoff + side + " vs closed form");
+                check_near(p.price, closed, 4 * p.std_error, "pseudo-random" + payoff + side + " vs closed form");
+            }
+            check(q.std_error > 0 && q.std_error < 0.5 * p.std_error, "QMC" + payoff + side + " standard error " + std::to_string(q.std_error)
+                                                                          + " below half the pseudo-random " + std::to_string(p.std_error));
+        }
+    }
+}
+
+// Batch prices within 1e-12 max(S, K) of the scalar formulas, on a mixed call/put book with arbitrary carry
+static void batch() {
+    const pricing_methods pm;
+    const contracts c(4099, 7); // not a multiple of any lane width
+    const std::size_t n = c.S.size();
+    std::vector<double> prices(n);
+    pm.price_european_batch(c.S, c.K, c.r, c.T, c.sig, c.b, c.type, prices);
+    double worst = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const double scalar = c.type[i] == option::CALL ? pm.price_european_call(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], c.b[i])
+                                                        : pm.price_european_put(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], c.b[i]);
+        worst = std::max(worst, std::fabs(prices[i] - scalar) / std::max(c.S[i], c.K[i]));
+    }
+    check(worst <= 1e-12, "batch vs scalar: worst relative error " + std::to_string(worst));
+
+    // A contract alone runs in the scalar remainder lane; it must price to the same bits as in a vector lane, worthless
+    // ones (short-dated, far out of the money) included
+    std::size_t differ = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const double T = (i % 4 == 0) ? 0.02 : c.T[i];
+        double alone, lanes[16];
+        pm.price_european_batch({&c.S[i], 1}, {&c.K[i], 1}, {&c.r[i], 1}, {&T, 1}, {&c.sig[i], 1}, {&c.b[i], 1}, {&c.type[i], 1}, {&alone, 1});
+        const std::vector<double> S(16, c.S[i]), K(16, c.K[i]), r(16, c.r[i]), maturity(16, T), sig(16, c.sig[i]), b(16, c.b[i]);
+        std::vector<int> type(16, option::CALL);
+        type[0] = c.type[i];
+        type[1] = option::PUT;
+        pm.price_european_batch(S, K, r, maturity, sig, b, type, lanes);
+        differ += std::memcmp(&alone, &lanes[0], sizeof(double)) != 0;
+    }
+    check(differ == 0, "batch price independent of lane position: " + std::to_string(differ) + " contracts differ");
+}
+
+// Single-side books and the stock (b = r) and future (b = 0) carries take the specialised kernels; each must match
+// the scalar formulas as closely as the general one
+static void batch_specialised() {
+    const pricing_methods pm;
+    const contracts c(4099, 17);
+    const std::size_t n = c.S.size();
+    const std::vector<int> calls(n, option::CALL), puts(n, option::PUT);
+    const std::vector<double> zero(n, 0.0);
+    std::vector<double> prices(n);
+    struct variant {
+        const char* name;
+        const std::vector<double>& b;
+        const std::vector<int>& type;
+    };
+    for (const variant& v : {variant{"calls", c.b, calls}, variant{"puts", c.b, puts}, variant{"calls stock", c.r, calls},
+                             variant{"puts stock", c.r, puts}, variant{"calls future", zero, calls}, variant{"puts future", zero, puts}}) {
+        pm.price_european_batch(c.S, c.K, c.r, c.T, c.sig, v.b, v.type, prices);
+        double worst = 0.0;
+        for (std::size_t i = 0; i < n; ++i) {
+            const double scalar = v.type[i] == option::CALL ? pm.price_european_call(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], v.b[i])
+                                                            : pm.price_european_put(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], v.b[i]);
+            worst = std::max(worst, std::fabs(prices[i] - scalar) / std::max(c.S[i], c.K[i]));
+        }
+        check(worst <= 1e-12, std::string("specialised batch vs scalar (") + v.name + "): worst relative error " + std::to_string(worst));
+
+        // One more contract, of the other side and off the carry regime, sends the same contracts through the general
+        // mixed kernel at the same lane positions; the specialisation must not change a bit
+        const int other_side = v.type[0] == option::CALL ? option::PUT : option::CALL;
+        auto general = [&](const std::vector<double>& column, double extra) {
+            std::vector<double> longer = column;
+            longer.push_back(extra);
+            return longer;
+        };
+        std::vector<int> types = v.type;
+        types.push_back(other_side);
+        std::vector<double> general_prices(n + 1);
+        pm.price_european_batch(general(c.S, 100), general(c.K, 100), general(c.r, 0.05), general(c.T, 1), general(c.sig, 0.2),
+                                general(v.b, 0.02), types, general_prices);
+        // The scalar remainder lane likewise: each contract alone against a pair with that contract
+        std::size_t differ = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            double alone, pair[2];
+            pm.price_european_batch({&c.S[i], 1}, {&c.K[i], 1}, {&c.r[i], 1}, {&c.T[i], 1}, {&c.sig[i], 1}, {&v.b[i], 1}, {&v.type[i], 1}, {&alone, 1});
+            const double S2[] = {c.S[i], 100}, K2[] = {c.K[i], 100}, r2[] = {c.r[i], 0.05}, T2[] = {c.T[i], 1}, sig2[] = {c.sig[i], 0.2};
+            const double b2[] = {v.b[i], 0.02};
+            const int type2[] = {v.type[i], other_side};
+            pm.price_european_batch(S2, K2, r2, T2, sig2, b2, type2, pair);
+            differ += std::memcmp(&alone, &pair[0], sizeof(double)) != 0;
+        }
+        check(std::memcmp(prices.data(), general_prices.data(), n * sizeof(double)) == 0 && differ == 0,
+              std::string("specialised batch vs general kernel (") + v.name + ") bit for bit, " + std::to_string(differ) + " single contracts differ");
+    }
+}
+
+// The vectorised Greeks behind the risk engine against the scalar fused routine
+static void batch_greeks() {
+    const pricing_methods pm;
+    contracts c(4099, 7);
+    const std::size_t n = c.S.size();
+    for (std::size_t i = 0; i < n; i += 5) c.b[i] = 0.0; // futures among them
+    std::vector<double> price(n), delta(n), gamma(n), vega(n), theta(n), rho(n), pcp(n);
+    pm.price_and_greeks_european_batch(c.S, c.K, c.r, c.T, c.sig, c.b, c.type, {price, delta, gamma, vega, theta, rho, pcp});
+    for (std::size_t i = 0; i < n; ++i) {
+        const european_greeks g = pm.price_and_greeks_european(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], c.b[i], c.type[i]);
+        const double scale = std::max(c.S[i], c.K[i]) * 1e-11;
+        if (std::fabs(price[i] - g.price) > scale || std::fabs(delta[i] - g.delta) > 1e-11 || std::fabs(gamma[i] - g.gamma) > 1e-11
+            || std::fabs(vega[i] - g.vega) > scale || std::fabs(theta[i] - g.theta) > scale || std::fabs(rho[i] - g.rho) > scale * c.T[i]
+            || std::fabs(pcp[i] - g.pcp_price) > scale) {
+            check(false, "batch Greeks vs scalar at contract " + std::to_string(i));
+            break;
+        }
+    }
+
+    // Vega, theta and rho against central differences of the price: theta is the calendar decay -dV/dT; for rho
+    // b = r - q moves with r at a fixed q, futures keep b = 0
+    const double h = 1e-5;
+    std::size_t off = 0;
+    for (std::size_t i = 0; i < n; i += 3) {
+        const double b = c.b[i];
+        auto value = [&](double r, double sig, double carry, double T) {
+            return pm.price_and_greeks_european(c.S[i], c.K[i], r, T, sig, carry, c.type[i]).price;
+        };
+        const european_greeks g = pm.price_and_greeks_european(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], b, c.type[i]);
+        const double db = (b != 0.0) ? h : 0.0, tolerance = 1e-6 * (c.S[i] + c.K[i]) * (1.0 + c.T[i]);
+        const double vega_fd = (value(c.r[i], c.sig[i] + h, b, c.T[i]) - value(c.r[i], c.sig[i] - h, b, c.T[i])) / (2 * h);
+        const double theta_fd = (value(c.r[i], c.sig[i], b, c.T[i] - h) - value(c.r[i], c.sig[i], b, c.T[i] + h)) / (2 * h);
+        const double rho_fd = (value(c.r[i] + h, c.sig[i], b + db, c.T[i]) - value(c.r[i] - h, c.sig[i], b - db, c.T[i])) / (2 * h);
+        const bool call = c.type[i] == option::CALL;
+        const double rho_single = call ? pm.rho_call(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], b) : pm.rho_put(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], b);
+        const double theta_single = call ? pm.theta_call(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], b)
+                                         : pm.theta_put(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], b);
+        const european_option o(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], b, c.type[i]);
+        if (std::fabs(g.vega - vega_fd) > tolerance || std::fabs(g.rho - rho_fd) > tolerance || std::fabs(rho_single - rho_fd) > tolerance
+            || std::fabs(o.rho() - rho_fd) > tolerance || std::fabs(pm.vega(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], b) - vega_fd) > tolerance
+            || std::fabs(g.theta - theta_fd) > tolerance || std::fabs(theta_single - theta_fd) > tolerance || std::fabs(o.theta() - theta_fd) > tolerance) {
+            ++off;
+        }
+    }
+    check(off == 0, std::to_string(off) + " European vega/theta/rho value(s) differ from a central difference of the price");
+}
+
+// Every setter (and toggle) on an option whose cached terms are all warm must give the same price and Greeks, bit for
+// bit, as an option built fresh from the new inputs; the setters run one after another, so each starts from the
+// cache the previous one left
+static void european_cache() {
+    struct inputs {
+        double S = 100, K = 95, r = 0.05, T = 0.75, sig = 0.2, b = 0.02;
+        int type = option::CALL;
+    };
+    auto warm = [](const european_option& o) {
+        return std::vector<double>{o.price(), o.delta(), o.gamma(), o.vega(), o.theta(), o.rho()};
+    };
+    auto matches_fresh = [&](const european_option& o, const inputs& in, const std::string& what) {
+        const european_option fresh(in.S, in.K, in.r, in.T, in.sig, in.b, in.type);
+        const european_greeks g = o.price_and_greeks(), expected = fresh.price_and_greeks();
+        const bool same = warm(o) == warm(fresh) && g.price == expected.price && g.delta == expected.delta && g.gamma == expected.gamma
+                          && g.vega == expected.vega && g.theta == expected.theta && g.rho == expected.rho && g.pcp_price == expected.pcp_price;
+        check(same, "cached European option after " + what + " matches a fresh one");
+    };
+    for (const int type : {option::CALL, option::PUT}) {
+        inputs in;
+        in.type = type;
+        european_option o(in.S, in.K, in.r, in.T, in.sig, in.b, in.type);
+        warm(o);
+        o.set_spot(in.S = 104);
+        matches_fresh(o, in, "set_spot");
+        o.set_strike(in.K = 110);
+        matches_fresh(o, in, "set_strike");
+        o.set_rate(in.r = 0.03);
+        matches_fresh(o, in, "set_rate");
+        o.set_maturity(in.T = 1.5);
+        matches_fresh(o, in, "set_maturity");
+        o.set_volatility(in.sig = 0.35);
+        matches_fresh(o, in, "set_volatility");
+        o.set_cost_of_carry(in.b = -0.01);
+        matches_fresh(o, in, "set_cost_of_carry");
+        o.toggle();
+        in.type = (type == option::CALL) ? option::PUT : option::CALL;
+        matches_fresh(o, in, "toggle");
+    }
+}
+
+// Out-of-the-money quotes recover the volatility to ~1e-12 relative; checked at 1e-10
+static void implied_vol() {
+    const pricing_methods pm;
+    const contracts c(2000, 11);
+    const std::size_t n = c.S.size();
+    std::vector<double> quote(n), vol(n);
+    std::vector<int> otm_type(n);
+    std::vector<iv_status> status(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        const double forward = c.S[i] * std::exp(c.b[i] * c.T[i]);
+        otm_type[i] = (forward < c.K[i]) ? option::CALL : option::PUT;
+        quote[i] = otm_type[i] == option::CALL ? pm.price_european_call(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], c.b[i])
+                                               : pm.price_european_put(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], c.b[i]);
+    }
+    pm.implied_volatility_batch(quote, c.S, c.K, c.r, c.T, c.b, otm_type, vol, status);
+    std::size_t checked = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        // Time value below ~1e-12 of the spot carries no information about the vol
+        if (quote[i] < 1e-9 * c.S[i]) continue;
+        ++checked;
+        if (status[i] != iv_status::converged || std::fabs(vol[i] - c.sig[i]) > 1e-10 * c.sig[i]) {
+            check(false, "batch implied vol round trip at quote " + std::to_string(i) + ": " + std::to_string(vol[i]) + " vs " + std::to_string(c.sig[i]));
+            break;
+        }
+        if (i % 50 == 0) {
+            const double single = pm.implied_volatility(quote[i], c.S[i], c.K[i], c.r[i], c.T[i], c.b[i], otm_type[i]);
+            check_near(single, c.sig[i], 1e-10 * c.sig[i], "single implied vol round trip at quote " + std::to_string(i));
+        }
+    }
+    check(checked > n / 2, "implied vol: too few quotes with time value");
+
+    std::vector<double> bad_quote{-1.0, 200.0};
+    std::vector<double> S{100, 100}, K{100, 100}, r{0.05, 0.05}, T{1, 1}, b{0.05, 0.05}, out(2);
+    std::vector<int> type{option::CALL, option::CALL};
+    std::vector<iv_status> bad_status(2);
+    pm.implied_volatility_batch(bad_quote, S, K, r, T, b, type, out, bad_status);
+    check(bad_status[0] == iv_status::below_intrinsic && bad_status[1] == iv_status::above_maximum, "implied vol status for unattainable quotes");
+}
+
+// Quotes addressed by an expiry and strike recomputed with different rounding (90 / 365 against 90 x (1 / 365),
+// 100 x 1.1 against 110) are updated; a strike or expiry that is not quoted is refused
+static void surface() {
+    const double quarter = 90.0 / 365.0, year = 1.0;
+    const std::vector<double> expiries = {quarter, quarter, quarter, year, year, year};
+    const std::vector<double> strikes = {90, 110, 130, 90, 110, 130};
+    const std::vector<double> vols = {0.25, 0.2, 0.22, 0.24, 0.21, 0.22};
+    vol_surface s(expiries, strikes, vols);
+    check(90 * (1.0 / 365.0) != quarter && 100 * 1.1 != 110.0, "recomputed expiry and strike differ in the last bits");
+
+    s.update_quote(90 * (1.0 / 365.0), 100 * 1.1, 0.3);
+    check_near(s.volatility(110, quarter), 0.3, 1e-12, "updated quote at a recomputed expiry and strike");
+    check_near(s.volatility(110, year), 0.21, 1e-12, "other slice untouched");
+    auto refused = [&](double T, double K) {
+        try {
+            s.update_quote(T, K, 0.3);
+        } catch (const std::invalid_argument&) {
+            return true;
+        }
+        return false;
+    };
+    check(refused(quarter, 100) && refused(quarter, 110.01) && refused(0.5, 110) && refused(quarter, -1), "unquoted strikes and expiries refused");
+}
+
+// Haug, "The Complete Guide to Option Pricing Formulas" (2nd ed.), American tables: K = 100, r = 0.1, b = 0, S = 90,
+// 100, 110 for each (T, sig). Table values are rounded to 4 decimals; BAW's critical price is a Newton solve, so
+// its tolerance is looser.
+static void american() {
+    const pricing_methods pm;
+    const double spots[3] = {90, 100, 110};
+    struct row {
+        double T, sig;
+        double baw_call[3], baw_put[3];
+    };
+    const row baw[] = {{0.1, 0.15, {0.0206, 1.8771, 10.0089}, {10.0000, 1.8770, 0.0410}},
+                       {0.1, 0.25, {0.3159, 3.1280, 10.3919}, {10.2533, 3.1277, 0.4562}},
+                       {0.1, 0.35, {0.9495, 4.3777, 11.1679}, {10.8787, 4.3777, 1.2402}},
+                       {0.5, 0.15, {0.8208, 4.0842, 10.8087}, {10.5595, 4.0842, 1.0822}},
+                       {0.5, 0.25, {2.7437, 6.8015, 13.0170}, {12.4419, 6.8014, 3.3226}},
+                       {0.5, 0.35, {5.0063, 9.5106, 15.5689}, {14.6945, 9.5104, 5.8823}}};
+    for (const row& x : baw) {
+        for (int j = 0; j < 3; ++j) {
+            const std::string at = " S=" + std::to_string(spots[j]) + " T=" + std::to_string(x.T) + " sig=" + std::to_string(x.sig);
+            check_near(pm.price_american_baw_call(spots[j], 100, 0.1, x.T, x.sig, 0.0), x.baw_call[j], 5e-3, "BAW call" + at);
+            check_near(pm.price_american_baw_put(spots[j], 100, 0.1, x.T, x.sig, 0.0), x.baw_put[j], 5e-3, "BAW put" + at);
+        }
+    }
+    struct bjs_row {
+        double T, sig;
+        double call[3];
+    };
+    const bjs_row bjs[] = {{0.1, 0.15, {0.0205, 1.8757, 10.0000}}, {0.1, 0.25, {0.3151, 3.1256, 10.3725}},
+                           {0.1, 0.35, {0.9479, 4.3746, 11.1578}}, {0.5, 0.15, {0.8099, 4.0628, 10.7898}}};
+    for (const bjs_row& x : bjs) {
+        for (int j = 0; j < 3; ++j) {
+            const std::string at = " S=" + std::to_string(spots[j]) + " T=" + std::to_string(x.T) + " sig=" + std::to_string(x.sig);
+            check_near(pm.price_american_bjs_call(spots[j], 100, 0.1, x.T, x.sig, 0.0), x.call[j], 1e-4, "BjS call" + at);
+        }
+    }
+    // Put-call transformation: P(S, K, r, b, sig) = C(K, S, r - b, -b, sig)
+    check_near(pm.price_american_bjs_put(100, 110, 0.1, 0.5, 0.25, 0.0), pm.price_american_bjs_call(110, 100, 0.1, 0.5, 0.25, 0.0), 1e-12,
+               "BjS put-call transformation");
+
+    // The approximations divide by T and sig, so a finite-maturity option without them is refused up front
+    auto refused = [](double T, double sig) {
+        try {
+            american_option(100, 100, 0.05, T, sig, 0.05, option::PUT);
+        } catch (const std::invalid_argument&) {
+            return true;
+        }
+        return false;
+    };
+    check(refused(0, 0.2) && refused(-1, 0.2) && refused(1, 0) && !refused(1, 0.2), "finite-maturity American option needs T > 0 and sig > 0");
+    american_option perpetual(100, 100, 0.05, 0.2, 0.05, option::PUT);
+    check(!std::isnan(perpetual.price()), "perpetual American option without a maturity");
+
+    // The batch checks every option type under every method before pricing, and refuses a method it does not know
+    const double S[2] = {100, 100}, K[2] = {95, 105}, r[2] = {0.05, 0.05}, T[2] = {1, 1}, sig[2] = {0.2, 0.2}, b[2] = {0.05, 0.05};
+    const int valid[2] = {option::CALL, option::PUT}, invalid[2] = {option::CALL, 3};
+    auto batch_throws = [&](const int* type, american_method method) -> std::string {
+        double prices[2];
+        try {
+            pm.price_american_batch(S, K, r, T, sig, b, std::span(type, 2), method, prices);
+        } catch (const std::domain_error&) {
+            return "domain_error";
+        } catch (const std::invalid_argument&) {
+            return "invalid_argument";
+        }
+        return "none";
+    };
+    for (const american_method method : {american_method::perpetual, american_method::barone_adesi_whaley, american_method::bjerksund_stensland,
+                                         american_method::crank_nicolson}) {
+        const std::string name = std::to_string(static_cast<int>(method));
+        check(batch_throws(valid, method) == "none", "American batch prices calls and puts with method " + name);
+        check(batch_throws(invalid, method) == "domain_error", "American batch refuses option type 3 with method " + name);
+    }
+    check(batch_throws(valid, static_cast<american_method>(99)) == "invalid_argument", "American batch refuses an unknown method");
+}
+
+// Cox-Ross-Rubinstein tree with early exercise at every node (error O(1/steps), ~1e-4 at 5000 steps)
+static double binomial_american(double S, double K, double r, double T, double sig, double b, int type, int steps) {
+    const double dt = T / steps, up = std::exp(sig * std::sqrt(dt)), p = (std::exp(b * dt) - 1 / up) / (up - 1 / up), discount = std::exp(-r * dt);
+    const double w = (type == option::CALL) ? 1.0 : -1.0;
+    std::vector<double> value(steps + 1);
+    for (int j = 0; j <= steps; ++j) value[j] = std::max(0.0, w * (S * std::pow(up, 2 * j - steps) - K));
+    for (int i = steps - 1; i >= 0; --i) {
+        for (int j = 0; j <= i; ++j) {
+            value[j] = std::max(discount * (p * value[j + 1] + (1 - p) * value[j]), w * (S * std::pow(up, 2 * j - i) - K));
+        }
+    }
+    return value[0];
+}
+
+// Brennan-Schwartz on the default grid is within ~1.5e-3 of the tree for calls and puts alike; carries cover calls
+// with (b < r, b = 0) and without (b = r) early exercise
+static void american_pde() {
+    const pricing_methods pm;
+    for (const int type : {option::CALL, option::PUT}) {
+        for (const double b : {0.0, -0.04, 0.08}) {
+            for (const double S : {80.0, 100.0, 120.0}) {
+                const double tree = binomial_american(S, 100, 0.08, 1, 0.25, b, type, 5000);
+                const double pde = pm.price_american_pde(S, 100, 0.08, 1, 0.25, b, type).price;
+                check_near(pde, tree, 2.5e-3, std::string(type == option::CALL ? "PDE call" : "PDE put") + " vs tree, S=" + std::to_string(S)
+                                                  + " b=" + std::to_string(b));
+            }
+        }
+    }
+    // Put-call symmetry: C(S, K, r, b) = P(K, S, r - b, -b)
+    check_near(pm.price_american_pde(120, 100, 0.08, 1, 0.25, -0.04, option::CALL).price,
+               pm.price_american_pde(100, 120, 0.12, 1, 0.25, 0.04, option::PUT).price, 2.5e-3, "PDE American put-call symmetry");
+}
+
+// A chain with strikes from 25 to 400 shares one grid per (r, T, sig, b, type); its spacing must stay that of a single
+// contract, so each strike is within 2e-5 K of the tree and matches its own single-contract solve
+static void american_chain() {
+    const pricing_methods pm;
+    const std::vector<double> K = {25, 50, 80, 100, 125, 200, 400};
+    const std::size_t n = K.size();
+    const std::vector<double> S(n, 100), r(n, 0.08), T(n, 1), sig(n, 0.25);
+    for (const int type : {option::CALL, option::PUT}) {
+        for (const double b : {0.0, -0.04}) {
+            const std::vector<double> carry(n, b);
+            const std::vector<int> types(n, type);
+            std::vector<double> chain(n);
+            pm.price_american_batch(S, K, r, T, sig, carry, types, american_method::crank_nicolson, chain);
+            for (std::size_t i = 0; i < n; ++i) {
+                const std::string what = std::string(type == option::CALL ? "chain call" : "chain put") + " K=" + std::to_string(K[i])
+                                         + " b=" + std::to_string(b);
+                check_near(chain[i], binomial_american(100, K[i], 0.08, 1, 0.25, b, type, 5000), 2e-5 * K[i], what + " vs tree");
+                check_near(chain[i], pm.price_american_pde(100, K[i], 0.08, 1, 0.25, b, type).price, 1e-5 * K[i], what + " vs single");
+            }
+        }
+    }
+}
+
+// A book interleaving the three kinds so every block scatters into insertion order: several European and American
+// chunks of portfolio::chunk_rows, runs of every American method and a few Asian contracts
+static void portfolio_book() {
+    const contracts c(24000, 31);
+    const std::size_t n = c.S.size();
+    const american_method methods[] = {american_method::bjerksund_stensland, american_method::barone_adesi_whaley, american_method::perpetual,
+                                       american_method::crank_nicolson};
+    auto method_of = [&](std::size_t i) { return (i % 200 == 1) ? methods[(i / 200) % 4] : methods[(i / 40) % 2]; };
+    portfolio book;
+    std::vector<contract_handle> handles;
+    std::vector<std::unique_ptr<option>> expected; // the same contracts built directly, in insertion order
+    for (std::size_t i = 0; i < n; ++i) {
+        if (i % 2000 == 5) {
+            handles.push_back(book.add_asian(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], c.b[i], c.type[i], 2000, 16));
+            expected.push_back(std::make_unique<asian_option>(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], c.b[i], c.type[i], 2000, 16));
+        } else if (i % 5 < 2) {
+            const american_method method = method_of(i);
+            // The perpetual formulas need r > 0 and b < r
+            const double r = (method == american_method::perpetual) ? 0.05 : c.r[i], b = (method == american_method::perpetual) ? 0.02 : c.b[i];
+            handles.push_back(book.add_american(c.S[i], c.K[i], r, c.T[i], c.sig[i], b, c.type[i], method));
+            expected.push_back(std::make_unique<american_option>(c.S[i], c.K[i], r, c.T[i], c.sig[i], b, c.type[i], method));
+        } else {
+            handles.push_back(book.add_european(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], c.b[i], c.type[i]));
+            expected.push_back(std::make_unique<european_option>(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], c.b[i], c.type[i]));
+        }
+    }
+    check(book.count(contract_kind::european) > 3 * 4096 && book.count(contract_kind::american) > 2 * 4096, "book spans several chunks of each kind");
+
+    std::vector<double> prices(n);
+    book.price(prices, 4);
+    std::size_t mismatched = 0, misplaced = 0, off_lookup = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const double single = book.price(handles[i]), looked_up = book.at(handles[i])->price(), direct = expected[i]->price();
+        if (std::memcmp(&prices[i], &single, sizeof(double)) != 0) ++mismatched;
+        if (std::memcmp(&looked_up, &direct, sizeof(double)) != 0) ++off_lookup;
+        // The batch kernels agree with the scalar pricers to their documented tolerance, not bit for bit
+        if (!(std::fabs(prices[i] - direct) <= 1e-12 * std::max(c.S[i], c.K[i]))) ++misplaced;
+    }
+    check(mismatched == 0, std::to_string(mismatched) + " bulk price(s) differ from price(handle)");
+    check(off_lookup == 0, std::to_string(off_lookup) + " at(handle)->price() differ from the contract built directly");
+    check(misplaced == 0, std::to_string(misplaced) + " bulk price(s) differ from the contract added at that position");
+}
+
+// Enough European and American chunks, and Asian items, that the threads take work items in varying order
+static void risk() {
+    const contracts c(20000, 13);
+    portfolio book;
+    std::vector<double> quantity;
+    std::vector<std::uint32_t> underlying;
+    for (std::size_t i = 0; i < c.S.size(); ++i) {
+        if (i % 20 == 0) book.add_american(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], c.b[i], c.type[i]);
+        else if (i % 1000 == 1) book.add_asian(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], c.b[i], c.type[i], 2000, 16);
+        else book.add_european(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], c.b[i], c.type[i]);
+        quantity.push_back(static_cast<double>(static_cast<int>(i % 7) - 3) + 0.1);
+        underlying.push_back(static_cast<std::uint32_t>(i % 5));
+    }
+    const risk_engine engine;
+    const risk_report one = engine.aggregate(book, quantity, underlying, 1);
+    auto same = [](const risk_totals& x, const risk_totals& y) {
+        return std::memcmp(&x, &y, sizeof(risk_totals)) == 0;
+    };
+    for (int run = 0; run < 3; ++run) {
+        const risk_report four = engine.aggregate(book, quantity, underlying, 4);
+        bool identical = one.buckets.size() == four.buckets.size() && same(one.book, four.book);
+        for (std::size_t k = 0; identical && k < one.buckets.size(); ++k) identical = same(one.buckets[k].totals, four.buckets[k].totals);
+        check(identical, "risk report on 4 threads identical to 1 thread (run " + std::to_string(run) + ")");
+    }
+    check(one.book.positions == c.S.size(), "risk report covers every position");
+}
+
+// A mixed book over two European chunks, several American ones (both analytic methods) and a few Asian contracts
+static void scenarios() {
+    const contracts c(9000, 29);
+    portfolio book;
+    std::vector<double> quantity;
+    auto carry = [&](std::size_t i) { return (i % 3 == 2) ? 0.0 : c.b[i]; }; // futures on every third: the rate shock leaves b = 0
+    for (std::size_t i = 0; i < c.S.size(); ++i) {
+        if (i % 10 == 0) {
+            const american_method method = (i % 20 == 0) ? american_method::bjerksund_stensland : american_method::barone_adesi_whaley;
+            book.add_american(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], carry(i), c.type[i], method);
+        } else if (i % 1500 == 1) {
+            book.add_asian(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], carry(i), c.type[i], 2000, 16);
+        } else {
+            book.add_european(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], carry(i), c.type[i]);
+        }
+        quantity.push_back(static_cast<double>(static_cast<int>(i % 7) - 3) + 0.1);
+    }
+    const double d_spot[] = {-0.2, 0.0, 0.15}, d_vol[] = {-0.01, 0.0, 0.1}, d_rate[] = {-0.01, 0.02};
+    const std::vector<scenario_shock> shocks = scenario_engine::grid(d_spot, d_vol, d_rate);
+    const scenario_engine engine;
+    const scenario_report report = engine.run(book, quantity, shocks, scenario_mode::both, 4);
+
+    // Full revaluation against a loop of option::price() on the shocked inputs
+    double scale = 0.0;
+    for (std::size_t i = 0; i < c.S.size(); ++i) scale += std::fabs(quantity[i]) * (c.S[i] + c.K[i]);
+    for (std::size_t k = 0; k < shocks.size(); ++k) {
+        const scenario_shock& x = shocks[k];
+        double pnl = 0.0;
+        for (std::size_t i = 0; i < c.S.size(); ++i) {
+            const double S = c.S[i] * (1.0 + x.spot), r = c.r[i] + x.rate, sig = c.sig[i] + x.volatility;
+            const double b0 = carry(i), b = (b0 != 0.0) ? b0 + x.rate : b0;
+            double shocked, unshocked;
+            if (i % 10 == 0) {
+                const american_method method = (i % 20 == 0) ? american_method::bjerksund_stensland : american_method::barone_adesi_whaley;
+                shocked = american_option(S, c.K[i], r, c.T[i], sig, b, c.type[i], method).price();
+                unshocked = american_option(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], b0, c.type[i], method).price();
+            } else if (i % 1500 == 1) {
+                shocked = asian_option(S, c.K[i], r, c.T[i], sig, b, c.type[i], 2000, 16).price();
+                unshocked = asian_option(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], b0, c.type[i], 2000, 16).price();
+            } else {
+                shocked = european_option(S, c.K[i], r, c.T[i], sig, b, c.type[i]).price();
+                unshocked = european_option(c.S[i], c.K[i], c.r[i], c.T[i], c.sig[i], b0, c.type[i]).price();
+            }
+            pnl += quantity[i] * (shocked - unshocked);
+        }
+        check_near(report.scenarios[k].full_pnl, pnl, 1e-11 * scale, "full revaluation P&L of scenario " + std::to_string(k) + " against option::price()");
+    }
+
+    // Thread count
+    const scenario_report one = engine.run(book, quantity, shocks, scenario_mode::both, 1);
+    bool identical = one.base_value == report.base_value && one.scenarios.size() == report.scenarios.size();
+    for (std::size_t k = 0; identical && k < shocks.size(); ++k) {
+        identical = std::memcmp(&one.scenarios[k], &report.scenarios[k], sizeof(scenario_result)) == 0;
+    }
+    check(identical, "scenario report on 4 threads identical to 1 thread");
+
+    // The Taylor error is of higher order than the shock, so the relative error shrinks with it, by at least a factor
+    // 3 per decade (Monte-Carlo paths crossing the strike keep the Asian part from being a clean square). The American
+    // approximations are only piecewise smooth (exercise trigger, the r = 0 switch of the put transformation), so a
+    // bumped Greek need not match a small shock across a kink; their positions are zeroed here.
+    std::vector<double> smooth_quantity = quantity;
+    for (std::size_t i = 0; i < c.S.size(); i += 10) smooth_quantity[i] = 0.0;
+    double previous = std::numeric_limits<double>::infinity();
+    for (const double size : {1.0, 0.1, 0.01}) {
+        const scenario_shock x{0.1 * size, 0.05 * size, 0.01 * size};
+        const scenario_result r = engine.run(book, smooth_quantity, std::span(&x, 1)).scenarios[0];
+        const double relative = std::fabs(r.error / r.full_pnl);
+        check(relative < previous / 3.0, "Taylor P&L converges to full revaluation at shock size " + std::to_string(size) + " (relative error " +
+                                               std::to_string(relative) + ")");
+        previous = relative;
+    }
+
+    // Shocks that leave a contract unpriceable are refused
+    for (const scenario_shock& x : {scenario_shock{-1.0, 0.0, 0.0}, scenario_shock{-1.5, 0.0, 0.0}, scenario_shock{0.0, -0.8, 0.0}}) {
+        for (const scenario_mode mode : {scenario_mode::taylor, scenario_mode::full_revaluation, scenario_mode::both}) {
+            bool thrown = false;
+            try {
+                engine.run(book, quantity, std::span(&x, 1), mode);
+            } catch (const std::invalid_argument&) {
+                thrown = true;
+            }
+            check(thrown, "shock (" + std::to_string(x.spot) + ", " + std::to_string(x.volatility) + ") refused in mode " +
+                              std::to_string(static_cast<int>(mode)));
+        }
+    }
+}
+
+// Every request but the last breaks one of the daemon's input checks; 1e999 parses as infinity
+static void jsonl() {
+    const std::string base = R"("type": "call", "strike": 100, "rate": 0.05, "volatility": 0.2, "maturity": 1)";
+    const std::string lines[] = {R"({"id": 1, "kind": "european", "spot": 0, )" + base + "}",
+                                 R"({"id": 2, "kind": "american", "spot": -5, )" + base + "}",
+                                 R"({"id": 3, "kind": "european", "spot": 1e999, )" + base + "}",
+                                 R"({"id": 4, "kind": "european", "spot": 100, "cost_of_carry": -1e999, )" + base + "}",
+                                 R"({"id": 5, "kind": "european", "spot": 100, "type": "put", "strike": 100, "rate": 0.05, "volatility": 0, "maturity": 1})",
+                                 R"({"id": 6, "kind": "american", "spot": 100, "type": "put", "strike": 100, "rate": 0.05, "volatility": 0.2, "maturity": 0})",
+                                 R"({"id": 7, "kind": "asian", "spot": 100, "nSimulations": 0, )" + base + "}",
+                                 R"({"id": 8, "kind": "asian", "spot": 100, "nTimeSteps": -3, )" + base + "}",
+                                 R"({"id": 9, "kind": "european", "spot": 100, )" + base + "}"};
+    std::string input;
+    for (const std::string& line : lines) input += line + "\n";
+    std::istringstream in(input);
+    std::ostringstream out;
+    jsonl_interface().run(in, out);
+
+    std::istringstream results(out.str());
+    std::string result;
+    std::size_t n = 0;
+    while (std::getline(results, result)) {
+        ++n;
+        const bool is_error = result.find("\"error\"") != std::string::npos;
+        check(is_error == (n < std::size(lines)), "JSONL request " + std::to_string(n) + (n < std::size(lines) ? " rejected: " : " priced: ") + result);
+    }
+    check(n == std::size(lines), "JSONL results: " + std::to_string(n) + " of " + std::to_string(std::size(lines)));
+
+    // An American price does not depend on which Greeks come with it
+    const std::string put = R"("kind": "american", "type": "put", "spot": 100, "strike": 100, "rate": 0.08, "volatility": 0.25, "maturity": 1)";
+    std::istringstream american_in(R"({"id": 1, )" + put + "}\n" + R"({"id": 2, "outputs": ["price", "delta"], )" + put + "}\n");
+    std::ostringstream american_out;
+    jsonl_interface().run(american_in, american_out);
+    auto price_of = [](const std::string& line) {
+        const std::size_t at = line.find("\"price\":");
+        return at == std::string::npos ? std::string() : line.substr(at + 8, line.find_first_of(",}", at) - at - 8);
+    };
+    std::istringstream american_results(american_out.str());
+    std::string price_only, with_delta;
+    std::getline(american_results, price_only);
+    std::getline(american_results, with_delta);
+    check(!price_of(price_only).empty() && price_of(price_only) == price_of(with_delta),
+          "JSONL American price with and without delta: " + price_only + " vs " + with_delta);
+
+    // ... and its delta is the slope of that same Bjerksund-Stensland price, not of another model
+    const pricing_methods pm;
+    const double slope = (pm.price_american_bjs_put(100.1, 100, 0.08, 1, 0.25, 0.08) - pm.price_american_bjs_put(99.9, 100, 0.08, 1, 0.25, 0.08)) / 0.2;
+    const std::size_t at = with_delta.find("\"delta\":");
+    check(at != std::string::npos && std::abs(std::stod(with_delta.substr(at + 8)) - slope) < 1e-9,
+          "JSONL American delta vs Bjerksund-Stensland slope " + std::to_string(slope) + ": " + with_delta);
+}
+
+// Connects once the daemon started on another thread is listening
+static int connect_when_ready(const std::string& address) {
+    for (int attempt = 0;; ++attempt) {
+        try {
+            return daemon_protocol::connect_to(address);
+        } catch (const std::runtime_error&) {
+            if (attempt == 200) throw;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+}
+
+// At-the-money European call, price only
+static daemon_protocol::request price_request() {
+    daemon_protocol::request m{};
+    m.type = daemon_protocol::price;
+    m.version = daemon_protocol::version;
+    m.option_type = 1;
+    m.call_put_type = 1;
+    m.spot = m.strike = 100;
+    m.rate = m.cost_of_carry = 0.05;
+    m.volatility = 0.2;
+    m.maturity = 1;
+    return m;
+}
+
+// One client floods its connection without reading replies (far more than the socket buffers and the in-flight
+// window hold); a second client must still get its reply. The flood is then read back in full.
+static void daemon_slow_reader() {
+    using namespace daemon_protocol;
+    const std::string address = "unix:/tmp/option_pricer_tests_" + std::to_string(::getpid()) + ".sock";
+    pricing_daemon server(address);
+    std::thread serving([&] { server.serve(); });
+    auto connect = [&] { return connect_when_ready(address); };
+    const request m = price_request();
+
+    const std::size_t flood_size = 20000;
+    const int flooder = connect();
+    std::thread flooding([&] {
+        const std::vector<request> flood(flood_size, m);
+        write_full(flooder, flood.data(), flood.size() * sizeof(request));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200)); // let the flood fill the buffers
+
+    const int other = connect();
+    reply r{};
+    pollfd readable{other, POLLIN, 0};
+    const bool answered = write_full(other, &m, sizeof(m)) && ::poll(&readable, 1, 10000) == 1 && read_full(other, &r, sizeof(r));
+    check(answered && r.status == ok, "daemon answers a second client while the first is not reading");
+    // An American price does not depend on which Greeks come with it
+    request american[2] = {m, m};
+    for (request& a : american) {
+        a.option_type = 2;
+        a.call_put_type = 2;
+        a.rate = 0.08;
+        a.cost_of_carry = 0;
+    }
+    american[1].outputs = out_price | out_delta;
+    reply american_replies[2]{};
+    if (write_full(other, american, sizeof(american)) && read_full(other, american_replies, sizeof(american_replies))) {
+        check(american_replies[0].status == ok && american_replies[1].status == ok && american_replies[0].values[0] == american_replies[1].values[0],
+              "daemon American price with and without delta: " + std::to_string(american_replies[0].values[0]) + " vs "
+                  + std::to_string(american_replies[1].values[0]));
+    } else {
+        check(false, "daemon American price round trip");
+    }
+    ::close(other);
+
+    std::size_t drained = 0;
+    while (drained < flood_size && read_full(flooder, &r, sizeof(r))) ++drained;
+    flooding.join();
+    check(drained == flood_size, "flooding client gets every reply: " + std::to_string(drained) + " of " + std::to_string(flood_size));
+    ::close(flooder);
+
+    server.stop();
+    serving.join();
+}
+
+// stop() must return while a client keeps flooding without reading: its reader is held at the in-flight window and
+// its writer is blocked on a full socket
+static void daemon_stop() {
+    using namespace daemon_protocol;
+    const std::string address = "unix:/tmp/option_pricer_tests_stop_" + std::to_string(::getpid()) + ".sock";
+    pricing_daemon server(address);
+    std::atomic<bool> stopped{false};
+    std::thread serving([&] {
+        server.serve();
+        stopped = true;
+    });
+    const int flooder = connect_when_ready(address);
+    std::thread flooding([&] {
+        const std::vector<request> flood(20000, price_request());
+        write_full(flooder, flood.data(), flood.size() * sizeof(request));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200)); // let the flood fill the buffers and the window
+
+    server.stop();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!stopped && std::chrono::steady_clock::now() < deadline) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    check(stopped, "daemon stops while a client is flooding without reading");
+    ::shutdown(flooder, SHUT_RDWR); // releases a daemon that did not stop, so the test fails instead of hanging
+    flooding.join();
+    serving.join();
+    ::close(flooder);
+}
+
+// SoA Philox on n random counters against n scalar calls; n = 16 and 32 take the AVX-512 path, 20 the plain loops
+template <std::size_t n>
+static void philox_matches_scalar(const philox& rng, std::mt19937& gen) {
+    std::uint32_t ctr[4][n];
+    philox::block scalar[n];
+    for (std::size_t i = 0; i < n; ++i) {
+        for (int w = 0; w < 4; ++w) ctr[w][i] = scalar[i][w] = static_cast<std::uint32_t>(gen());
+    }
+    rng(ctr);
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const philox::block expected = rng(scalar[i]);
+        for (int w = 0; w < 4; ++w) mismatches += ctr[w][i] != expected[w];
+    }
+    check(mismatches == 0, "SoA Philox matches the scalar blocks, n=" + std::to_string(n));
+}
+
+// Rows of a CSV file (header included), split into fields
+static std::vector<std::vector<std::string>> csv_rows(const std::string& text) {
+    std::vector<std::vector<std::string>> rows;
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::vector<std::string>& fields = rows.emplace_back();
+        std::istringstream cells(line);
+        std::string cell;
+        while (std::getline(cells, cell, ',')) fields.push_back(cell);
+    }
+    return rows;
+}
+
+// A four-axis sweep decodes row k with the last axis fastest and prices each row as the option built from its own
+// axis values; the file written does not depend on chunk_rows or the thread count
+static void matrix_sweep() {
+    const std::string stem = "/tmp/option_pricer_tests_matrix_" + std::to_string(::getpid());
+    const std::vector<sweep_axis> axes = {{"spot", 50.0, 70.0, 5.0}, {"strike", 60.0, 70.0, 10.0}, {"volatility", 0.1, 0.3, 0.1},
+                                          {"maturity", 0.5, 1.5, 0.5}};
+    const std::size_t counts[4] = {5, 2, 3, 3};
+    matrix_interface sweep(axes);
+    sweep.set_option(1, 1);
+    check(sweep.row_count() == 5 * 2 * 3 * 3 && sweep.column_count() == 4 + matrix_interface::n_result_columns, "sweep grid size");
+    sweep.write_csv(stem + ".csv");
+    const std::string reference = read_file(stem + ".csv");
+    const auto rows = csv_rows(reference);
+    check(rows.size() == sweep.row_count() + 1 && rows[0].size() == sweep.column_count() && rows[0][0] == "spot" && rows[0][3] == "maturity",
+          "sweep CSV has a header and one line per row");
+
+    std::size_t misplaced = 0, mispriced = 0;
+    for (std::size_t k = 0; k + 1 < rows.size(); ++k) {
+        double value[4];
+        for (std::size_t a = 4, rest = k; a-- > 0; rest /= counts[a]) value[a] = axes[a].begin + static_cast<double>(rest % counts[a]) * axes[a].h;
+        for (std::size_t a = 0; a < 4; ++a) {
+            if (std::strtod(rows[k + 1][a].c_str(), nullptr) != value[a]) ++misplaced;
+        }
+        // Rate and carry are the interface's unswept defaults (8%)
+        const double price = european_option(value[0], value[1], 0.08, value[3], value[2], 0.08, option::CALL).price_and_greeks().price;
+        if (std::strtod(rows[k + 1][4].c_str(), nullptr) != price) ++mispriced;
+    }
+    check(misplaced == 0, std::to_string(misplaced) + " sweep axis value(s) out of last-axis-fastest order");
+    check(mispriced == 0, std::to_string(mispriced) + " sweep price(s) differ from the option at that grid point");
+
+    // European and Asian sweeps, cut into chunks that do and do not divide the grid, on 1 to 8 threads
+    for (const int option_type : {1, 3}) {
+        const std::vector<sweep_axis> grid = (option_type == 1) ? axes : std::vector<sweep_axis>{{"spot", 55.0, 65.0, 5.0}, {"volatility", 0.2, 0.4, 0.1}};
+        matrix_interface base(grid);
+        base.set_option(option_type, 2, 2000, 16);
+        base.write_csv(stem + "_base.csv");
+        const std::string expected = read_file(stem + "_base.csv");
+        for (const std::size_t chunk_rows : {std::size_t(1), std::size_t(4), std::size_t(7), std::size_t(65536)}) {
+            for (const unsigned threads : {1u, 3u, 8u}) {
+                matrix_interface other(grid);
+                other.set_option(option_type, 2, 2000, 16);
+                other.set_threads(threads);
+                other.write_csv(stem + "_other.csv", chunk_rows);
+                check(read_file(stem + "_other.csv") == expected, "option type " + std::to_string(option_type) + " sweep CSV with chunk_rows " +
+                                                                        std::to_string(chunk_rows) + " on " + std::to_string(threads) + " thread(s)");
+            }
+        }
+    }
+    for (const char* suffix : {".csv", "_base.csv", "_other.csv"}) std::remove((stem + suffix).c_str());
+}
+
+// Known-answer vectors of Philox4x32-10 from the Random123 distribution, then SoA against scalar for several keys
+static void philox_blocks() {
+    check(philox(0)({0, 0, 0, 0}) == philox::block{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}, "Philox known answer, zero key");
+    check(philox(~0ULL)({~0u, ~0u, ~0u, ~0u}) == philox::block{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}, "Philox known answer, all-ones key");
+    std::mt19937 gen(7);
+    for (const std::uint64_t seed : {0ULL, 42ULL, 0x0123456789abcdefULL}) {
+        const philox rng(seed);
+        philox_matches_scalar<16>(rng, gen);
+        philox_matches_scalar<32>(rng, gen);
+        philox_matches_scalar<20>(rng, gen);
+    }
+}
+
+// Columns equal bit for bit
+static bool same_columns(const portfolio_columns& x, const portfolio_columns& y) {
+    auto same = [](auto a, auto b) { return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size_bytes()) == 0; };
+    return same(x.spot, y.spot) && same(x.strike, y.strike) && same(x.rate, y.rate) && same(x.volatility, y.volatility)
+           && same(x.maturity, y.maturity) && same(x.cost_of_carry, y.cost_of_carry) && same(x.option_type, y.option_type)
+           && same(x.call_put_type, y.call_put_type) && same(x.n_simulations, y.n_simulations) && same(x.n_time_steps, y.n_time_steps);
+}
+
+// A ~15 MB CSV with its columns out of file order and some CRLF line ends: the loader cuts it into 1 MB chunks at
+// line boundaries, 4 of them on one thread and 8, 12 or 15 on more, so rows straddle different cut points each time
+static void portfolio_file_round_trip() {
+    const std::string stem = "/tmp/option_pricer_tests_portfolio_" + std::to_string(::getpid());
+    const std::string text_path = stem + ".csv", binary_path = stem + ".bin", bad_path = stem + "_bad.bin";
+    const contracts c(100000, 19);
+    const std::size_t n = c.S.size();
+    portfolio_data expected;
+    expected.resize(n);
+    {
+        std::ofstream file(text_path, std::ios::binary);
+        file.precision(17); // round-trips every double
+        file << "call_put_type,strike,spot,rate,volatility,maturity,cost_of_carry,option_type,nTimeSteps,nSimulations\n";
+        for (std::size_t i = 0; i < n; ++i) {
+            expected.spot[i] = c.S[i];
+            expected.strike[i] = c.K[i];
+            expected.rate[i] = c.r[i];
+            expected.volatility[i] = c.sig[i];
+            expected.maturity[i] = c.T[i];
+            expected.cost_of_carry[i] = c.b[i];
+            expected.call_put_type[i] = c.type[i];
+            expected.option_type[i] = (i % 5000 == 7) ? 3 : (i % 3 == 1 ? 2 : 1); // interleaved runs, a few Asian
+            expected.n_time_steps[i] = 8 + static_cast<int>(i % 5);
+            expected.n_simulations[i] = 1000 + static_cast<int>(i % 7);
+            file << c.type[i] << ',' << c.K[i] << ',' << c.S[i] << ',' << c.r[i] << ',' << c.sig[i] << ',' << c.T[i] << ',' << c.b[i] << ','
+                 << expected.option_type[i] << ',' << expected.n_time_steps[i] << ',' << expected.n_simulations[i] << (i % 7 == 0 ? "\r\n" : "\n");
+        }
+    }
+    for (const unsigned threads : {1u, 2u, 3u, 8u}) {
+        check(same_columns(portfolio_io::load_text(text_path, threads).columns(), expected.columns()),
+              "CSV portfolio loaded on " + std::to_string(threads) + " thread(s) matches the rows written");
+    }
+
+    portfolio_io::convert_text_to_binary(text_path, binary_path, 4);
+    check(portfolio_io::is_binary(binary_path) && !portfolio_io::is_binary(text_path), "binary portfolio recognised by its magic");
+    {
+        const mapped_portfolio mapped(binary_path);
+        check(same_columns(mapped.columns(), expected.columns()), "text -> binary -> mapped portfolio is bit exact");
+
+        // Column pricing against the structure-of-arrays book built from the same columns
+        std::vector<double> from_columns(n), from_book(n);
+        portfolio_io::price(mapped.columns(), from_columns);
+        portfolio::from_columns(mapped.columns()).price(from_book);
+        check(std::memcmp(from_columns.data(), from_book.data(), n * sizeof(double)) == 0, "portfolio_io::price matches portfolio::price");
+    }
+
+    // Corrupted copies: magic, version (the uint32 after the magic) and a file cut inside the header
+    const std::string bytes = read_file(binary_path);
+    auto refused = [&](const std::string& contents) {
+        std::ofstream(bad_path, std::ios::binary).write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        try {
+            mapped_portfolio bad(bad_path);
+        } catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    };
+    std::string bad_magic = bytes, bad_version = bytes;
+    bad_magic[0] = 'X';
+    const std::uint32_t next_version = portfolio_io::format_version + 1;
+    std::memcpy(bad_version.data() + 8, &next_version, sizeof(next_version));
+    check(!refused(bytes), "intact binary portfolio copy accepted");
+    check(refused(bad_magic), "binary portfolio with a bad magic refused");
+    check(refused(bad_version), "binary portfolio of another version refused");
+    check(refused(bytes.substr(0, 100)), "truncated binary portfolio refused");
+
+    for (const std::string& path : {text_path, binary_path, bad_path}) std::remove(path.c_str());
+}
+
+#ifdef OPTION_PRICER_INSTRUMENTATION
+// Minimal JSON syntax check: one value, nothing after it but whitespace
+struct json_syntax {
+    const char* p;
+    const char* end;
+
+    void space() {
+        while (p < end && std::isspace(static_cast<unsigned char>(*p))) ++p;
+    }
+    bool literal(const char* word) {
+        const std::size_t n = std::strlen(word);
+        if (static_cast<std::size_t>(end - p) < n || std::strncmp(p, word, n) != 0) return false;
+        p += n;
+        return true;
+    }
+    bool string() {
+        if (p == end || *p++ != '"') return false;
+        while (p < end && *p != '"') p += (*p == '\\') ? 2 : 1;
+        return p++ < end;
+    }
+    bool number() {
+        char* after = nullptr;
+        std::strtod(p, &after);
+        if (after == p || after > end) return false;
+        p = after;
+        return true;
+    }
+    bool value() {
+        space();
+        if (p == end) return false;
+        bool ok;
+        if (*p == '{' || *p == '[') {
+            const char close = (*p == '{') ? '}' : ']';
+            const bool object = *p++ == '{';
+            space();
+            ok = true;
+            if (p < end && *p == close) {
+                ++p;
+            } else {
+                for (;;) {
+                    if (object) {
+                        space();
+                        if (!string()) return false;
+                        space();
+                        if (p == end || *p++ != ':') return false;
+                    }
+                    if (!value()) return false;
+                    space();
+                    if (p < end && *p == ',') {
+                        ++p;
+                        continue;
+                    }
+                    if (p == end || *p++ != close) return false;
+                    break;
+                }
+            }
+        } else if (*p == '"') {
+            ok = string();
+        } else {
+            ok = literal("true") || literal("false") || literal("null") || number();
+        }
+        space();
+        return ok;
+    }
+    static bool valid(const std::string& text) {
+        json_syntax json{text.data(), text.data() + text.size()};
+        return json.value() && json.p == json.end;
+    }
+};
+
+// Prometheus text format: every line a # HELP / # TYPE comment or `name{labels} value`; returns the series
+static std::vector<std::pair<std::string, double>> prometheus_series(const std::string& text, bool& valid) {
+    std::vector<std::pair<std::string, double>> series;
+    std::istringstream lines(text);
+    std::string line;
+    valid = !text.empty() && text.back() == '\n';
+    while (std::getline(lines, line)) {
+        if (line.rfind("# HELP ", 0) == 0 || line.rfind("# TYPE ", 0) == 0) continue;
+        const std::size_t space = line.rfind(' ');
+        const std::size_t brace = line.find('{');
+        char* after = nullptr;
+        const double value = (space == std::string::npos) ? 0.0 : std::strtod(line.c_str() + space + 1, &after);
+        const bool labels_ok = brace == std::string::npos || (brace < space && line[space - 1] == '}');
+        if (space == std::string::npos || space == 0 || !labels_ok || after != line.c_str() + line.size()) {
+            valid = false;
+            continue;
+        }
+        series.emplace_back(line.substr(0, space), value);
+    }
+    return series;
+}
+#endif
+
+// Probes are compiled in only with OPTION_PRICER_INSTRUMENTATION (the OptionPricerTestsInstrumented build); without
+// it the group is reported to CTest as skipped
+static void instrumentation_counters() {
+#ifdef OPTION_PRICER_INSTRUMENTATION
+    using instrumentation::probe;
+    const pricing_methods pm;
+    auto stats = [](const instrumentation::snapshot& s, probe p) { return s.probes[static_cast<std::size_t>(p)]; };
+    auto call = [&] { pm.price_european_call(100, 100, 0.05, 1, 0.2, 0.05); };
+
+    instrumentation::reset();
+    for (int i = 0; i < 5; ++i) call();
+    const contracts c(1000, 37);
+    std::vector<double> prices(c.S.size());
+    for (int i = 0; i < 2; ++i) pm.price_european_batch(c.S, c.K, c.r, c.T, c.sig, c.b, c.type, prices);
+    asian_mc_config config;
+    config.n_threads = 1;
+    pm.price_asian_mc(100, 100, 1, 0.05, 0.2, 0.05, 16, 4000, option::CALL, config);
+    instrumentation::snapshot s = instrumentation::collect();
+    check(stats(s, probe::european_price).calls == 5 && stats(s, probe::european_price).items == 5, "scalar calls counted once per call");
+    check(stats(s, probe::european_batch).calls == 2 && stats(s, probe::european_batch).items == 2000, "batch calls count every contract");
+    check(stats(s, probe::european_price).latency.count() == 5, "one latency sample per call");
+    check(s.mc.paths == 4000 && s.mc.steps == 4000 * 16 && s.mc.rng_draws == 4000 * 16, "Monte-Carlo paths, steps and draws counted");
+
+    // A thread still running is merged from its live stats, and its counts survive the thread exiting
+    std::atomic<int> stage{0};
+    std::thread live([&] {
+        for (int i = 0; i < 7; ++i) call();
+        stage = 1;
+        while (stage.load() != 2) std::this_thread::yield();
+    });
+    while (stage.load() != 1) std::this_thread::yield();
+    check(stats(instrumentation::collect(), probe::european_price).calls == 12, "calls merged from a live thread");
+    stage = 2;
+    live.join();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 3; ++t) workers.emplace_back([&] {
+        for (int i = 0; i < 4; ++i) call();
+    });
+    for (std::thread& w : workers) w.join();
+    s = instrumentation::collect();
+    check(stats(s, probe::european_price).calls == 24, "calls merged from exited threads: got " + std::to_string(stats(s, probe::european_price).calls));
+
+    // Both exports parse and carry the counts
+    check(json_syntax::valid(instrumentation::to_json(s)), "JSON export parses");
+    check(instrumentation::to_json(s).find("\"european_price\":{\"calls\":24,\"items\":24,") != std::string::npos, "JSON export carries the counts");
+    bool valid = false;
+    const auto series = prometheus_series(instrumentation::to_prometheus(s), valid);
+    check(valid, "Prometheus export parses");
+    auto value_of = [&](const std::string& name) {
+        for (const auto& [key, value] : series) {
+            if (key == name) return value;
+        }
+        return -1.0;
+    };
+    check(value_of("option_pricer_calls_total{pricer=\"european_price\"}") == 24, "Prometheus calls counter");
+    check(value_of("option_pricer_items_total{pricer=\"european_batch\"}") == 2000, "Prometheus items counter");
+    check(value_of("option_pricer_mc_paths_total") == 4000, "Prometheus Monte-Carlo paths counter");
+
+    instrumentation::reset();
+    s = instrumentation::collect();
+    bool cleared = s.mc.paths == 0 && s.mc.steps == 0 && s.mc.rng_draws == 0;
+    for (const instrumentation::probe_stats& p : s.probes) cleared = cleared && p.calls == 0 && p.items == 0 && p.latency.count() == 0;
+    check(cleared, "reset() clears live and retired stats");
+    check(json_syntax::valid(instrumentation::to_json(s)), "JSON export of an empty snapshot parses");
+#else
+    std::printf("instrumentation compiled out (OPTION_PRICER_INSTRUMENTATION not set), skipped\n");
+    skipped = true;
+#endif
+}
+
+int main(int argc, char* argv[]) {
+    struct group {
+        const char* name;
+        void (*run)();
+    };
+    const group groups[] = {{"asian_alloc", asian_alloc}, {"asian_threads", asian_threads}, {"asian_variance", asian_variance},
+                            {"asian_greeks", asian_greeks_vs_bumps}, {"mc_normals", shared_normals}, {"asian_qmc", asian_qmc}, {"batch", batch},
+                            {"specialised", batch_specialised}, {"greeks", batch_greeks}, {"setters", european_cache}, {"implied_vol", implied_vol},
+                            {"surface", surface}, {"american", american}, {"american_pde", american_pde}, {"pde_chain", american_chain},
+                            {"portfolio", portfolio_book}, {"risk", risk}, {"scenario", scenarios}, {"jsonl", jsonl}, {"daemon", daemon_slow_reader},
+                            {"daemon_stop", daemon_stop}, {"matrix", matrix_sweep}, {"philox", philox_blocks},
+                            {"portfolio_file", portfolio_file_round_trip}, {"instrumentation", instrumentation_counters}};
+    bool found = false;
+    for (const group& g : groups) {
+        if (argc < 2 || std::strcmp(argv[1], g.name) == 0) {
+            g.run();
+            found = true;
+        }
+    }
+    if (!found) {
+        std::printf("unknown test group %s\n", argv[1]);
+        return 2;
+    }
+    if (failures) std::printf("%d check(s) failed\n", failures);
+    return failures ? 1 : (skipped && argc >= 2) ? 77 : 0; // 77: CTest's SKIP_RETURN_CODE for a single skipped group
+}
@@ -0,0 +1,123 @@
+// vol_surface.cpp
+//
+// Volatility surface construction, slice fitting and lookup
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#include "vol_surface.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+vol_surface::vol_surface(std::span<const double> expiry, std::span<const double> strike, std::span<const double> vol) {
+    const std::size_t n = expiry.size();
+    if (strike.size() != n || vol.size() != n) throw std::invalid_argument("Error: surface quote spans must all have the same length");
+    if (n == 0) throw std::invalid_argument("Error: volatility surface needs at least one quote");
+    for (std::size_t i = 0; i < n; ++i) {
+        if (!(expiry[i] > 0) || !(strike[i] > 0) || !(vol[i] > 0) || !std::isfinite(expiry[i]) || !std::isfinite(strike[i]) || !std::isfinite(vol[i])) {
+            throw std::invalid_argument("Error: surface quotes need positive, finite expiry, strike and volatility");
+        }
+    }
+
+    // Group by expiry, strikes ascending within each expiry
+    std::vector<std::size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return expiry[a] != expiry[b] ? expiry[a] < expiry[b] : strike[a] < strike[b];
+    });
+    nodes.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::size_t q = order[i];
+        if (i == 0 || expiry[q] != expiries.back()) {
+            expiries.push_back(expiry[q]);
+            offsets.push_back(nodes.size());
+        } else if (strike[q] == strike[order[i - 1]]) {
+            throw std::invalid_argument("Error: duplicate strike in a surface expiry");
+        }
+        nodes.push_back({std::log(strike[q]), vol[q] * vol[q] * expiry[q], 0.0, 0.0, 0.0});
+    }
+    offsets.push_back(nodes.size());
+    for (std::size_t slice = 0; slice < expiries.size(); ++slice) fit_slice(slice);
+}
+
+// Fritsch-Butland slopes (zero at local extrema, weighted harmonic mean of the secants otherwise) keep each cubic
+// piece within its end values; the end slopes are the end secants
+void vol_surface::fit_slice(std::size_t slice) {
+    node* p = nodes.data() + offsets[slice];
+    const std::size_t count = offsets[slice + 1] - offsets[slice];
+    if (count == 1) {
+        p[0].slope = p[0].c2 = p[0].c3 = 0.0;
+        return;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        if (i == 0 || i == count - 1) {
+            const std::size_t a = (i == 0) ? 0 : count - 2;
+            p[i].slope = (p[a + 1].variance - p[a].variance) / (p[a + 1].log_strike - p[a].log_strike);
+            continue;
+        }
+        const double h0 = p[i].log_strike - p[i - 1].log_strike, h1 = p[i + 1].log_strike - p[i].log_strike;
+        const double s0 = (p[i].variance - p[i - 1].variance) / h0, s1 = (p[i + 1].variance - p[i].variance) / h1;
+        p[i].slope = (s0 * s1 <= 0) ? 0.0 : 3.0 * (h0 + h1) / ((2.0 * h1 + h0) / s0 + (h1 + 2.0 * h0) / s1);
+    }
+    for (std::size_t i = 0; i + 1 < count; ++i) {
+        const double h = p[i + 1].log_strike - p[i].log_strike;
+        const double secant = (p[i + 1].variance - p[i].variance) / h;
+        p[i].c2 = (3.0 * secant - 2.0 * p[i].slope - p[i + 1].slope) / h;
+        p[i].c3 = (p[i].slope + p[i + 1].slope - 2.0 * secant) / (h * h);
+    }
+    p[count - 1].c2 = p[count - 1].c3 = 0.0;
+}
+
+double vol_surface::slice_variance(std::size_t slice, double log_strike) const {
+    const node* first = nodes.data() + offsets[slice];
+    const node* last = nodes.data() + offsets[slice + 1];
+    if (log_strike <= first->log_strike) return first->variance;
+    if (log_strike >= (last - 1)->log_strike) return (last - 1)->variance;
+    const node* p = std::upper_bound(first, last, log_strike, [](double y, const node& n) { return y < n.log_strike; }) - 1;
+    const double t = log_strike - p->log_strike;
+    return p->variance + t * (p->slope + t * (p->c2 + t * p->c3));
+}
+
+double vol_surface::total_variance(double K, double T) const {
+    if (!(K > 0) || !(T > 0)) throw std::invalid_argument("Error: surface lookup needs positive strike and expiry");
+    const double y = std::log(K);
+    const std::size_t upper = std::upper_bound(expiries.begin(), expiries.end(), T) - expiries.begin();
+    if (upper == 0) return slice_variance(0, y) * (T / expiries.front()); // flat vol before the first expiry
+    if (upper == expiries.size()) return slice_variance(upper - 1, y) * (T / expiries.back()); // and after the last
+    const double T0 = expiries[upper - 1], T1 = expiries[upper];
+    const double w0 = slice_variance(upper - 1, y), w1 = slice_variance(upper, y);
+    return w0 + (w1 - w0) * (T - T0) / (T1 - T0);
+}
+
+double vol_surface::volatility(double K, double T) const {
+    return std::sqrt(total_variance(K, T) / T);
+}
+
+// Nearest expiry, then nearest strike in its slice; a log-strike distance is a relative strike distance
+void vol_surface::update_quote(double T, double K, double vol) {
+    if (!(vol > 0) || !std::isfinite(vol)) throw std::invalid_argument("Error: surface quotes need positive, finite volatility");
+    auto it = std::lower_bound(expiries.begin(), expiries.end(), T);
+    if (it != expiries.begin() && (it == expiries.end() || T - *(it - 1) < *it - T)) --it;
+    if (!(std::fabs(*it - T) <= quote_tolerance * *it)) throw std::invalid_argument("Error: no surface slice at this expiry");
+    const std::size_t slice = it - expiries.begin();
+    const double y = std::log(K);
+    node* first = nodes.data() + offsets[slice];
+    node* last = nodes.data() + offsets[slice + 1];
+    node* p = std::lower_bound(first, last, y, [](const node& n, double value) { return n.log_strike < value; });
+    if (p != first && (p == last || y - (p - 1)->log_strike < p->log_strike - y)) --p;
+    if (!(std::fabs(p->log_strike - y) <= quote_tolerance)) throw std::invalid_argument("Error: no surface quote at this strike");
+    p->variance = vol * vol * *it;
+    fit_slice(slice);
+}
+
+std::size_t vol_surface::calendar_violations() const {
+    std::size_t violations = 0;
+    for (std::size_t slice = 0; slice + 1 < expiries.size(); ++slice) {
+        for (std::size_t i = offsets[slice]; i < offsets[slice + 2]; ++i) {
+            if (slice_variance(slice + 1, nodes[i].log_strike) < slice_variance(slice, nodes[i].log_strike)) ++violations;
+        }
+    }
+    return violations;
+}
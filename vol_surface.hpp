@@ -0,0 +1,57 @@
+// vol_surface.hpp
+//
+// Implied volatility surface built from (expiry, strike, vol) quotes. Each expiry slice is a monotone
+// (Fritsch-Butland) cubic in total variance w = sig^2 T over log-strike, flat beyond the outermost strikes, so the
+// interpolant never overshoots the quotes. Between expiries total variance is linear in T (flat forward variance),
+// which keeps the surface free of calendar arbitrage wherever the quoted slices are; outside the quoted expiries the
+// nearest slice's vol is held flat. Spline coefficients of all slices live in one contiguous array; a lookup is two
+// binary searches and never allocates. Sticky strike: the surface does not move with spot.
+//
+// @author Mark Bogorad
+// @version 2.0
+
+#ifndef VOL_SURFACE_HPP
+#define VOL_SURFACE_HPP
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+class vol_surface {
+public:
+    // Quotes are parallel arrays, one (expiry, strike, vol) per index, in any order; each expiry needs at least one
+    // strike, and a strike may appear only once per expiry
+    vol_surface(std::span<const double> expiries, std::span<const double> strikes, std::span<const double> vols);
+
+    double volatility(double K, double T) const;
+    double total_variance(double K, double T) const;
+
+    // Replaces the vol of an existing (expiry, strike) quote and refits only that expiry's slice. T and K match a quote
+    // to within quote_tolerance (relative), so values recomputed with different rounding still find it.
+    void update_quote(double T, double K, double vol);
+    static constexpr double quote_tolerance = 1e-9;
+
+    // Quoted strikes at which total variance decreases from one expiry to the next
+    std::size_t calendar_violations() const;
+
+    std::size_t expiry_count() const { return expiries.size(); }
+
+private:
+    // Cubic on [log_strike, next node's log_strike): w = variance + t (slope + t (c2 + t c3)), t = y - log_strike
+    struct node {
+        double log_strike;
+        double variance;
+        double slope;
+        double c2;
+        double c3;
+    };
+
+    void fit_slice(std::size_t slice);
+    double slice_variance(std::size_t slice, double log_strike) const;
+
+    std::vector<double> expiries; // ascending
+    std::vector<std::size_t> offsets; // slice j is nodes[offsets[j], offsets[j + 1])
+    std::vector<node> nodes;
+};
+
+#endif // VOL_SURFACE_HPP